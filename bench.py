@@ -0,0 +1,284 @@
+#!/usr/bin/env python3
+
+"""
+Measures the speed of the code rcc generates against clang. Each kernel in
+benchmarks/kernels is compiled by both compilers at the same -O level, linked
+against a driver (always compiled by clang) and run several times.
+
+Usage: bench.py [-h] [-O LEVEL] [-r RUNS] [--json FILE] [kernel ...]
+
+Example usage: ./bench.py -O0 -O2 -r 5 matmul structs
+
+This will print the median run time of each kernel under both compilers and
+the ratio rcc / clang. Binaries and logs are placed into output/bench/.
+"""
+
+
+__version__ = "0.1.0"
+
+
+import sys
+import json
+import time
+import argparse
+import statistics
+import subprocess
+from dataclasses import dataclass, asdict
+from pathlib import Path
+from typing import List, Optional
+
+
+RED = "\033[31m"
+GREEN = "\033[32m"
+RESET = "\033[0m"
+
+if not sys.stdout.isatty():
+    # Don't output colours when we're not in a TTY
+    RED, GREEN, RESET = "", "", ""
+
+SCRIPT_LOCATION = Path(__file__).resolve().parent
+PROJECT_LOCATION = SCRIPT_LOCATION
+OUTPUT_FOLDER = PROJECT_LOCATION.joinpath("output/bench").resolve()
+KERNEL_FOLDER = PROJECT_LOCATION.joinpath("benchmarks/kernels").resolve()
+COMPILER_FILE = PROJECT_LOCATION.joinpath("build/rcc").resolve()
+
+COMPILE_TIMEOUT_SECONDS = 60
+RUN_TIMEOUT_SECONDS = 60
+
+# Ratios above this are printed in red
+SLOWDOWN_THRESHOLD = 1.5
+
+
+class BenchError(Exception):
+    pass
+
+
+@dataclass
+class Result:
+    """Class for keeping track of each kernel's timings at one -O level"""
+    kernel: str
+    opt_level: str
+    rcc_seconds: List[float]
+    clang_seconds: List[float]
+
+    @property
+    def rcc_median(self) -> float:
+        return statistics.median(self.rcc_seconds)
+
+    @property
+    def clang_median(self) -> float:
+        return statistics.median(self.clang_seconds)
+
+    @property
+    def ratio(self) -> float:
+        return self.rcc_median / self.clang_median
+
+    def to_log(self) -> str:
+        colour = RED if self.ratio > SLOWDOWN_THRESHOLD else GREEN
+        return (
+            f"{self.kernel:<12} -O{self.opt_level:<4}"
+            f"{self.rcc_median * 1000:>12.1f}"
+            f"{self.clang_median * 1000:>12.1f}"
+            f"{colour}{self.ratio:>10.2f}x{RESET}"
+        )
+
+    def to_json(self) -> dict:
+        result = asdict(self)
+        result["ratio"] = self.ratio
+        return result
+
+
+def run_subprocess(
+    cmd: List[str],
+    timeout: int,
+    log_path: Optional[Path] = None,
+):
+    """
+    Wrapper for subprocess.run(...) that raises BenchError on failure, with
+    the output logged to log_path.{stdout,stderr}.log if given.
+    """
+    stdout = subprocess.DEVNULL
+    stderr = subprocess.DEVNULL
+    if log_path:
+        stdout = open(f"{log_path}.stdout.log", "w")
+        stderr = open(f"{log_path}.stderr.log", "w")
+
+    try:
+        subprocess.run(cmd, stdout=stdout, stderr=stderr, timeout=timeout,
+                       check=True)
+    except subprocess.CalledProcessError as e:
+        raise BenchError(
+            f"{' '.join(map(str, e.cmd))} failed with return code "
+            f"{e.returncode}")
+    except subprocess.TimeoutExpired as e:
+        raise BenchError(
+            f"{' '.join(map(str, e.cmd))} took more than {e.timeout}s")
+    finally:
+        if log_path:
+            stdout.close()
+            stderr.close()
+
+
+def build(kernel: Path, opt_level: str) -> tuple[Path, Path]:
+    """
+    Builds the kernel with rcc and with clang, linking each against the same
+    clang compiled driver.
+
+    Returns the paths of the (rcc, clang) executables.
+    """
+    out = OUTPUT_FOLDER.joinpath(kernel.stem, f"O{opt_level}")
+    out.mkdir(parents=True, exist_ok=True)
+    driver = kernel.with_name(f"{kernel.stem}_driver.c")
+
+    run_subprocess(
+        cmd=["clang", f"-O{opt_level}", "-c", driver,
+             "-o", out.joinpath("driver.o")],
+        timeout=COMPILE_TIMEOUT_SECONDS,
+        log_path=out.joinpath("driver"))
+    run_subprocess(
+        cmd=[COMPILER_FILE, f"-O{opt_level}", "-c", kernel,
+             "-o", out.joinpath("rcc.o")],
+        timeout=COMPILE_TIMEOUT_SECONDS,
+        log_path=out.joinpath("rcc"))
+    run_subprocess(
+        cmd=["clang", f"-O{opt_level}", "-c", kernel,
+             "-o", out.joinpath("clang.o")],
+        timeout=COMPILE_TIMEOUT_SECONDS,
+        log_path=out.joinpath("clang"))
+
+    executables = []
+    for compiler in ["rcc", "clang"]:
+        executable = out.joinpath(f"{kernel.stem}.{compiler}")
+        run_subprocess(
+            cmd=["clang", out.joinpath(f"{compiler}.o"),
+                 out.joinpath("driver.o"), "-o", executable],
+            timeout=COMPILE_TIMEOUT_SECONDS,
+            log_path=out.joinpath(f"{compiler}.linker"))
+        executables.append(executable)
+
+    return executables[0], executables[1]
+
+
+def time_run(executable: Path) -> float:
+    """
+    Runs the executable once and returns its wall time. A non zero exit code
+    means the kernel computed the wrong answer.
+    """
+    start = time.perf_counter()
+    run_subprocess(cmd=[executable], timeout=RUN_TIMEOUT_SECONDS)
+    return time.perf_counter() - start
+
+
+def run_benchmarks(args) -> List[Result]:
+    """
+    Builds and times every selected kernel at every -O level. The rcc and
+    clang binaries are run alternately, so drift in machine load affects both
+    equally.
+    """
+    kernels = sorted(
+        p for p in KERNEL_FOLDER.glob("*.c")
+        if not p.stem.endswith("_driver")
+        and (not args.kernels or p.stem in args.kernels))
+    if not kernels:
+        raise BenchError("no kernels selected")
+
+    print(
+        f"{'Kernel':<12} {'Level':<4}{'rcc (ms)':>12}{'clang (ms)':>12}"
+        f"{'Ratio':>11}")
+
+    results = []
+    for kernel in kernels:
+        for opt_level in args.opt_levels:
+            try:
+                rcc, clang = build(kernel, opt_level)
+
+                # Untimed warm up, also checks both give the right answer
+                time_run(rcc)
+                time_run(clang)
+
+                rcc_seconds = []
+                clang_seconds = []
+                for _ in range(args.runs):
+                    rcc_seconds.append(time_run(rcc))
+                    clang_seconds.append(time_run(clang))
+            except BenchError as e:
+                print(f"{RED}{kernel.stem:<12} -O{opt_level:<4}{e}{RESET}")
+                continue
+
+            result = Result(kernel.stem, opt_level, rcc_seconds, clang_seconds)
+            print(result.to_log())
+            results.append(result)
+
+    # Geometric mean, so one long kernel doesn't dominate
+    for opt_level in args.opt_levels:
+        ratios = [r.ratio for r in results if r.opt_level == opt_level]
+        if ratios:
+            print(f"{'geomean':<12} -O{opt_level:<4}{'':>24}"
+                  f"{statistics.geometric_mean(ratios):>10.2f}x")
+
+    return results
+
+
+def parse_args():
+    """
+    Wrapper for argument parsing.
+    """
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "kernels",
+        nargs="*",
+        help="(Optional) names of the kernels to run, e.g. matmul. Leave "
+        "blank to run all kernels in benchmarks/kernels."
+    )
+    parser.add_argument(
+        "-O",
+        dest="opt_levels",
+        action="append",
+        choices=["0", "1", "2", "3", "s"],
+        help="Optimisation level to compare at, passed to both compilers. "
+        "Repeat to compare at several levels, e.g. -O0 -O2 (the default)."
+    )
+    parser.add_argument(
+        "-r", "--runs",
+        type=int,
+        default=5,
+        help="Number of timed runs of each binary. The median is reported."
+    )
+    parser.add_argument(
+        "--json",
+        type=Path,
+        help="Write every run time and ratio as JSON, for tracking over time."
+    )
+    parser.add_argument(
+        "--version",
+        action="version",
+        version=f"BetterBenchmarking {__version__}"
+    )
+    args = parser.parse_args()
+    args.opt_levels = args.opt_levels or ["0", "2"]
+    return args
+
+
+def main():
+    args = parse_args()
+
+    if not COMPILER_FILE.exists():
+        print(RED + f"{COMPILER_FILE} not found, build rcc first" + RESET)
+        exit(1)
+
+    try:
+        results = run_benchmarks(args)
+    except BenchError as e:
+        print(RED + str(e) + RESET)
+        exit(1)
+
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump([r.to_json() for r in results], f, indent=2)
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    finally:
+        print(RESET, end="")
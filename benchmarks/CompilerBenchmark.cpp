@@ -0,0 +1,381 @@
+#include "AST/AST.hpp"
+#include "CodeGen/CodeGenModule.hpp"
+#include "CodeGen/TargetMachineCache.hpp"
+#include "CodeGen/TypeChecker.hpp"
+#include "Driver/CompileStats.hpp"
+#include "Driver/Preprocess.hpp"
+
+#include "benchmark/benchmark.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Measures the speed of each compiler phase, in process, on the functional
+ * tests and on generated sources that stress one part of the compiler each.
+ * Every benchmark reports lines per second and the peak RSS of the process so
+ * far; run a single benchmark (--benchmark_filter) for its own peak.
+ */
+
+namespace fs = std::filesystem;
+
+namespace
+{
+struct Source
+{
+    std::string name;
+    std::string contents;
+    fs::path directory; // Searched for #include "..."
+};
+
+std::string readFile(const fs::path &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+size_t countLines(const std::string &source)
+{
+    return std::count(source.begin(), source.end(), '\n') + 1;
+}
+
+/******************************************************************************
+ *                          Phases                                            *
+ *****************************************************************************/
+
+// rcc's own preprocessing, with the header cache shared by every translation
+// unit of a single invocation
+std::string preprocess(const Source &source)
+{
+    static Driver::IncludeCache includeCache;
+    Driver::CompileStats stats;
+    return Driver::preprocess(
+        source.contents, source.directory.string(), includeCache, stats);
+}
+
+/**
+ * The state of one translation unit after each phase. Later phases need the
+ * outputs of the earlier ones, which are rebuilt outside the timed region.
+ */
+struct CompileUnit
+{
+    std::string preprocessed;
+    AST::ASTContext astContext;
+    const AST::TranslationUnit *tu = nullptr;
+    std::unique_ptr<CodeGen::TypeChecker> typeChecker;
+    std::unique_ptr<CodeGen::CodeGenModule> module;
+
+    explicit CompileUnit(std::string preprocessed)
+        : preprocessed(std::move(preprocessed))
+    {
+    }
+
+    void parse()
+    {
+        tu = AST::parseSource(preprocessed, astContext);
+    }
+
+    void typeCheck()
+    {
+        typeChecker = std::make_unique<CodeGen::TypeChecker>(astContext, "");
+        tu->accept(*typeChecker);
+    }
+
+    void generateIR()
+    {
+        module = std::make_unique<CodeGen::CodeGenModule>(
+            "bench.c",
+            "bench.o",
+            astContext,
+            typeChecker->getNodeMap(),
+            typeChecker->getStructMap(),
+            typeChecker->getConstantMap(),
+            "",
+            CodeGen::OptLevel::O0);
+        tu->accept(*module);
+    }
+
+    // Includes the -O0 pipeline, which rcc always runs before emitting
+    void emitObject()
+    {
+        module->optimize();
+
+        llvm::SmallVector<char, 0> object;
+        llvm::raw_svector_ostream os(object);
+        module->emitObject(os);
+        benchmark::DoNotOptimize(object.data());
+    }
+};
+
+enum class Phase
+{
+    Preprocess,
+    Parse,
+    TypeCheck,
+    CodeGen,
+    Emit,
+    All
+};
+
+// Runs the phases before `phase`, untimed
+std::unique_ptr<CompileUnit> prepare(const Source &source, Phase phase)
+{
+    auto unit = std::make_unique<CompileUnit>(preprocess(source));
+    if (phase > Phase::Parse)
+    {
+        unit->parse();
+    }
+    if (phase > Phase::TypeCheck)
+    {
+        unit->typeCheck();
+    }
+    if (phase > Phase::CodeGen)
+    {
+        unit->generateIR();
+    }
+    return unit;
+}
+
+void compile(const Source &source)
+{
+    CompileUnit unit(preprocess(source));
+    unit.parse();
+    unit.typeCheck();
+    unit.generateIR();
+    unit.emitObject();
+}
+
+void runPhase(benchmark::State &state, const Source &source, Phase phase)
+{
+    if (phase == Phase::Preprocess)
+    {
+        benchmark::DoNotOptimize(preprocess(source));
+        return;
+    }
+    if (phase == Phase::All)
+    {
+        compile(source);
+        return;
+    }
+
+    // Only the phase itself is timed, not its inputs or the teardown
+    state.PauseTiming();
+    std::unique_ptr<CompileUnit> unit = prepare(source, phase);
+    state.ResumeTiming();
+
+    switch (phase)
+    {
+    case Phase::Parse:
+        unit->parse();
+        break;
+    case Phase::TypeCheck:
+        unit->typeCheck();
+        break;
+    case Phase::CodeGen:
+        unit->generateIR();
+        break;
+    case Phase::Emit:
+        unit->emitObject();
+        break;
+    default:
+        break;
+    }
+
+    state.PauseTiming();
+    unit.reset();
+    state.ResumeTiming();
+}
+
+/******************************************************************************
+ *                          Corpus                                            *
+ *****************************************************************************/
+
+// Every test program under tests/, without the drivers (compiled by clang)
+// and without the programs rcc rejects
+std::vector<Source> loadTests()
+{
+    std::vector<Source> sources;
+    for (const auto &entry : fs::recursive_directory_iterator(RCC_TESTS_DIR))
+    {
+        std::string stem = entry.path().stem().string();
+        if (entry.path().extension() != ".c" ||
+            stem.size() >= 7 && stem.substr(stem.size() - 7) == "_driver")
+        {
+            continue;
+        }
+        sources.push_back(
+            {entry.path().string(),
+             readFile(entry.path()),
+             entry.path().parent_path()});
+    }
+
+    sources.erase(
+        std::remove_if(
+            sources.begin(),
+            sources.end(),
+            [](const Source &source)
+            {
+                try
+                {
+                    compile(source);
+                    return false;
+                }
+                catch (const std::exception &e)
+                {
+                    std::cerr << "Skipping " << source.name << ": "
+                              << e.what() << std::endl;
+                    return true;
+                }
+            }),
+        sources.end());
+
+    // Directory order is unspecified, keep runs comparable
+    std::sort(
+        sources.begin(),
+        sources.end(),
+        [](const Source &lhs, const Source &rhs)
+        { return lhs.name < rhs.name; });
+    return sources;
+}
+
+// Blocks and conditions nested `depth` levels deep
+std::string generateDeepNesting(size_t depth)
+{
+    std::string source = "int f(int x)\n{\n    int y = 0;\n";
+    for (size_t i = 0; i < depth; i++)
+    {
+        source += "if (x > " + std::to_string(i) + ") {\n";
+        source += "int v" + std::to_string(i) + " = x + y;\n";
+        source += "y = y + v" + std::to_string(i) + ";\n";
+    }
+    source += std::string(depth, '}') + "\n    return y;\n}\n";
+    return source;
+}
+
+// Many small functions, each calling the previous one
+std::string generateFunctions(size_t count)
+{
+    std::string source = "int f0(int x)\n{\n    return x;\n}\n";
+    for (size_t i = 1; i < count; i++)
+    {
+        std::string n = std::to_string(i);
+        std::string prev = std::to_string(i - 1);
+        source += "int f" + n + "(int x)\n{\n    int y = x * " + n +
+                  ";\n    return f" + prev + "(y) + 1;\n}\n";
+    }
+    return source;
+}
+
+// A global table with one initializer per line
+std::string generateInitializer(size_t lines)
+{
+    std::string source = "int table[" + std::to_string(lines) + "] = {\n";
+    for (size_t i = 0; i < lines; i++)
+    {
+        source += "    " + std::to_string(i * 7 % 1000) + ",\n";
+    }
+    source += "};\n";
+    return source;
+}
+
+// Nested function-like macros, every statement expands several of them
+std::string generateMacroStorm(size_t lines)
+{
+    std::string source = "#define ADD(a, b) ((a) + (b))\n"
+                         "#define MUL(a, b) ((a) * (b))\n"
+                         "#define POLY(x) ADD(MUL(x, x), ADD(x, 1))\n"
+                         "#define POLY2(x) POLY(POLY(x))\n"
+                         "int f(int v)\n{\n";
+    for (size_t i = 0; i < lines; i++)
+    {
+        std::string n = std::to_string(i);
+        source += "    v = POLY2(v) + MUL(v, " + n + ");\n";
+    }
+    source += "    return v;\n}\n";
+    return source;
+}
+
+long getPeakRSSKilobytes()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+void registerBenchmark(
+    const std::string &name,
+    std::vector<Source> sources,
+    Phase phase)
+{
+    size_t lines = 0;
+    for (const auto &source : sources)
+    {
+        lines += countLines(source.contents);
+    }
+
+    benchmark::RegisterBenchmark(
+        name.c_str(),
+        [sources = std::move(sources), lines, phase](benchmark::State &state)
+        {
+            for (auto _ : state)
+            {
+                for (const auto &source : sources)
+                {
+                    runPhase(state, source, phase);
+                }
+            }
+
+            state.counters["lines/s"] = benchmark::Counter(
+                lines, benchmark::Counter::kIsIterationInvariantRate);
+            state.counters["peak_rss_mb"] = getPeakRSSKilobytes() / 1024.0;
+        })
+        ->Unit(benchmark::kMillisecond);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+    benchmark::Initialize(&argc, argv);
+    CodeGen::TargetMachineCache::initializeTargets();
+
+    std::vector<std::pair<std::string, std::vector<Source>>> corpus = {
+        {"tests", loadTests()},
+        {"deep_nesting", {{"deep_nesting", generateDeepNesting(500)}}},
+        {"functions_10k", {{"functions_10k", generateFunctions(10000)}}},
+        {"initializer_100k",
+         {{"initializer_100k", generateInitializer(100000)}}},
+        {"macro_storm", {{"macro_storm", generateMacroStorm(20000)}}},
+    };
+
+    const std::pair<const char *, Phase> phases[] = {
+        {"preprocess", Phase::Preprocess},
+        {"parse", Phase::Parse},
+        {"typecheck", Phase::TypeCheck},
+        {"codegen", Phase::CodeGen},
+        {"emit", Phase::Emit},
+        {"all", Phase::All},
+    };
+
+    for (const auto &[corpusName, sources] : corpus)
+    {
+        for (const auto &[phaseName, phase] : phases)
+        {
+            registerBenchmark(corpusName + "/" + phaseName, sources, phase);
+        }
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
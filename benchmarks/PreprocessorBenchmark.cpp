@@ -0,0 +1,124 @@
+#define TCPP_IMPLEMENTATION
+#include "Preprocessor.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+
+// Every heap allocation made by the process, to spot per-token allocations
+static size_t allocationCount = 0;
+
+void *operator new(size_t size)
+{
+    allocationCount++;
+    if (void *ptr = std::malloc(size ? size : 1))
+    {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+/**
+ * Measures tcpp throughput on large generated sources. Run with an optional
+ * size in megabytes (default 4).
+ */
+
+// A lookup table with one initializer per line
+std::string generateTable(size_t bytes)
+{
+    std::string source = "#define SCALE(x) ((x) * 3)\nint table[] = {\n";
+    for (size_t i = 0; source.size() < bytes; i++)
+    {
+        source += "    SCALE(" + std::to_string(i) + "), " +
+                  std::to_string(i * 7 % 1000) + ", /* entry */\n";
+    }
+    source += "};\n";
+    return source;
+}
+
+// The same table generated as a single line, e.g. by xxd or a script
+std::string generateLongLine(size_t bytes)
+{
+    std::string source = "int table[] = {";
+    for (size_t i = 0; source.size() < bytes; i++)
+    {
+        source += std::to_string(i) + ", ";
+    }
+    source += "};\n";
+    return source;
+}
+
+// A register map: thousands of object-like macros, each used once
+std::string generateDefines(size_t bytes)
+{
+    std::string defines;
+    std::string uses = "int regs[] = {\n";
+    for (size_t i = 0; defines.size() + uses.size() < bytes; i++)
+    {
+        std::string name = "REG_" + std::to_string(i);
+        defines += "#define " + name + " " + std::to_string(0x1000 + i) + "\n";
+        uses += "    " + name + ",\n";
+    }
+    return defines + uses + "};\n";
+}
+
+// Nested function-like macros, every line expands several of them
+std::string generateMacroStress(size_t bytes)
+{
+    std::string source = "#define ADD(a, b) ((a) + (b))\n"
+                         "#define MUL(a, b) ((a) * (b))\n"
+                         "#define POLY(x) ADD(MUL(x, x), ADD(x, 1))\n";
+    for (size_t i = 0; source.size() < bytes; i++)
+    {
+        std::string n = std::to_string(i);
+        source += "int v" + n + " = POLY(" + n + ") + MUL(v, " + n + ");\n";
+    }
+    return source;
+}
+
+void run(const std::string &name, const std::string &source)
+{
+    size_t allocationsBefore = allocationCount;
+    auto start = std::chrono::steady_clock::now();
+
+    tcpp::Lexer lexer(std::make_unique<tcpp::StringInputStream>(source));
+    tcpp::Preprocessor preprocessor(lexer, {[](const tcpp::TErrorInfo &) {}});
+    std::string output = preprocessor.Process();
+
+    auto end = std::chrono::steady_clock::now();
+    size_t allocations = allocationCount - allocationsBefore;
+    double seconds = std::chrono::duration<double>(end - start).count();
+    double megabytes = source.size() / (1024.0 * 1024.0);
+
+    auto stats = preprocessor.GetStats();
+    std::cout << name << ": " << megabytes << " MB in " << seconds << " s ("
+              << megabytes / seconds << " MB/s, " << output.size()
+              << " bytes out, " << stats.mMacroLookups << " macro lookups, "
+              << stats.mMacroHits << " hits, " << allocations
+              << " allocations)" << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    size_t megabytes = (argc > 1) ? std::stoul(argv[1]) : 4;
+    size_t bytes = megabytes * 1024 * 1024;
+
+    run("table", generateTable(bytes));
+    run("long line", generateLongLine(bytes));
+    run("defines", generateDefines(bytes));
+    run("macro stress", generateMacroStress(bytes));
+
+    return 0;
+}
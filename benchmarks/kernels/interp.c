@@ -0,0 +1,116 @@
+/* A stack based bytecode interpreter. Every instruction goes through one
+   dense switch, which should be lowered to a jump table, and the small
+   constants are pushed by a GNU case range. */
+enum Op
+{
+    OP_HALT,
+    OP_PUSH,
+    OP_LOAD,
+    OP_STORE,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_XOR,
+    OP_AND,
+    OP_SHL,
+    OP_SHR,
+    OP_DUP,
+    OP_SWAP,
+    OP_DROP,
+    OP_DEC,
+    OP_JNZ,
+    OP_SMALL = 32 /* OP_SMALL + n pushes n, for n < 32 */
+};
+
+long run(int *code, long *memory)
+{
+    long stack[64];
+    long top;
+    int sp = 0;
+    int pc = 0;
+
+    while (1)
+    {
+        int op = code[pc];
+        pc++;
+
+        switch (__builtin_expect(op, OP_LOAD))
+        {
+        case OP_HALT:
+            return stack[sp - 1];
+        case OP_PUSH:
+            stack[sp] = code[pc];
+            sp++;
+            pc++;
+            break;
+        case OP_LOAD:
+            stack[sp] = memory[code[pc]];
+            sp++;
+            pc++;
+            break;
+        case OP_STORE:
+            sp--;
+            memory[code[pc]] = stack[sp];
+            pc++;
+            break;
+        case OP_ADD:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] + stack[sp];
+            break;
+        case OP_SUB:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] - stack[sp];
+            break;
+        case OP_MUL:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] * stack[sp];
+            break;
+        case OP_XOR:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] ^ stack[sp];
+            break;
+        case OP_AND:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] & stack[sp];
+            break;
+        case OP_SHL:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] << stack[sp];
+            break;
+        case OP_SHR:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] >> stack[sp];
+            break;
+        case OP_DUP:
+            stack[sp] = stack[sp - 1];
+            sp++;
+            break;
+        case OP_SWAP:
+            top = stack[sp - 1];
+            stack[sp - 1] = stack[sp - 2];
+            stack[sp - 2] = top;
+            break;
+        case OP_DROP:
+            sp--;
+            break;
+        case OP_DEC:
+            stack[sp - 1] = stack[sp - 1] - 1;
+            break;
+        case OP_JNZ:
+            sp--;
+            if (stack[sp])
+            {
+                pc = code[pc];
+            }
+            else
+            {
+                pc++;
+            }
+            break;
+        case OP_SMALL ... OP_SMALL + 31:
+            stack[sp] = op - OP_SMALL;
+            sp++;
+            break;
+        }
+    }
+}
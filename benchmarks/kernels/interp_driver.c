@@ -0,0 +1,53 @@
+#define N 2000000
+#define REPEAT 5
+
+enum Op
+{
+    OP_HALT,
+    OP_PUSH,
+    OP_LOAD,
+    OP_STORE,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_XOR,
+    OP_AND,
+    OP_SHL,
+    OP_SHR,
+    OP_DUP,
+    OP_SWAP,
+    OP_DROP,
+    OP_DEC,
+    OP_JNZ,
+    OP_SMALL = 32
+};
+
+long run(int *code, long *memory);
+
+/* while (i) { acc = ((acc * 31 + i) ^ (i << 3)) & 0xffffff; i--; } */
+static int code[] = {
+    /* 0 */ OP_LOAD, 1, OP_SMALL + 31, OP_MUL, OP_LOAD, 0, OP_ADD,
+    /* 7 */ OP_LOAD, 0, OP_SMALL + 3, OP_SHL, OP_XOR,
+    /* 12 */ OP_PUSH, 0xffffff, OP_AND, OP_STORE, 1,
+    /* 17 */ OP_LOAD, 0, OP_DEC, OP_DUP, OP_STORE, 0, OP_JNZ, 0,
+    /* 25 */ OP_LOAD, 1, OP_HALT,
+};
+
+int main()
+{
+    for (int r = 0; r < REPEAT; r++)
+    {
+        long memory[2] = {N + r, r};
+        long expected = r;
+        for (long i = N + r; i; i--)
+        {
+            expected = ((expected * 31 + i) ^ (i << 3)) & 0xffffff;
+        }
+
+        if (run(code, memory) != expected)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
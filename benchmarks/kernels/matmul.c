@@ -0,0 +1,19 @@
+/* Dense matrix multiply, row major. Stresses array indexing and loops. */
+void matmul(int n, double *a, double *b, double *c)
+{
+    int i;
+    int j;
+    int k;
+    for (i = 0; i < n; i++)
+    {
+        for (j = 0; j < n; j++)
+        {
+            double sum = 0;
+            for (k = 0; k < n; k++)
+            {
+                sum += a[i * n + k] * b[k * n + j];
+            }
+            c[i * n + j] = sum;
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#define N 200
+#define REPEAT 10
+
+void matmul(int n, double *a, double *b, double *c);
+
+static double a[N * N];
+static double b[N * N];
+static double c[N * N];
+
+int main()
+{
+    for (int i = 0; i < N * N; i++)
+    {
+        a[i] = i % 7;
+        b[i] = i % 5;
+    }
+
+    for (int r = 0; r < REPEAT; r++)
+    {
+        matmul(N, a, b, c);
+    }
+
+    double expected = 0;
+    for (int k = 0; k < N; k++)
+    {
+        expected += a[(N - 1) * N + k] * b[k * N + N - 1];
+    }
+    return c[N * N - 1] != expected;
+}
@@ -0,0 +1,21 @@
+/* Shell sort followed by insertion sort passes. Stresses branches, loads and
+   stores through pointers. */
+void sort(int *values, int n)
+{
+    int gap;
+    int i;
+    for (gap = n / 2; gap > 0; gap /= 2)
+    {
+        for (i = gap; i < n; i++)
+        {
+            int value = values[i];
+            int j = i;
+            while (j >= gap && values[j - gap] > value)
+            {
+                values[j] = values[j - gap];
+                j -= gap;
+            }
+            values[j] = value;
+        }
+    }
+}
@@ -0,0 +1,29 @@
+#define N 200000
+#define REPEAT 10
+
+void sort(int *values, int n);
+
+static int values[N];
+
+int main()
+{
+    for (int r = 0; r < REPEAT; r++)
+    {
+        unsigned seed = 12345 + r;
+        for (int i = 0; i < N; i++)
+        {
+            seed = seed * 1103515245 + 12345;
+            values[i] = (int)(seed >> 8);
+        }
+        sort(values, N);
+    }
+
+    for (int i = 1; i < N; i++)
+    {
+        if (values[i - 1] > values[i])
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+/* Byte at a time string processing. Stresses char loads, sign and zero
+   extension and comparisons. */
+int count_words(char *text)
+{
+    int words = 0;
+    int inWord = 0;
+    while (*text)
+    {
+        char c = *text;
+        if (c == ' ' || c == '\n' || c == '\t')
+        {
+            inWord = 0;
+        }
+        else if (!inWord)
+        {
+            inWord = 1;
+            words++;
+        }
+        text++;
+    }
+    return words;
+}
+
+unsigned hash_string(char *text)
+{
+    unsigned hash = 2166136261;
+    while (*text)
+    {
+        hash = (hash ^ (unsigned char)*text) * 16777619;
+        text++;
+    }
+    return hash;
+}
+
+void to_upper(char *dst, char *src)
+{
+    while (*src)
+    {
+        char c = *src;
+        if (c >= 'a' && c <= 'z')
+        {
+            c = c - 'a' + 'A';
+        }
+        *dst = c;
+        dst++;
+        src++;
+    }
+    *dst = 0;
+}
@@ -0,0 +1,42 @@
+#define SIZE (1 << 20)
+#define REPEAT 20
+
+int count_words(char *text);
+unsigned hash_string(char *text);
+void to_upper(char *dst, char *src);
+
+static char text[SIZE + 1];
+static char upper[SIZE + 1];
+
+int main()
+{
+    const char *words[] = {"the ", "quick\n", "brown\t", "fox ", "jumps "};
+    int length = 0;
+    int expected = 0;
+    while (1)
+    {
+        const char *word = words[expected % 5];
+        int i = 0;
+        while (word[i] && length < SIZE)
+        {
+            text[length++] = word[i++];
+        }
+        if (length == SIZE)
+        {
+            break;
+        }
+        expected++;
+    }
+
+    unsigned hash = 0;
+    for (int r = 0; r < REPEAT; r++)
+    {
+        if (count_words(text) != expected + 1)
+        {
+            return 1;
+        }
+        to_upper(upper, text);
+        hash += hash_string(upper);
+    }
+    return hash == 0 || upper[0] != 'T';
+}
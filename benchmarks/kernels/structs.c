@@ -0,0 +1,72 @@
+/* Small structs passed and returned by value. Stresses the calling
+   convention coercions: INTEGER, SSE and mixed eightbytes, and memory. */
+struct vec2
+{
+    float x;
+    float y;
+};
+
+struct pair
+{
+    long a;
+    double b;
+};
+
+struct triple
+{
+    long a;
+    long b;
+    long c;
+};
+
+struct vec2 vec2_add(struct vec2 lhs, struct vec2 rhs)
+{
+    struct vec2 result;
+    result.x = lhs.x + rhs.x;
+    result.y = lhs.y + rhs.y;
+    return result;
+}
+
+struct pair pair_step(struct pair p)
+{
+    struct pair result;
+    result.a = p.a + 1;
+    result.b = p.b * 0.5 + 1;
+    return result;
+}
+
+struct triple triple_rotate(struct triple t)
+{
+    struct triple result;
+    result.a = t.b;
+    result.b = t.c;
+    result.c = t.a + 1;
+    return result;
+}
+
+long run_structs(int n)
+{
+    struct vec2 v;
+    struct vec2 step;
+    struct pair p;
+    struct triple t;
+    int i;
+
+    v.x = 0;
+    v.y = 0;
+    step.x = 1;
+    step.y = 1;
+    p.a = 0;
+    p.b = 0;
+    t.a = 0;
+    t.b = 0;
+    t.c = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        v = vec2_add(v, step);
+        p = pair_step(p);
+        t = triple_rotate(t);
+    }
+    return (long)v.x + (long)v.y + p.a + (long)p.b + t.a + t.b + t.c;
+}
@@ -0,0 +1,12 @@
+// Small enough that the float members stay exact
+#define N 10000000
+
+long run_structs(int n);
+
+int main()
+{
+    // vec2 grows by 2 per step, pair.a and the triple's sum by 1 per step,
+    // and pair.b settles at 2
+    long expected = 4L * N + 2;
+    return run_structs(N) != expected;
+}
@@ -2,9 +2,11 @@
 
 #include <string>
 
+#include "AST/ASTContext.hpp"
 #include "AST/Decl.hpp"
 #include "AST/Expr.hpp"
 #include "AST/Node.hpp"
+#include "AST/ParseContext.hpp"
 #include "AST/Printer.hpp"
 #include "AST/Stmt.hpp"
 #include "AST/Type.hpp"
@@ -12,5 +14,9 @@
 
 namespace AST
 {
-extern const TranslationUnit *parseAST(const std::string &filename);
+// The returned tree is owned by astContext
+extern const TranslationUnit *
+parseAST(const std::string &filename, ASTContext &astContext);
+extern const TranslationUnit *
+parseSource(const std::string &source, ASTContext &astContext);
 } // namespace AST
\ No newline at end of file
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "AST/Symbol.hpp"
+#include "AST/Type.hpp"
+
+namespace AST
+{
+/**
+ * Hash for the keys types are uniqued on
+ */
+struct TypeKeyHash
+{
+    template <typename... Ts>
+    size_t operator()(const std::tuple<Ts...> &key) const noexcept
+    {
+        size_t seed = 0;
+        std::apply(
+            [&seed](const auto &...elts)
+            { ((seed = combine(seed, hashValue(elts))), ...); },
+            key);
+        return seed;
+    }
+
+    template <typename T>
+    static size_t hashValue(const T &value) noexcept
+    {
+        return std::hash<T>()(value);
+    }
+
+    static size_t hashValue(const Qualifiers &quals) noexcept;
+    static size_t hashValue(const Params &params) noexcept;
+    static size_t hashValue(const EnumConsts &consts) noexcept;
+    static size_t combine(size_t seed, size_t value) noexcept;
+};
+
+/**
+ * Owns every node and type of a translation unit. Nodes and their child
+ * arrays are bump-allocated out of large slabs, so siblings sit next to each
+ * other in memory and the whole tree is released by freeing the slabs. Nodes
+ * are trivially destructible; the few that are not (e.g. those holding names)
+ * register a deallocation callback which runs before the slabs are freed.
+ *
+ * Types are uniqued: each distinct type (including its qualifiers) is created
+ * once, so types are passed around and compared as plain pointers. Identifiers
+ * are interned the same way and handed out as Symbols.
+ */
+class ASTContext
+{
+public:
+    ASTContext() = default;
+    ~ASTContext();
+
+    ASTContext(const ASTContext &) = delete;
+    ASTContext &operator=(const ASTContext &) = delete;
+
+    // Allocates uninitialized memory that lives as long as the context
+    void *allocate(size_t size, size_t align);
+
+    // Constructs a node in the arena
+    template <typename T, typename... Args>
+    T *create(Args &&...args)
+    {
+        void *mem = allocate(sizeof(T), alignof(T));
+        T *node = new (mem) T(std::forward<Args>(args)...);
+
+        if constexpr (!std::is_base_of_v<BaseType, T>)
+        {
+            numNodes_++;
+        }
+
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            addDeallocation(
+                [](void *ptr) { static_cast<T *>(ptr)->~T(); }, node);
+        }
+
+        return node;
+    }
+
+    // Registers a callback to run when the context is destroyed
+    void addDeallocation(void (*callback)(void *), void *data);
+
+    size_t getBytesAllocated() const;
+    size_t getNumNodes() const;
+
+    // Interns an identifier. The empty name maps to the default Symbol.
+    Symbol getIdentifier(std::string_view name);
+    size_t getNumIdentifiers() const;
+
+    // Uniqued types. Pointers, arrays and functions take the qualifiers of
+    // the type they are derived from unless given explicitly.
+    const BasicType *getBasicType(Types type, const Qualifiers &quals = {});
+    const PtrType *getPtrType(const BaseType *type);
+    const PtrType *getPtrType(const BaseType *type, const Qualifiers &quals);
+    const ArrayType *getArrayType(const BaseType *type, size_t size);
+    const ArrayType *
+    getArrayType(const BaseType *type, size_t size, const Qualifiers &quals);
+    const FnType *getFnType(const ParamType *params, const BaseType *retType);
+    const FnType *getFnType(
+        const ParamType *params,
+        const BaseType *retType,
+        const Qualifiers &quals);
+    const ParamType *getParamType(Params types, const Qualifiers &quals = {});
+    const EnumType *getEnumType(
+        const std::string &name,
+        const EnumConsts &consts,
+        const Qualifiers &quals = {});
+    const StructType *getStructType(
+        StructType::Type type,
+        const std::string &name,
+        size_t id,
+        const Qualifiers &quals = {});
+
+    // Struct type for a new declaration, distinct from all existing ones
+    const StructType *
+    createStructType(StructType::Type type, const std::string &name);
+
+    // The same type with its qualifiers replaced
+    const BaseType *
+    getQualifiedType(const BaseType *type, const Qualifiers &quals);
+
+    size_t getNumTypes() const;
+
+private:
+    static constexpr size_t slabSize_ = 64 * 1024;
+
+    void newSlab(size_t minSize);
+
+    template <typename T>
+    using TypeMap = std::unordered_map<T, const BaseType *, TypeKeyHash>;
+
+    // Returns the uniqued type for key. If there is none yet, it is created
+    // with makeType and its canonical type is computed once it is in the map.
+    template <typename T, typename Key, typename MakeType, typename Canonical>
+    const T *getUniqued(
+        TypeMap<Key> &map,
+        Key key,
+        MakeType makeType,
+        Canonical getCanonical)
+    {
+        auto it = map.find(key);
+        if (it != map.end())
+        {
+            return static_cast<const T *>(it->second);
+        }
+
+        T *type = makeType();
+        map.emplace(std::move(key), type);
+        numTypes_++;
+        type->canonical_ = getCanonical(type);
+        return type;
+    }
+
+    std::vector<std::unique_ptr<char[]>> slabs_;
+    char *cur_ = nullptr;
+    char *end_ = nullptr;
+    size_t bytesAllocated_ = 0;
+    size_t numNodes_ = 0;
+    std::vector<std::pair<void (*)(void *), void *>> deallocations_;
+
+    // A deque never moves its elements, so the views and symbols stay valid
+    std::deque<std::string> identifierNames_;
+    std::unordered_map<std::string_view, const std::string *> identifiers_;
+
+    TypeMap<std::tuple<Types, Qualifiers>> basicTypes_;
+    TypeMap<std::tuple<const BaseType *, Qualifiers>> ptrTypes_;
+    TypeMap<std::tuple<const BaseType *, size_t, Qualifiers>> arrayTypes_;
+    TypeMap<std::tuple<const ParamType *, const BaseType *, Qualifiers>>
+        fnTypes_;
+    TypeMap<std::tuple<Params, Qualifiers>> paramTypes_;
+    TypeMap<std::tuple<std::string, EnumConsts, Qualifiers>> enumTypes_;
+    TypeMap<std::tuple<StructType::Type, std::string, size_t, Qualifiers>>
+        structTypes_;
+    size_t numTypes_ = 0;
+};
+} // namespace AST
@@ -17,8 +17,7 @@ class PtrNode;
 class Decl : public virtual BaseNode
 {
 public:
-    virtual ~Decl() = default;
-    virtual std::string getID() const = 0;
+    virtual Symbol getID() const = 0;
 };
 
 /**
@@ -26,11 +25,6 @@ public:
  */
 class TypeDecl : public Decl
 {
-public:
-    virtual ~TypeDecl() = default;
-
-    // Gets the Type object associated with the declaration
-    virtual Ptr<BaseType> getType() const = 0;
 };
 
 /**
@@ -48,13 +42,13 @@ public:
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         return decl_->getID();
     }
 
-    Ptr<Decl> decl_; // Optional
-    Ptr<Expr> size_;
+    const Decl *decl_ = nullptr; // Optional
+    const Expr *size_ = nullptr;
 };
 
 /**
@@ -69,18 +63,13 @@ public:
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         return decl_->getID();
     }
 
-    Ptr<BaseType> getType() const override
-    {
-        return type_->getType();
-    }
-
-    Ptr<TypeDecl> type_;
-    Ptr<Decl> decl_;
+    const TypeDecl *type_ = nullptr;
+    const Decl *decl_ = nullptr;
 };
 
 /**
@@ -92,10 +81,10 @@ class ArrayDecl final : public Node<ArrayDecl>, public Decl
 public:
     ArrayDecl(const Decl *decl, const Expr *size);
 
-    std::string getID() const override;
+    Symbol getID() const override;
 
-    Ptr<Decl> decl_;
-    Ptr<Expr> size_;
+    const Decl *decl_ = nullptr;
+    const Expr *size_ = nullptr;
 };
 
 /**
@@ -109,14 +98,9 @@ public:
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
-        return "";
-    }
-
-    Ptr<BaseType> getType() const override
-    {
-        return std::make_unique<BasicType>(type_);
+        return Symbol();
     }
 
     Types type_;
@@ -133,14 +117,9 @@ class CompoundTypeDecl final : public Node<CompoundTypeDecl>,
 public:
     using NodeList::NodeList;
 
-    std::string getID() const override
-    {
-        return "";
-    }
-
-    Ptr<BaseType> getType() const override
+    Symbol getID() const override
     {
-        return nullptr;
+        return Symbol();
     }
 };
 
@@ -154,15 +133,15 @@ public:
     DeclNode(const TypeDecl *type);
     DeclNode(const TypeDecl *type, const InitDeclList *decl);
 
-    std::string getID() const override
+    Symbol getID() const override
     {
-        return "";
+        return Symbol();
     }
 
-    std::vector<std::string> getIDs() const;
+    std::vector<Symbol> getIDs() const;
 
-    Ptr<TypeDecl> type_;
-    Ptr<InitDeclList> initDeclList_; // Optional
+    const TypeDecl *type_ = nullptr;
+    const InitDeclList *initDeclList_ = nullptr; // Optional
 };
 
 /**
@@ -172,21 +151,16 @@ public:
 class DefinedTypeDecl final : public Node<DefinedTypeDecl>, public TypeDecl
 {
 public:
-    DefinedTypeDecl(std::string name) : name_(std::move(name))
+    DefinedTypeDecl(Symbol name) : name_(name)
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         return name_;
     }
 
-    Ptr<BaseType> getType() const override
-    {
-        return nullptr;
-    }
-
-    std::string name_;
+    Symbol name_;
 };
 
 /**
@@ -197,31 +171,20 @@ class Enum final : public Node<Enum>, public TypeDecl
 {
 public:
     // 1. Definition
-    Enum(std::string name, const EnumMemberList *members)
-        : name_(std::move(name)), members_(members)
-    {
-    }
+    Enum(ASTContext &ctx, Symbol name, const EnumMemberList *members);
     // 2. Anonymous definition
-    Enum(const EnumMemberList *members) : members_(members)
-    {
-    }
+    Enum(ASTContext &ctx, const EnumMemberList *members);
     // 3. Instance
-    Enum(std::string name) : name_(std::move(name))
-    {
-    }
-
-    std::string getID() const override
-    {
-        return "enum " + name_;
-    }
+    Enum(ASTContext &ctx, Symbol name);
 
-    Ptr<BaseType> getType() const override
+    Symbol getID() const override
     {
-        return std::make_unique<EnumType>(name_, EnumConsts());
+        return tag_;
     }
 
-    std::string name_;            // Optional
-    Ptr<EnumMemberList> members_; // Optional
+    Symbol name_;                             // Optional
+    Symbol tag_;                              // e.g. `enum E`
+    const EnumMemberList *members_ = nullptr; // Optional
 };
 
 /**
@@ -231,22 +194,21 @@ public:
 class EnumMember final : public Node<EnumMember>, public Decl
 {
 public:
-    EnumMember(std::string id) : id_(std::move(id))
+    EnumMember(Symbol id) : id_(id)
     {
     }
 
-    EnumMember(std::string id, const Expr *expr)
-        : id_(std::move(id)), expr_(expr)
+    EnumMember(Symbol id, const Expr *expr) : id_(id), expr_(expr)
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         return id_;
     }
 
-    std::string id_;
-    Ptr<Expr> expr_; // Optional
+    Symbol id_;
+    const Expr *expr_ = nullptr; // Optional
 };
 
 /**
@@ -267,23 +229,18 @@ public:
 class FnDecl final : public Node<FnDecl>, public Decl
 {
 public:
-    FnDecl(const Decl *decl)
-        : decl_(decl), params_(std::make_unique<ParamList>())
-    {
-    }
-
     FnDecl(const Decl *decl, const ParamList *params)
         : decl_(decl), params_(params)
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         return decl_->getID();
     }
 
-    Ptr<Decl> decl_;
-    Ptr<ParamList> params_;
+    const Decl *decl_ = nullptr;
+    const ParamList *params_ = nullptr;
 };
 
 /**
@@ -295,11 +252,11 @@ class FnDef final : public Node<FnDef>, public Decl
 public:
     FnDef(const TypeDecl *retType, const Decl *decl, const CompoundStmt *body);
 
-    std::string getID() const override;
+    Symbol getID() const override;
 
-    Ptr<TypeDecl> retType_;
-    Ptr<Decl> decl_;
-    Ptr<CompoundStmt> body_;
+    const TypeDecl *retType_ = nullptr;
+    const Decl *decl_ = nullptr;
+    const CompoundStmt *body_ = nullptr;
 };
 
 /**
@@ -312,10 +269,10 @@ public:
     InitDecl(const Decl *decl);
     InitDecl(const Decl *decl, const Init *init);
 
-    std::string getID() const override;
+    Symbol getID() const override;
 
-    Ptr<Decl> decl_;
-    Ptr<Init> init_;
+    const Decl *decl_ = nullptr;
+    const Init *init_ = nullptr;
 };
 
 /**
@@ -343,18 +300,18 @@ public:
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         if (decl_)
         {
             return decl_->getID();
         }
 
-        return "";
+        return Symbol();
     }
 
-    Ptr<TypeDecl> type_;
-    Ptr<Decl> decl_; // Optional
+    const TypeDecl *type_ = nullptr;
+    const Decl *decl_ = nullptr; // Optional
 };
 
 /**
@@ -378,13 +335,13 @@ public:
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         return decl_->getID();
     }
 
-    Ptr<PtrNode> ptr_;
-    Ptr<Decl> decl_;
+    const PtrNode *ptr_ = nullptr;
+    const Decl *decl_ = nullptr;
 };
 
 /**
@@ -399,9 +356,9 @@ public:
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
-        return "";
+        return Symbol();
     }
 
     unsigned int getPointerLevel() const
@@ -409,7 +366,7 @@ public:
         return ptr_ ? ptr_->getPointerLevel() + 1 : 1;
     }
 
-    Ptr<PtrNode> ptr_;
+    const PtrNode *ptr_ = nullptr;
 };
 
 /**
@@ -421,26 +378,25 @@ public:
     using Type = StructType::Type;
 
     // 1. Definition
-    Struct(Type type, std::string name, const StructMemberList *members);
+    Struct(
+        ASTContext &ctx,
+        Type type,
+        Symbol name,
+        const StructMemberList *members);
     // 2. Anonymous declaration
-    Struct(Type type, const StructMemberList *members);
+    Struct(ASTContext &ctx, Type type, const StructMemberList *members);
     // 3. Instance
-    Struct(Type type, std::string name);
+    Struct(ASTContext &ctx, Type type, Symbol name);
 
-    std::string getID() const override
+    Symbol getID() const override
     {
-        auto st = StructType(type_, name_);
-        return st.getName();
+        return tag_;
     }
 
-    Ptr<BaseType> getType() const override
-    {
-        return std::make_unique<StructType>(type_, name_);
-    };
-
     Type type_;
-    std::string name_;              // Optional
-    Ptr<StructMemberList> members_; // Optional
+    Symbol name_;                               // Optional
+    Symbol tag_;                                // e.g. `struct.S`
+    const StructMemberList *members_ = nullptr; // Optional
 };
 
 /**
@@ -454,12 +410,12 @@ public:
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         return decl_->getID();
     }
 
-    Ptr<Decl> decl_;
+    const Decl *decl_ = nullptr;
 };
 
 /**
@@ -485,8 +441,8 @@ public:
     {
     }
 
-    Ptr<TypeDecl> type_;
-    Ptr<StructDeclList> declList_;
+    const TypeDecl *type_ = nullptr;
+    const StructDeclList *declList_ = nullptr;
 };
 
 /**
@@ -522,17 +478,12 @@ public:
     {
     }
 
-    std::string getID() const override
-    {
-        return "";
-    }
-
-    Ptr<BaseType> getType() const override
+    Symbol getID() const override
     {
-        return type_->getType();
+        return Symbol();
     }
 
-    Ptr<TypeDecl> type_;
+    const TypeDecl *type_ = nullptr;
 };
 
 /**
@@ -586,14 +537,9 @@ public:
     {
     }
 
-    std::string getID() const override
-    {
-        return "";
-    }
-
-    Ptr<BaseType> getType() const override
+    Symbol getID() const override
     {
-        return nullptr;
+        return Symbol();
     }
 
     std::variant<
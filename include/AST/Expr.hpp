@@ -39,8 +39,6 @@ struct EvalType
 class Expr : public Stmt
 {
 public:
-    virtual ~Expr() = default;
-
     virtual bool isLValue() const
     {
         return false;
@@ -78,8 +76,8 @@ public:
         return true;
     }
 
-    Ptr<Expr> arr_;
-    Ptr<Expr> index_;
+    const Expr *arr_ = nullptr;
+    const Expr *index_ = nullptr;
 };
 
 /**
@@ -109,8 +107,8 @@ public:
     {
     }
 
-    Ptr<Expr> lhs_;
-    Ptr<Expr> rhs_;
+    const Expr *lhs_ = nullptr;
+    const Expr *rhs_ = nullptr;
     Op op_;
 };
 
@@ -146,9 +144,11 @@ public:
     BinaryOp(const Expr *lhs, const Expr *rhs, Op op);
 
     EvalType eval() const override;
+    // Applies the operator to operands that were already evaluated
+    EvalType fold(const EvalType &l, const EvalType &r) const;
 
-    Ptr<Expr> lhs_;
-    Ptr<Expr> rhs_;
+    const Expr *lhs_ = nullptr;
+    const Expr *rhs_ = nullptr;
     Op op_;
 };
 
@@ -163,8 +163,8 @@ public:
     {
     }
 
-    Ptr<TypeDecl> type_;
-    Ptr<Expr> expr_;
+    const TypeDecl *type_ = nullptr;
+    const Expr *expr_ = nullptr;
 };
 
 /**
@@ -177,6 +177,7 @@ public:
     Constant(std::string value);
 
     EvalType eval() const override;
+    bool isFloating() const;
 
     char getChar() const;
 
@@ -200,8 +201,8 @@ public:
     {
     }
 
-    Ptr<Expr> fn_;
-    Ptr<ArgExprList> args_;
+    const Expr *fn_ = nullptr;
+    const ArgExprList *args_ = nullptr;
 };
 
 /**
@@ -211,11 +212,11 @@ public:
 class Identifier final : public Node<Identifier>, public Decl, public Expr
 {
 public:
-    Identifier(std::string name) : name_(std::move(name))
+    Identifier(Symbol name) : name_(name)
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         return name_;
     }
@@ -225,7 +226,7 @@ public:
         return true;
     }
 
-    std::string name_;
+    Symbol name_;
 };
 
 /**
@@ -239,7 +240,7 @@ public:
     {
     }
 
-    Ptr<Expr> expr_;
+    const Expr *expr_ = nullptr;
 };
 
 /**
@@ -271,13 +272,13 @@ public:
     {
     }
 
-    std::string getID() const override
+    Symbol getID() const override
     {
         if (decl_)
         {
             return decl_->getID();
         }
-        return "";
+        return Symbol();
     }
 
     bool isLValue() const override
@@ -301,8 +302,8 @@ public:
         return {};
     }
 
-    Ptr<Decl> decl_; // Optional
-    Ptr<Expr> expr_; // Optional
+    const Decl *decl_ = nullptr; // Optional
+    const Expr *expr_ = nullptr; // Optional
 };
 
 /**
@@ -320,8 +321,8 @@ public:
     {
     }
 
-    Ptr<Expr> expr_;
-    Ptr<TypeDecl> type_;
+    const Expr *expr_ = nullptr;
+    const TypeDecl *type_ = nullptr;
 };
 
 /**
@@ -346,7 +347,7 @@ public:
 class StructAccess final : public Node<StructAccess>, public Expr
 {
 public:
-    StructAccess(const Expr *expr, std::string member)
+    StructAccess(const Expr *expr, Symbol member)
         : expr_(expr), member_(member)
     {
     }
@@ -358,8 +359,8 @@ public:
         return expr_->isLValue();
     }
 
-    Ptr<Expr> expr_;
-    std::string member_;
+    const Expr *expr_ = nullptr;
+    Symbol member_;
 };
 
 /**
@@ -369,7 +370,7 @@ public:
 class StructPtrAccess final : public Node<StructPtrAccess>, public Expr
 {
 public:
-    StructPtrAccess(const Expr *expr, std::string member)
+    StructPtrAccess(const Expr *expr, Symbol member)
         : expr_(expr), member_(member)
     {
     }
@@ -379,8 +380,8 @@ public:
         return true;
     }
 
-    Ptr<Expr> expr_;
-    std::string member_;
+    const Expr *expr_ = nullptr;
+    Symbol member_;
 };
 
 /**
@@ -395,9 +396,9 @@ public:
     {
     }
 
-    Ptr<Expr> cond_;
-    Ptr<Expr> lhs_;
-    Ptr<Expr> rhs_;
+    const Expr *cond_ = nullptr;
+    const Expr *lhs_ = nullptr;
+    const Expr *rhs_ = nullptr;
 };
 
 /**
@@ -431,8 +432,10 @@ public:
     }
 
     EvalType eval() const override;
+    // Applies the operator to an operand that was already evaluated
+    EvalType fold(const EvalType &e) const;
 
-    Ptr<Expr> expr_;
+    const Expr *expr_ = nullptr;
     Op op_;
 };
 
@@ -1,29 +1,29 @@
 #pragma once
 
+#include <algorithm>
 #include <iostream>
+#include <iterator>
 #include <memory>
+#include <type_traits>
 #include <variant>
-#include <vector>
 
+#include "AST/ASTContext.hpp"
 #include "AST/Visitor.hpp"
 
 namespace AST
 {
-class BaseNode;
-using NodePtr = std::unique_ptr<const BaseNode>;
-
-template <typename T>
-using Ptr = std::unique_ptr<const T>;
-
 /**
  *  Base class for nodes in the AST. Only contains virtual functions.
  *  This is the standard interface for all nodes and only contains the functions
  *  that all nodes must implement.
+ *
+ *  Nodes are owned by an ASTContext and are never deleted through a base
+ *  pointer, so the destructor is deliberately non-virtual. This keeps most
+ *  nodes trivially destructible.
  */
 class BaseNode
 {
 public:
-    virtual ~BaseNode() = default;
     virtual void accept(Visitor &visitor) const = 0;
 };
 
@@ -34,8 +34,6 @@ template <typename Derived>
 class Node : public virtual BaseNode
 {
 public:
-    virtual ~Node() = default;
-
     void accept(Visitor &visitor) const override
     {
         visitor.visit(static_cast<const Derived &>(*this));
@@ -46,6 +44,88 @@ private:
     friend Derived;
 };
 
+/**
+ * Growable array whose storage lives in an ASTContext. Like std::vector, but
+ * never frees: when it grows, the old storage is left in the arena. Elements
+ * must be trivially destructible.
+ */
+template <typename T>
+class ASTVector
+{
+public:
+    static_assert(std::is_trivially_destructible_v<T>);
+
+    const T *begin() const
+    {
+        return begin_;
+    }
+
+    const T *end() const
+    {
+        return begin_ + size_;
+    }
+
+    std::reverse_iterator<const T *> rbegin() const
+    {
+        return std::reverse_iterator<const T *>(end());
+    }
+
+    std::reverse_iterator<const T *> rend() const
+    {
+        return std::reverse_iterator<const T *>(begin());
+    }
+
+    size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    const T &operator[](size_t i) const
+    {
+        return begin_[i];
+    }
+
+    const T &front() const
+    {
+        return begin_[0];
+    }
+
+    const T &back() const
+    {
+        return begin_[size_ - 1];
+    }
+
+    void push_back(ASTContext &ctx, const T &elt)
+    {
+        if (size_ == capacity_)
+        {
+            grow(ctx);
+        }
+
+        new (begin_ + size_++) T(elt);
+    }
+
+private:
+    void grow(ASTContext &ctx)
+    {
+        size_t capacity = capacity_ ? capacity_ * 2 : 4;
+        T *storage =
+            static_cast<T *>(ctx.allocate(capacity * sizeof(T), alignof(T)));
+        std::uninitialized_copy(begin_, begin_ + size_, storage);
+        begin_ = storage;
+        capacity_ = capacity;
+    }
+
+    T *begin_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
+
 /**
  * Base class for nodes that contain a list of nodes
  */
@@ -56,33 +136,31 @@ public:
     NodeList() = default;
 
     template <typename T>
-    NodeList(const T *node)
+    NodeList(ASTContext &ctx, const T *node)
     {
-        pushBack(node);
+        pushBack(ctx, node);
     }
 
-    ~NodeList() = default;
-
     template <typename T>
-    void pushBack(const T *node)
+    void pushBack(ASTContext &ctx, const T *node)
     {
         if constexpr (std::is_same_v<T, std::variant<Ts *...>>)
         {
             std::visit(
-                [this](auto *arg)
+                [this, &ctx](auto *arg)
                 {
                     using U = std::remove_pointer_t<decltype(arg)>;
-                    nodes_.push_back(std::unique_ptr<const U>(arg));
+                    nodes_.push_back(ctx, static_cast<const U *>(arg));
                 },
                 *node);
         }
         else
         {
-            nodes_.push_back(std::unique_ptr<const T>(node));
+            nodes_.push_back(ctx, node);
         }
     }
 
-    std::vector<std::variant<std::unique_ptr<const Ts>...>> nodes_;
+    ASTVector<std::variant<const Ts *...>> nodes_;
 };
 
 // Helper class to visit multiple lambdas
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "AST/ASTContext.hpp"
+
+namespace AST
+{
+// Forward declarations
+class TranslationUnit;
+
+/**
+ * State owned by a single parse. Holds the typedef names for the lexer hack
+ * (scoped by compound statement), the root of the parsed tree and the first
+ * syntax error. One is
+ * created per translation unit, so several files can be parsed concurrently.
+ * Nodes are allocated in the ASTContext, which outlives the parse.
+ */
+class ParseContext
+{
+public:
+    ParseContext(ASTContext &astContext);
+
+    ASTContext &getASTContext();
+
+    template <typename T, typename... Args>
+    T *create(Args &&...args)
+    {
+        return astContext_.create<T>(std::forward<Args>(args)...);
+    }
+
+    // Interns an identifier in the ASTContext
+    Symbol getIdentifier(std::string_view name);
+
+    void addTypedef(Symbol name);
+    bool isTypedef(Symbol name) const;
+    void pushScope();
+    void popScope();
+
+    void setRoot(const TranslationUnit *root);
+    const TranslationUnit *getRoot() const;
+
+    // Only the first error is kept, later ones are usually caused by it
+    void setError(std::string_view message);
+    bool hasError() const;
+    const std::string &getError() const;
+
+private:
+    ASTContext &astContext_;
+    std::vector<std::unordered_set<Symbol>> typedefScopes_;
+    const TranslationUnit *root_ = nullptr;
+    std::string error_;
+};
+} // namespace AST
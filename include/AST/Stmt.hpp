@@ -9,8 +9,6 @@ class Expr;
 
 class Stmt : public virtual BaseNode
 {
-public:
-    virtual ~Stmt() = default;
 };
 
 class BlockItemList final : public NodeList<DeclNode, Stmt>,
@@ -32,7 +30,7 @@ public:
 
 /**
  * Case statement
- * e.g. `case 1:` or `default:`
+ * e.g. `case 1:`, `case 'a' ... 'z':` or `default:`
  */
 class Case final : public Node<Case>, public Stmt
 {
@@ -43,9 +41,14 @@ public:
     Case(const Expr *expr, const Stmt *body) : expr_(expr), body_(body)
     {
     }
+    Case(const Expr *expr, const Expr *rangeEnd, const Stmt *body)
+        : expr_(expr), rangeEnd_(rangeEnd), body_(body)
+    {
+    }
 
-    Ptr<Expr> expr_; // Optional
-    Ptr<Stmt> body_;
+    const Expr *expr_ = nullptr;     // Optional
+    const Expr *rangeEnd_ = nullptr; // Optional, GNU extension
+    const Stmt *body_ = nullptr;
 };
 
 /**
@@ -60,7 +63,7 @@ public:
     {
     }
 
-    Ptr<BlockItemList> nodes_; // Optional
+    const BlockItemList *nodes_ = nullptr; // Optional
 };
 
 /**
@@ -84,8 +87,8 @@ public:
     {
     }
 
-    Ptr<Stmt> body_;
-    Ptr<Expr> cond_;
+    const Stmt *body_ = nullptr;
+    const Expr *cond_ = nullptr;
 };
 
 /**
@@ -100,7 +103,7 @@ public:
     {
     }
 
-    Ptr<Expr> expr_; // Optional
+    const Expr *expr_ = nullptr; // Optional
 };
 
 /**
@@ -111,7 +114,7 @@ class For final : public Node<For>, public Stmt
 {
 public:
     For(const Stmt *init, const ExprStmt *cond, const Stmt *body)
-        : init_(Ptr<Stmt>(init)), cond_(cond), body_(body)
+        : init_(init), cond_(cond), body_(body)
     {
     }
 
@@ -119,12 +122,12 @@ public:
         const ExprStmt *cond,
         const Expr *expr,
         const Stmt *body)
-        : init_(Ptr<Stmt>(init)), cond_(cond), expr_(expr), body_(body)
+        : init_(init), cond_(cond), expr_(expr), body_(body)
     {
     }
 
     For(const DeclNode *init, const ExprStmt *cond, const Stmt *body)
-        : init_(Ptr<DeclNode>(init)), cond_(cond), body_(body)
+        : init_(init), cond_(cond), body_(body)
     {
     }
 
@@ -132,14 +135,14 @@ public:
         const ExprStmt *cond,
         const Expr *expr,
         const Stmt *body)
-        : init_(Ptr<DeclNode>(init)), cond_(cond), expr_(expr), body_(body)
+        : init_(init), cond_(cond), expr_(expr), body_(body)
     {
     }
 
-    std::variant<Ptr<Stmt>, Ptr<DeclNode>> init_;
-    Ptr<ExprStmt> cond_;
-    Ptr<Expr> expr_; // Optional
-    Ptr<Stmt> body_;
+    std::variant<const Stmt *, const DeclNode *> init_;
+    const ExprStmt *cond_ = nullptr;
+    const Expr *expr_ = nullptr; // Optional
+    const Stmt *body_ = nullptr;
 };
 
 /**
@@ -159,9 +162,9 @@ public:
     {
     }
 
-    Ptr<Expr> cond_;
-    Ptr<Stmt> thenStmt_;
-    Ptr<Stmt> elseStmt_; // Optional
+    const Expr *cond_ = nullptr;
+    const Stmt *thenStmt_ = nullptr;
+    const Stmt *elseStmt_ = nullptr; // Optional
 };
 
 /**
@@ -176,7 +179,7 @@ public:
     {
     }
 
-    Ptr<Expr> expr_; // Optional
+    const Expr *expr_ = nullptr; // Optional
 };
 
 /**
@@ -190,8 +193,8 @@ public:
     {
     }
 
-    Ptr<Expr> expr_;
-    Ptr<Stmt> body_;
+    const Expr *expr_ = nullptr;
+    const Stmt *body_ = nullptr;
 };
 
 /**
@@ -205,8 +208,8 @@ public:
     {
     }
 
-    Ptr<Expr> cond_;
-    Ptr<Stmt> body_;
+    const Expr *cond_ = nullptr;
+    const Stmt *body_ = nullptr;
 };
 
 } // namespace AST
\ No newline at end of file
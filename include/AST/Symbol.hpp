@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+
+namespace AST
+{
+/**
+ * Handle to an identifier interned in an ASTContext. Each distinct name is
+ * stored once per translation unit, so symbols are compared and hashed as
+ * pointers instead of strings. The default symbol is the empty name.
+ *
+ * The default constructor is trivial so a symbol can be held in the parser's
+ * semantic value union; value-initialize it (`Symbol()`) to get the empty name.
+ */
+class Symbol
+{
+public:
+    Symbol() = default;
+
+    const std::string &getName() const noexcept
+    {
+        static const std::string emptyName;
+        return name_ ? *name_ : emptyName;
+    }
+
+    bool empty() const noexcept
+    {
+        return name_ == nullptr;
+    }
+
+    bool operator==(Symbol other) const noexcept
+    {
+        return name_ == other.name_;
+    }
+    bool operator!=(Symbol other) const noexcept
+    {
+        return name_ != other.name_;
+    }
+
+    size_t hash() const noexcept
+    {
+        return std::hash<const std::string *>()(name_);
+    }
+
+private:
+    friend class ASTContext;
+
+    explicit Symbol(const std::string *name) : name_(name)
+    {
+    }
+
+    const std::string *name_;
+};
+
+inline std::ostream &operator<<(std::ostream &os, Symbol symbol)
+{
+    return os << symbol.getName();
+}
+} // namespace AST
+
+template <>
+struct std::hash<AST::Symbol>
+{
+    size_t operator()(AST::Symbol symbol) const noexcept
+    {
+        return symbol.hash();
+    }
+};
@@ -1,16 +1,17 @@
 #pragma once
 
+#include <atomic>
 #include <iostream>
-#include <memory>
 #include <optional>
+#include <string>
 #include <vector>
 
+#include "AST/Symbol.hpp"
+
 namespace AST
 {
-template <typename T>
-using Ptr = std::unique_ptr<const T>;
-
 // Forward declarations
+class ASTContext;
 class Decl;
 class ParamType;
 class StructDeclList;
@@ -20,7 +21,24 @@ enum class Linkage;
 enum class StorageDuration;
 
 /**
- * Base class for types.
+ * Qualifiers and storage information attached to a type. They are part of the
+ * identity of a uniqued type, but are ignored when comparing types.
+ */
+struct Qualifiers
+{
+    std::optional<CVRQualifier> cvrQualifier;
+    std::optional<FunctionSpecifier> functionSpecifier;
+    std::optional<Linkage> linkage;
+    std::optional<StorageDuration> storageDuration;
+
+    bool empty() const noexcept;
+    bool operator==(const Qualifiers &other) const noexcept;
+};
+
+/**
+ * Base class for types. Types are immutable and uniqued by the ASTContext, so
+ * there is exactly one instance of each distinct type and they are passed
+ * around as plain pointers.
  */
 class BaseType
 {
@@ -36,17 +54,35 @@ public:
         StructTyID
     };
 
-    BaseType(TypeID tid);
-    BaseType(const BaseType &other);
-    virtual ~BaseType() = default;
-    virtual bool operator==(const BaseType &other) const = 0;
-    virtual bool operator!=(const BaseType &other) const = 0;
+    BaseType(const BaseType &) = delete;
+    BaseType &operator=(const BaseType &) = delete;
+
+    // Types are equal if they only differ in qualifiers (and arrays compare
+    // equal to pointers to their element type). This is a pointer compare.
+    bool operator==(const BaseType &other) const noexcept
+    {
+        return canonical_ == other.canonical_;
+    }
+    bool operator!=(const BaseType &other) const noexcept
+    {
+        return canonical_ != other.canonical_;
+    }
 
     // Compatibility operator. Says nothing about truncation.
     virtual bool operator<(const BaseType &other) const = 0;
-    virtual bool operator<=(const BaseType &other) const = 0;
-    virtual Ptr<BaseType> clone() const = 0;
+    bool operator<=(const BaseType &other) const
+    {
+        return *this == other || *this < other;
+    }
+
     size_t getID() const noexcept;
+    Qualifiers getQualifiers() const noexcept;
+
+    // The unqualified type used for comparisons
+    const BaseType *getCanonicalType() const noexcept
+    {
+        return canonical_;
+    }
 
     bool isArrayTy() const
     {
@@ -83,58 +119,34 @@ public:
 
     size_t id_;
     TypeID tid_;
-    static size_t idProvider_;
-
-    // Qualifiers (mutable because we use Ptr<> everywhere and cba)
-    mutable std::optional<CVRQualifier> cvrQualifier_ = std::nullopt;
-    mutable std::optional<FunctionSpecifier> functionSpecifier_ = std::nullopt;
-    mutable std::optional<Linkage> linkage_ = std::nullopt;
-    mutable std::optional<StorageDuration> storageDuration_ = std::nullopt;
-};
-
-template <typename Derived>
-class Type : public virtual BaseType
-{
-public:
-    virtual ~Type() = default;
-    Ptr<BaseType> clone() const override
-    {
-        return cloneAsDerived();
-    }
-
-    Ptr<Derived> cloneAsDerived() const
-    {
-        return std::make_unique<Derived>(static_cast<const Derived &>(*this));
-    }
-
-    bool operator==(const BaseType &other) const override
-    {
-        if (auto otherType = dynamic_cast<const Derived *>(&other))
-        {
-            return static_cast<const Derived &>(*this) == *otherType;
-        }
-
-        return false;
-    }
+    static std::atomic<size_t> idProvider_;
 
-    bool operator!=(const BaseType &other) const override
-    {
-        return !(*this == other);
-    }
+    // Qualifiers
+    const std::optional<CVRQualifier> cvrQualifier_;
+    const std::optional<FunctionSpecifier> functionSpecifier_;
+    const std::optional<Linkage> linkage_;
+    const std::optional<StorageDuration> storageDuration_;
 
-    bool operator<=(const BaseType &other) const override
-    {
-        return *this == other || *this < other;
-    }
-
-    virtual bool operator==(const Derived &other) const = 0;
+protected:
+    BaseType(TypeID tid, const Qualifiers &quals);
 
 private:
-    Type() = default;
-    Type(const Type &) = default;
-    friend Derived;
+    friend class ASTContext;
+
+    // Set once by the ASTContext
+    const BaseType *canonical_ = nullptr;
 };
 
+/**
+ * Downcast checked on the TypeID, for use instead of dynamic_cast. Returns
+ * nullptr if type is not a T (or is nullptr).
+ */
+template <typename T>
+const T *dynCast(const BaseType *type) noexcept
+{
+    return type && T::classof(type) ? static_cast<const T *>(type) : nullptr;
+}
+
 /**
  * Standard types
  */
@@ -208,101 +220,128 @@ enum class FunctionSpecifier
  * Basic types
  * e.g. `int`, `float`, `char`
  */
-class BasicType final : public Type<BasicType>
+class BasicType final : public BaseType
 {
 public:
-    BasicType(Types type);
-    BasicType(
-        Types type,
-        std::optional<CVRQualifier> cvrQualifier,
-        std::optional<FunctionSpecifier> functionSpecifier,
-        std::optional<Linkage> linkage,
-        std::optional<StorageDuration> storageDuration);
-    BasicType(const BasicType &other);
-
-    bool operator==(const BasicType &other) const override;
+    static bool classof(const BaseType *type) noexcept
+    {
+        return type->isBaseTy();
+    }
+
     bool operator<(const BaseType &other) const override;
 
     bool isSigned() const noexcept;
+    static bool isSigned(Types type) noexcept;
 
     Types type_;
+
+private:
+    friend class ASTContext;
+    BasicType(Types type, const Qualifiers &quals);
 };
 
-using EnumConsts = std::vector<std::pair<std::string, int>>;
+using EnumConsts = std::vector<std::pair<Symbol, int>>;
 
 /**
  * Enum types
  */
-class EnumType final : public Type<EnumType>
+class EnumType final : public BaseType
 {
 public:
-    EnumType(std::string name, EnumConsts consts);
-    EnumType(const EnumType &other);
+    static bool classof(const BaseType *type) noexcept
+    {
+        return type->isEnumTy();
+    }
 
-    bool operator==(const EnumType &other) const override;
     bool operator<(const BaseType &other) const override;
 
     std::string name_;
     EnumConsts consts_;
+
+private:
+    friend class ASTContext;
+    EnumType(std::string name, EnumConsts consts, const Qualifiers &quals);
 };
 
 /**
  * Function types
  * e.g. `void (*)(int)`
  */
-class FnType final : public Type<FnType>
+class FnType final : public BaseType
 {
 public:
-    FnType(Ptr<ParamType> params, Ptr<BaseType> retType);
-    FnType(const FnType &other);
+    static bool classof(const BaseType *type) noexcept
+    {
+        return type->isFnTy();
+    }
 
-    bool operator==(const FnType &other) const override;
     bool operator<(const BaseType &other) const override;
 
-    std::string getParamName(size_t i) const noexcept;
+    Symbol getParamName(size_t i) const noexcept;
     const BaseType *getParamType(size_t i) const noexcept;
 
-    Ptr<ParamType> params_;
-    Ptr<BaseType> retType_;
+    const ParamType *params_;
+    const BaseType *retType_;
+
+private:
+    friend class ASTContext;
+    FnType(
+        const ParamType *params,
+        const BaseType *retType,
+        const Qualifiers &quals);
 };
 
-using Params = std::vector<std::pair<std::string, Ptr<BaseType>>>;
+using Params = std::vector<std::pair<Symbol, const BaseType *>>;
 
 /**
  * Parameter types (intermediate type)
  */
-class ParamType final : public Type<ParamType>
+class ParamType final : public BaseType
 {
 public:
-    ParamType(Params types);
-    ParamType(const ParamType &other);
+    static bool classof(const BaseType *type) noexcept
+    {
+        return type->isParamTy();
+    }
 
-    bool operator==(const ParamType &other) const override;
     bool operator<(const BaseType &other) const override;
 
     size_t size() const noexcept;
     const BaseType *at(size_t i) const;
 
-    Ptr<BaseType> getMemberType(std::string name) const;
-    unsigned getMemberIndex(std::string name) const;
+    const BaseType *getMemberType(Symbol name) const;
+    unsigned getMemberIndex(Symbol name) const;
 
     Params types_;
+
+private:
+    friend class ASTContext;
+    ParamType(Params types, const Qualifiers &quals);
 };
 
 /**
  * Pointer types
  * e.g. `int *`
  */
-class PtrType : public Type<PtrType>
+class PtrType : public BaseType
 {
 public:
-    PtrType(Ptr<BaseType> type);
-    PtrType(const PtrType &other);
+    // Arrays are pointers too
+    static bool classof(const BaseType *type) noexcept
+    {
+        return type->isArrayOrPtrTy();
+    }
 
-    bool operator==(const PtrType &other) const override;
     virtual bool operator<(const BaseType &other) const override;
 
-    Ptr<BaseType> type_;
+    const BaseType *type_;
+
+protected:
+    friend class ASTContext;
+    PtrType(
+        const BaseType *type,
+        const Qualifiers &quals,
+        TypeID tid = PtrTyID);
 };
 
 /**
@@ -312,50 +351,55 @@ public:
 class ArrayType final : public PtrType
 {
 public:
-    ArrayType(Ptr<BaseType> type, size_t size);
-    ArrayType(const ArrayType &other);
-
-    Ptr<BaseType> clone() const override
+    static bool classof(const BaseType *type) noexcept
     {
-        return cloneAsDerived();
+        return type->isArrayTy();
     }
 
-    Ptr<ArrayType> cloneAsDerived() const
-    {
-        return std::make_unique<ArrayType>(
-            static_cast<const ArrayType &>(*this));
-    }
-
-    bool operator==(const ArrayType &other) const;
     bool operator<(const BaseType &other) const override;
 
     size_t size_;
+
+private:
+    friend class ASTContext;
+    ArrayType(const BaseType *type, size_t size, const Qualifiers &quals);
 };
 
 /**
  * Struct types
  * Most of the parameter logic belongs in the type checker
  */
-class StructType final : public Type<StructType>
+class StructType final : public BaseType
 {
 public:
+    static bool classof(const BaseType *type) noexcept
+    {
+        return type->isStructTy();
+    }
+
     enum class Type
     {
         STRUCT,
         UNION
     };
 
-    // Used for forward declarations/self-references
-    StructType(Type type, std::string name, size_t id = -1);
-    StructType(const StructType &other);
-
-    bool operator==(const StructType &other) const override;
     bool operator<(const BaseType &other) const override;
 
     std::string getName() const noexcept;
+    static std::string getName(Type type, const std::string &name);
 
     Type type_;
     std::string name_;
+
+private:
+    friend class ASTContext;
+    // The ID identifies the declaration (used for forward declarations and
+    // self-references), -1 allocates a new one
+    StructType(
+        Type type,
+        std::string name,
+        size_t id,
+        const Qualifiers &quals);
 };
 
-} // namespace AST
\ No newline at end of file
+} // namespace AST
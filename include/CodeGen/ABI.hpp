@@ -2,6 +2,8 @@
 
 #include "AST/Type.hpp"
 
+#include <memory>
+
 #include "llvm/IR/Module.h"
 #include "llvm/IR/IRBuilder.h"
 
@@ -22,6 +24,9 @@ class ABI
 public:
     virtual ~ABI() = default;
 
+    // The ABI of the module's target triple, x86-64 if it is not recognised
+    static std::unique_ptr<ABI> create(llvm::Module &module);
+
     struct FunctionParamsInfo
     {
         llvm::Type *retType;
@@ -37,8 +42,13 @@ public:
         std::vector<llvm::Type *> &paramTypes) const = 0;
     virtual std::vector<llvm::Type *> getParamType(llvm::Type *type) const = 0;
     virtual llvm::Align getTypeAlign(llvm::Type *type) const = 0;
+    // In bits, as stored in the LLVM type (80 for x87 long double)
     virtual unsigned getTypeSize(AST::Types type) const = 0;
     virtual bool useByVal() const = 0;
+
+    // The LLVM type of a basic type. Its size and alignment in memory come
+    // from the module's DataLayout
+    llvm::Type *getLLVMType(AST::Types type, llvm::LLVMContext &context) const;
 };
 
 
@@ -6,6 +6,8 @@
 
 #include "AST/Visitor.hpp"
 #include "CodeGen/AArch64ABI.hpp"
+#include "CodeGen/ScopedSymbolTable.hpp"
+#include "CodeGen/TargetMachineCache.hpp"
 #include "CodeGen/TypeChecker.hpp"
 #include "CodeGen/X86_64ABI.hpp"
 
@@ -24,7 +26,21 @@ using Symbol = std::variant<
     llvm::Constant *,
     llvm::GlobalVariable *,
     std::monostate>;
-using SymbolTable = std::vector<std::unordered_map<std::string, Symbol>>;
+// Scopes are keyed on interned identifiers, not strings
+using SymbolTable = ScopedSymbolTable<AST::Symbol, Symbol>;
+
+/**
+ * Optimisation level requested on the command line (-O0, -O1, ..., -Os).
+ * Controls both the IR pipeline and instruction selection.
+ */
+enum class OptLevel
+{
+    O0,
+    O1,
+    O2,
+    O3,
+    Os
+};
 
 class CodeGenModule : public Visitor
 {
@@ -32,12 +48,19 @@ public:
     CodeGenModule(
         std::string sourceFile,
         std::string outputFile,
+        ASTContext &astContext,
         NodeMap &nodeMap,
         StructMap &structMap,
-        std::string targetTriple);
+        ConstantMap &constantMap,
+        std::string targetTriple,
+        OptLevel optLevel = OptLevel::O0);
     void emitLLVM();
     void emitObject();
-    void optimize();
+    // Emits the object code to a stream instead of the output file
+    void emitObject(llvm::raw_pwrite_stream &os);
+    // If passTimings is given, a time report for each pass is printed to it
+    void optimize(llvm::raw_ostream *passTimings = nullptr);
+    size_t getNumInstructions() const;
 
     // Declarations
     void visit(const AbstractArrayDecl &node) override;
@@ -80,10 +103,11 @@ public:
     void visit(const Identifier &node) override;
     void visit(const Init &node) override;
     void visit(const InitList &node) override;
-    void visitRecursiveStore(
-        const InitList &node,
-        std::vector<llvm::Value *> indices);
+    void visitRecursiveStore(const InitList &node);
     llvm::Constant *visitRecursiveConst(const InitList &node);
+    bool isDataArrayInit(const InitList &node, const ArrayType *arrType);
+    llvm::Constant *
+    visitDataArrayConst(const InitList &node, const ArrayType *arrType);
     void visit(const Paren &node) override;
     void visit(const SizeOf &node) override;
     void visit(const StringLiteral &node) override;
@@ -114,15 +138,38 @@ private:
         FN_DESIGNATOR
     };
 
+    // An element of an aggregate initializer that is not a constant
+    struct DynamicInit
+    {
+        std::vector<llvm::Value *> indices; // From the aggregate, for a GEP
+        const Init *init;
+        const BaseType *type;
+    };
+
+    // A GNU case range too large to list in the switch, e.g. `case 0 ... 999:`
+    struct CaseRange
+    {
+        int64_t low;
+        int64_t high;
+        llvm::BasicBlock *dest;
+    };
+
+    // Constant stores into an aggregate, each with its GEP indices
+    using InitStores =
+        std::vector<std::pair<std::vector<llvm::Value *>, llvm::Constant *>>;
+
     std::string outputFile_;
+    ASTContext &astContext_;
     NodeMap &nodeMap_;
     StructMap &structMap_;
+    ConstantMap &constantMap_;
 
     std::unique_ptr<llvm::LLVMContext> context_;
     std::unique_ptr<llvm::IRBuilder<>> builder_;
     std::unique_ptr<llvm::Module> module_;
     std::unique_ptr<ABI> abi_;
-    llvm::TargetMachine *targetMachine_;
+    TargetMachineCache::Lease targetMachine_;
+    OptLevel optLevel_;
 
     // Contextual information (unfortunately). Use the guard for safety.
     // Used as a "return value" for the visitor
@@ -131,17 +178,63 @@ private:
     llvm::Value *currentStore_ = nullptr;                 // For InitDecl
     bool isGlobal_ = true;                                // For InitDecl
     const BaseType *currentExpectedType_ = nullptr;       // For InitDecl
+    // If set, non-constant elements are collected here instead of making the
+    // whole initializer non-constant
+    std::vector<DynamicInit> *dynamicInits_ = nullptr; // For InitDecl
+    std::vector<llvm::Value *> constIndices_;           // For InitDecl
     llvm::Function *currentFunction_ = nullptr; // For FnDecl/ParamList
     llvm::SwitchInst *currentSwitch_ = nullptr; // For Switch/Case
     SymbolTable symbolTable_;                   // For Decl
+    // The large case ranges of the innermost switch, for Switch/Case
+    std::vector<CaseRange> *currentCaseRanges_ = nullptr;
+    // Placeholder in the entry block, allocas are inserted before it
+    llvm::Instruction *allocaInsertPt_ = nullptr;
+    // Locals with a lifetime.start, ended when their scope is popped
+    std::vector<std::vector<llvm::AllocaInst *>> lifetimeScopes_;
     // For Break/While/For/Do-While/Switch
     std::stack<llvm::BasicBlock *> breakStack_;
     // For Continue/While/For/Do-While
     std::stack<llvm::BasicBlock *> continueStack_;
-    std::unordered_map<std::string, std::vector<size_t>> structIDs_;
+    // Lowered types, and structs by declaration ID
+    std::unordered_map<const BaseType *, llvm::Type *> llvmTypes_;
+    std::unordered_map<size_t, llvm::StructType *> llvmStructTypes_;
+    // Number of distinct structs seen under each name
+    std::unordered_map<std::string, size_t> structCounts_;
+    std::unordered_map<std::string, int> localStaticCounter_;
+
+    // Local aggregates up to this size (in bytes) are always copied from a
+    // constant, larger ones are zeroed then stored to if that takes at most
+    // maxInitStores_ stores (the same limits as clang)
+    static constexpr uint64_t maxMemcpyInitSize_ = 32;
+    static constexpr size_t maxInitStores_ = 6;
+    // Arrays ending in at least this many zero elements are emitted with a
+    // zeroinitializer tail (the same limit as clang)
+    static constexpr uint64_t minTrailingZeros_ = 8;
+    // Case ranges with fewer values are added to the switch one by one, so
+    // they can be part of a jump table
+    static constexpr int64_t maxCaseRangeSize_ = 64;
+    // Branch weights for __builtin_expect (the same as clang)
+    static constexpr uint32_t likelyWeight_ = 2000;
+    static constexpr uint32_t unlikelyWeight_ = 1;
 
     llvm::AllocaInst *
     createAlignedAlloca(llvm::Type *type, const llvm::Twine &name = "");
+    void emitLifetimeStart(llvm::AllocaInst *alloca);
+    void emitAggregateInit(
+        const Init &init,
+        llvm::AllocaInst *alloca,
+        const BaseType *type,
+        const std::string &name);
+    // Appends the non-zero scalars in `cons`, with their GEP indices. False
+    // once there are more than `budget`.
+    bool collectNonZeroStores(
+        llvm::Constant *cons,
+        std::vector<llvm::Value *> &indices,
+        InitStores &stores,
+        size_t budget);
+    // The initializer of a global array, its trailing zero elements as one
+    // zeroinitializer: <{ [N x T] [...], [M x T] zeroinitializer }>
+    llvm::Constant *compressTrailingZeros(llvm::Constant *cons);
     llvm::GlobalVariable *createAlignedGlobalVariable(
         llvm::Module &M,
         llvm::Type *Ty,
@@ -161,10 +254,12 @@ private:
 
     llvm::Align getAlign(llvm::Type *type) const;
     llvm::Function *getCurrentFunction() const;
-    std::string getLocalStaticName(const std::string &name) const;
+    std::string getLocalStaticName(const std::string &name);
     llvm::Type *getLLVMType(const BaseNode *node);
     llvm::Type *getLLVMType(const BaseType *type);
     llvm::Type *getLLVMType(Types ty);
+    llvm::Type *lowerType(const BaseType *type);
+    llvm::StructType *getLLVMStructType(const StructType *type);
     std::vector<llvm::Type *> getParamTypes(const FnType *fnType);
     llvm::Type *getPointerElementType(const BaseNode *node);
     llvm::Value *visitAsLValue(const Expr &node);
@@ -174,12 +269,20 @@ private:
     llvm::Function *visitAsFnDesignator(const Expr &node);
     llvm::Constant *
     visitAsConstant(const Expr &node, const BaseType *expectedType);
+    // Folded by the TypeChecker, so never visited
+    EvalType getConstant(const Expr &node) const;
+    llvm::Constant *getFoldedConstant(const Expr &node);
+    // `c` of a `__builtin_expect(exp, c)` condition, if it is one
+    std::optional<int64_t> getExpectedValue(const Expr &cond) const;
+    static bool isBuiltinExpect(const FnCall &node);
+    void setBranchWeights(llvm::BranchInst *br, bool isTrueLikely);
+    void setExpectWeights(llvm::BranchInst *br, const Expr &cond);
     llvm::Value *visitAsStore(
         const Expr &node,
         llvm::Value *storeVal,
         const BaseType *expectedType);
-    void symbolTablePush(std::string id, Symbol symbol);
-    Symbol symbolTableLookup(std::string id) const;
+    void symbolTablePush(AST::Symbol id, Symbol symbol);
+    Symbol symbolTableLookup(AST::Symbol id) const;
 
     void pushScope();
     void popScope();
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Symbol table for nested scopes. Every name maps to a stack of bindings, with
+ * the innermost one on top, and the names bound in each scope are kept in an
+ * undo log. A lookup is one hash probe however deeply scopes are nested, and
+ * popping a scope only unbinds the names it declared.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class ScopedSymbolTable
+{
+public:
+    void pushScope()
+    {
+        scopeStarts_.push_back(undoLog_.size());
+    }
+
+    void popScope()
+    {
+        size_t start = scopeStarts_.back();
+        scopeStarts_.pop_back();
+
+        while (undoLog_.size() > start)
+        {
+            // Empty stacks are kept so a name redeclared later reuses them
+            bindings_.find(undoLog_.back())->second.pop_back();
+            undoLog_.pop_back();
+        }
+    }
+
+    // Binds name in the innermost scope, replacing any binding it had there
+    void insert(const Key &name, Value value)
+    {
+        std::vector<Binding> &stack = bindings_[name];
+        if (!stack.empty() && stack.back().depth == depth())
+        {
+            stack.back().value = std::move(value);
+            return;
+        }
+
+        stack.push_back({depth(), std::move(value)});
+        undoLog_.push_back(name);
+    }
+
+    // The innermost binding of name, or nullptr if it is not bound
+    const Value *lookup(const Key &name) const
+    {
+        auto it = bindings_.find(name);
+        if (it == bindings_.end() || it->second.empty())
+        {
+            return nullptr;
+        }
+        return &it->second.back().value;
+    }
+
+    // The binding of name in the innermost scope only
+    const Value *lookupInCurrentScope(const Key &name) const
+    {
+        auto it = bindings_.find(name);
+        if (it == bindings_.end() || it->second.empty() ||
+            it->second.back().depth != depth())
+        {
+            return nullptr;
+        }
+        return &it->second.back().value;
+    }
+
+    size_t depth() const noexcept
+    {
+        return scopeStarts_.size();
+    }
+
+private:
+    struct Binding
+    {
+        size_t depth;
+        Value value;
+    };
+
+    std::unordered_map<Key, std::vector<Binding>, Hash> bindings_;
+    std::vector<Key> undoLog_;
+    std::vector<size_t> scopeStarts_;
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Target/TargetMachine.h"
+
+namespace CodeGen
+{
+
+/**
+ * Process-wide pool of TargetMachines, keyed by triple, CPU and features.
+ * Creating a TargetMachine is expensive and only the targets we build are
+ * registered (once), so compile jobs lease a machine and hand it back when
+ * they are done. A machine is only ever used by one job at a time.
+ */
+class TargetMachineCache
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * Exclusive use of a TargetMachine, returned to the cache on destruction.
+     */
+    class Lease
+    {
+    public:
+        Lease() = default;
+        Lease(Lease &&other) noexcept;
+        Lease &operator=(Lease &&other) noexcept;
+        ~Lease();
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        llvm::TargetMachine *get() const noexcept
+        {
+            return machine_;
+        }
+        llvm::TargetMachine *operator->() const noexcept
+        {
+            return machine_;
+        }
+
+    private:
+        friend class TargetMachineCache;
+
+        void reset() noexcept;
+
+        TargetMachineCache *cache_ = nullptr;
+        std::string key_;
+        llvm::TargetMachine *machine_ = nullptr;
+    };
+
+    struct Stats
+    {
+        Clock::duration initTime{};   // Registering the targets
+        Clock::duration createTime{}; // Creating TargetMachines
+        size_t numCreated = 0;
+        size_t numReused = 0;
+    };
+
+    static TargetMachineCache &getInstance();
+
+    // Registers the X86 and AArch64 targets, only the first call does work
+    static void initializeTargets();
+
+    // Throws if there is no registered target for the triple
+    Lease acquire(
+        const std::string &triple,
+        const std::string &cpu,
+        const std::string &features,
+        llvm::CodeGenOptLevel optLevel);
+
+    Stats getStats() const;
+
+private:
+    TargetMachineCache() = default;
+
+    void release(const std::string &key, llvm::TargetMachine *machine) noexcept;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, std::vector<llvm::TargetMachine *>> idle_;
+    // Owns every machine created, leased out or not
+    std::vector<std::unique_ptr<llvm::TargetMachine>> machines_;
+    Stats stats_;
+};
+
+} // namespace CodeGen
@@ -1,26 +1,41 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
 #include <unordered_map>
+#include <utility>
 
+#include "AST/ASTContext.hpp"
+#include "AST/Expr.hpp"
 #include "AST/Node.hpp"
 #include "AST/Type.hpp"
 #include "AST/Visitor.hpp"
+#include "CodeGen/ABI.hpp"
+#include "CodeGen/ScopedSymbolTable.hpp"
 
 using namespace AST;
 
 namespace CodeGen
 {
 
-using NodeMap = std::unordered_map<const BaseNode *, Ptr<BaseType>>;
-using StructMap = std::unordered_map<size_t, Ptr<ParamType>>;
+// Types are owned by the ASTContext
+using NodeMap = std::unordered_map<const BaseNode *, const BaseType *>;
+using StructMap = std::unordered_map<size_t, const ParamType *>;
+// The value of every constant expression, converted to the expression's type
+using ConstantMap = std::unordered_map<const Expr *, EvalType>;
 
-using TypeContext = std::vector<std::unordered_map<std::string, Ptr<BaseType>>>;
+// Scopes are keyed on interned identifiers, not strings
+using TypeContext = ScopedSymbolTable<Symbol, const BaseType *>;
+// Enum constants have a value, every other identifier shadows them
+using ConstantContext = ScopedSymbolTable<Symbol, EvalType>;
 
 class TypeChecker : public Visitor
 {
 public:
-    TypeChecker();
+    // Types are laid out for targetTriple, the host if it is empty
+    TypeChecker(ASTContext &astContext, std::string targetTriple);
 
     // Declarations
     void visit(const AbstractArrayDecl &node) override;
@@ -93,25 +108,46 @@ public:
         return structMap_;
     }
 
+    ConstantMap &getConstantMap()
+    {
+        return constantMap_;
+    }
+
     static Types runIntegerPromotions(Types type);
     static Types runUsualArithmeticConversions(Types lhs, Types rhs);
 
 private:
+    ASTContext &astContext_;
     NodeMap nodeMap_;
     StructMap structMap_;
+    ConstantMap constantMap_;
     TypeContext typeContext_;
+    ConstantContext constantContext_;
+
+    // Sizes and alignments come from the target's ABI and DataLayout, as in
+    // CodeGen. No IR is generated in this module
+    std::unique_ptr<llvm::LLVMContext> layoutContext_;
+    std::unique_ptr<llvm::Module> layoutModule_;
+    std::unique_ptr<ABI> abi_;
 
     // Contextual information
     // Jumping around TUs
     const BaseNode *currentFunction_;
     // For DeclNode and FnDef
-    Ptr<BaseType> currentType_;
+    const BaseType *currentType_ = nullptr;
     bool fromDecl_ = false;
     std::vector<std::vector<const BaseNode *>> incompleteNodes_;
 
     void pushScope();
     void popScope();
-    Ptr<BaseType> lookupType(const std::string &name, size_t id = -1) const;
-    void insertType(const std::string &name, Ptr<BaseType> type);
+    const BaseType *lookupType(Symbol name) const;
+    void insertType(Symbol name, const BaseType *type);
+
+    // C99 6.6 Constant expressions, folded once while the types are known
+    void foldConstant(const Expr &node, const EvalType &value);
+    EvalType getConstant(const Expr *node) const;
+    // Size and alignment in bytes, if known at compile time
+    std::optional<std::pair<uint64_t, uint64_t>>
+    getSizeAndAlign(const BaseType *type) const;
 };
 } // namespace CodeGen
\ No newline at end of file
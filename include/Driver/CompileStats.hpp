@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/TimeProfiler.h"
+
+namespace Driver
+{
+
+/**
+ * Time spent in each phase of the compiler, and counters describing the work
+ * done, summed over every translation unit in the invocation. Safe to update
+ * from several compile jobs at once.
+ */
+class CompileStats
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Phase
+    {
+        Startup, // Registering targets and creating TargetMachines
+        Preprocess,
+        Parse,
+        TypeCheck,
+        IRGen,
+        Optimize,
+        Emit,
+        Link,
+        NumPhases
+    };
+
+    /**
+     * Adds the time between construction and destruction to a phase. Also a
+     * span in the -ftime-trace output, if the profiler is running.
+     */
+    class Timer
+    {
+    public:
+        Timer(CompileStats &stats, Phase phase, llvm::StringRef detail = {})
+            : stats_(stats), phase_(phase), start_(Clock::now()),
+              trace_(getPhaseName(phase), detail)
+        {
+        }
+        ~Timer()
+        {
+            stats_.addTime(phase_, Clock::now() - start_);
+        }
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+    private:
+        CompileStats &stats_;
+        Phase phase_;
+        Clock::time_point start_;
+        llvm::TimeTraceScope trace_;
+    };
+
+    void addTime(Phase phase, Clock::duration duration);
+    void addCounter(const std::string &name, size_t value);
+    // The optimization pass breakdown of one translation unit
+    void addPassTimings(const std::string &sourcePath, std::string report);
+    // Wall time of the whole invocation, phases overlap with -j
+    void setTotalTime(Clock::duration duration);
+
+    void printTimeReport(std::ostream &os) const;
+    void printStats(std::ostream &os) const;
+    // Both timers and counters, for tracking regressions in CI
+    void printJSON(std::ostream &os) const;
+
+    static const char *getPhaseName(Phase phase);
+
+private:
+    static constexpr size_t numPhases_ = static_cast<size_t>(Phase::NumPhases);
+
+    mutable std::mutex mutex_;
+    std::array<Clock::duration, numPhases_> times_{};
+    Clock::duration totalTime_{};
+    // Ordered so reports are stable between runs
+    std::map<std::string, size_t> counters_;
+    std::vector<std::pair<std::string, std::string>> passTimings_;
+};
+
+} // namespace Driver
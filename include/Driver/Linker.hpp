@@ -0,0 +1,46 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/TargetParser/Triple.h"
+
+namespace Driver
+{
+
+// An object file emitted into memory
+using ObjectBuffer = llvm::SmallVector<char, 0>;
+
+/**
+ * Settings for the final link.
+ */
+struct LinkOptions
+{
+    // Directories searched for the C runtime objects and libraries. Empty
+    // means the usual multiarch and GCC directories for the target.
+    std::vector<std::string> libraryPaths;
+};
+
+// True if the target can be linked by the built in ELF linker
+bool canLinkInProcess(const llvm::Triple &triple);
+
+/**
+ * Links objects held in memory into an executable with the lld library. No
+ * process is spawned and the objects never touch the disk. Throws on failure.
+ */
+void linkInProcess(
+    const std::vector<ObjectBuffer> &objects,
+    const std::string &outputPath,
+    const llvm::Triple &triple,
+    const LinkOptions &options);
+
+/**
+ * Links object files by invoking the clang driver found in PATH. Used for
+ * targets the built in linker does not support, or when asked for.
+ */
+void linkWithDriver(
+    const std::vector<std::string> &objectPaths,
+    const std::string &outputPath);
+
+} // namespace Driver
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "Driver/CompileStats.hpp"
+
+namespace Driver
+{
+
+/**
+ * Headers read during one invocation, shared by every translation unit.
+ * Entries are keyed by canonical path and reloaded if the mtime changes.
+ * Headers wrapped in "#pragma once" or a classic #ifndef/#define/#endif
+ * guard are remembered, so that including them again in the same
+ * translation unit can be skipped without reading or lexing (clang's
+ * multiple-include optimisation).
+ */
+class IncludeCache
+{
+public:
+    struct Header
+    {
+        std::time_t mtime;
+        std::string contents;
+        bool isGuarded = false;
+        std::string guardMacro; // Empty for #pragma once
+    };
+
+    // Throws if the header cannot be read
+    std::shared_ptr<const Header> get(const std::string &canonicalPath);
+
+private:
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_ptr<const Header>> headers_;
+
+    static void detectIncludeGuard(Header &header);
+};
+
+/**
+ * Runs the preprocessor over a source file. Quoted includes are searched for
+ * relative to the including file and read through the cache. Throws if the
+ * file or one of its headers cannot be read.
+ */
+std::string preprocessFile(
+    const std::string &sourcePath,
+    IncludeCache &cache,
+    CompileStats &stats);
+
+/**
+ * As preprocessFile, for a source already in memory. Its quoted includes are
+ * searched for in directory.
+ */
+std::string preprocess(
+    const std::string &source,
+    const std::string &directory,
+    IncludeCache &cache,
+    CompileStats &stats);
+
+} // namespace Driver
@@ -0,0 +1,329 @@
+#include "AST/ASTContext.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+namespace AST
+{
+
+ASTContext::~ASTContext()
+{
+    // Newer nodes may refer to older ones, so tear down in reverse
+    for (auto it = deallocations_.rbegin(); it != deallocations_.rend(); ++it)
+    {
+        it->first(it->second);
+    }
+}
+
+void *ASTContext::allocate(size_t size, size_t align)
+{
+    auto alignUp = [align](char *ptr)
+    {
+        auto addr = reinterpret_cast<uintptr_t>(ptr);
+        return reinterpret_cast<char *>((addr + align - 1) & ~(align - 1));
+    };
+
+    char *ptr = alignUp(cur_);
+    if (cur_ == nullptr || ptr + size > end_)
+    {
+        newSlab(size + align);
+        ptr = alignUp(cur_);
+    }
+
+    cur_ = ptr + size;
+    bytesAllocated_ += size;
+    return ptr;
+}
+
+void ASTContext::addDeallocation(void (*callback)(void *), void *data)
+{
+    deallocations_.emplace_back(callback, data);
+}
+
+size_t ASTContext::getBytesAllocated() const
+{
+    return bytesAllocated_;
+}
+
+size_t ASTContext::getNumNodes() const
+{
+    return numNodes_;
+}
+
+Symbol ASTContext::getIdentifier(std::string_view name)
+{
+    if (name.empty())
+    {
+        return Symbol();
+    }
+
+    auto it = identifiers_.find(name);
+    if (it != identifiers_.end())
+    {
+        return Symbol(it->second);
+    }
+
+    const std::string &interned = identifierNames_.emplace_back(name);
+    identifiers_.emplace(interned, &interned);
+    return Symbol(&interned);
+}
+
+size_t ASTContext::getNumIdentifiers() const
+{
+    return identifierNames_.size();
+}
+
+void ASTContext::newSlab(size_t minSize)
+{
+    size_t size = std::max(slabSize_, minSize);
+    // Left uninitialized, nodes are constructed in place
+    slabs_.emplace_back(new char[size]);
+    cur_ = slabs_.back().get();
+    end_ = cur_ + size;
+}
+
+/******************************************************************************
+ *                          Types                                             *
+ *****************************************************************************/
+
+size_t TypeKeyHash::hashValue(const Qualifiers &quals) noexcept
+{
+    // Each qualifier is a small enum, so they pack into one integer
+    auto pack = [](const auto &qual) -> size_t
+    { return qual ? static_cast<size_t>(*qual) + 1 : 0; };
+
+    return pack(quals.cvrQualifier) | pack(quals.functionSpecifier) << 4 |
+           pack(quals.linkage) << 8 | pack(quals.storageDuration) << 12;
+}
+
+size_t TypeKeyHash::hashValue(const Params &params) noexcept
+{
+    size_t seed = params.size();
+    for (const auto &[name, type] : params)
+    {
+        seed = combine(seed, hashValue(name));
+        seed = combine(seed, hashValue(type));
+    }
+    return seed;
+}
+
+size_t TypeKeyHash::hashValue(const EnumConsts &consts) noexcept
+{
+    size_t seed = consts.size();
+    for (const auto &[name, value] : consts)
+    {
+        seed = combine(seed, hashValue(name));
+        seed = combine(seed, hashValue(value));
+    }
+    return seed;
+}
+
+size_t TypeKeyHash::combine(size_t seed, size_t value) noexcept
+{
+    return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+const BasicType *ASTContext::getBasicType(Types type, const Qualifiers &quals)
+{
+    return getUniqued<BasicType>(
+        basicTypes_,
+        {type, quals},
+        [&] { return create<BasicType>(type, quals); },
+        [&](const BasicType *ty) -> const BaseType *
+        { return quals.empty() ? ty : getBasicType(type); });
+}
+
+const PtrType *ASTContext::getPtrType(const BaseType *type)
+{
+    return getPtrType(type, type->getQualifiers());
+}
+
+const PtrType *
+ASTContext::getPtrType(const BaseType *type, const Qualifiers &quals)
+{
+    return getUniqued<PtrType>(
+        ptrTypes_,
+        {type, quals},
+        [&] { return create<PtrType>(type, quals); },
+        [&](const PtrType *ty) -> const BaseType *
+        {
+            const BaseType *canonical = type->getCanonicalType();
+            if (quals.empty() && canonical == type)
+            {
+                return ty;
+            }
+            return getPtrType(canonical, {});
+        });
+}
+
+const ArrayType *ASTContext::getArrayType(const BaseType *type, size_t size)
+{
+    return getArrayType(type, size, type->getQualifiers());
+}
+
+const ArrayType *ASTContext::getArrayType(
+    const BaseType *type,
+    size_t size,
+    const Qualifiers &quals)
+{
+    // Arrays compare equal to pointers to their element type
+    return getUniqued<ArrayType>(
+        arrayTypes_,
+        {type, size, quals},
+        [&] { return create<ArrayType>(type, size, quals); },
+        [&](const ArrayType *) -> const BaseType *
+        { return getPtrType(type->getCanonicalType(), {}); });
+}
+
+const FnType *
+ASTContext::getFnType(const ParamType *params, const BaseType *retType)
+{
+    return getFnType(params, retType, retType->getQualifiers());
+}
+
+const FnType *ASTContext::getFnType(
+    const ParamType *params,
+    const BaseType *retType,
+    const Qualifiers &quals)
+{
+    return getUniqued<FnType>(
+        fnTypes_,
+        {params, retType, quals},
+        [&] { return create<FnType>(params, retType, quals); },
+        [&](const FnType *ty) -> const BaseType *
+        {
+            auto *canonicalParams =
+                static_cast<const ParamType *>(params->getCanonicalType());
+            const BaseType *canonicalRet = retType->getCanonicalType();
+            if (quals.empty() && canonicalParams == params &&
+                canonicalRet == retType)
+            {
+                return ty;
+            }
+            return getFnType(canonicalParams, canonicalRet, {});
+        });
+}
+
+const ParamType *ASTContext::getParamType(Params types, const Qualifiers &quals)
+{
+    return getUniqued<ParamType>(
+        paramTypes_,
+        {types, quals},
+        [&] { return create<ParamType>(types, quals); },
+        [&](const ParamType *ty) -> const BaseType *
+        {
+            bool isCanonical = quals.empty();
+            for (auto &[name, type] : types)
+            {
+                isCanonical &= type->getCanonicalType() == type;
+                type = type->getCanonicalType();
+            }
+            return isCanonical ? ty : getParamType(std::move(types));
+        });
+}
+
+const EnumType *ASTContext::getEnumType(
+    const std::string &name,
+    const EnumConsts &consts,
+    const Qualifiers &quals)
+{
+    return getUniqued<EnumType>(
+        enumTypes_,
+        {name, consts, quals},
+        [&] { return create<EnumType>(name, consts, quals); },
+        [&](const EnumType *ty) -> const BaseType *
+        { return quals.empty() ? ty : getEnumType(name, consts); });
+}
+
+const StructType *ASTContext::getStructType(
+    StructType::Type type,
+    const std::string &name,
+    size_t id,
+    const Qualifiers &quals)
+{
+    // Structs with the same name compare equal, whichever declaration they
+    // come from. The canonical type is keyed on an ID of -1.
+    return getUniqued<StructType>(
+        structTypes_,
+        {type, name, id, quals},
+        [&] { return create<StructType>(type, name, id, quals); },
+        [&](const StructType *ty) -> const BaseType *
+        {
+            if (quals.empty() && id == -1)
+            {
+                return ty;
+            }
+            return getStructType(type, name, -1);
+        });
+}
+
+const StructType *
+ASTContext::createStructType(StructType::Type type, const std::string &name)
+{
+    // Allocates a fresh ID, then registers the type under it
+    const StructType *canonical = getStructType(type, name, -1);
+    auto *ty = create<StructType>(type, name, -1, Qualifiers{});
+    ty->canonical_ = canonical;
+    structTypes_.emplace(
+        std::make_tuple(type, name, ty->getID(), Qualifiers{}), ty);
+    numTypes_++;
+    return ty;
+}
+
+const BaseType *
+ASTContext::getQualifiedType(const BaseType *type, const Qualifiers &quals)
+{
+    if (type->getQualifiers() == quals)
+    {
+        return type;
+    }
+
+    switch (type->tid_)
+    {
+    case BaseType::ArrayTyID:
+    {
+        auto *ty = static_cast<const ArrayType *>(type);
+        return getArrayType(ty->type_, ty->size_, quals);
+    }
+    case BaseType::BaseTypeID:
+    {
+        auto *ty = static_cast<const BasicType *>(type);
+        return getBasicType(ty->type_, quals);
+    }
+    case BaseType::EnumTypeID:
+    {
+        auto *ty = static_cast<const EnumType *>(type);
+        return getEnumType(ty->name_, ty->consts_, quals);
+    }
+    case BaseType::FnTyID:
+    {
+        auto *ty = static_cast<const FnType *>(type);
+        return getFnType(ty->params_, ty->retType_, quals);
+    }
+    case BaseType::ParamTyID:
+    {
+        auto *ty = static_cast<const ParamType *>(type);
+        return getParamType(ty->types_, quals);
+    }
+    case BaseType::PtrTyID:
+    {
+        auto *ty = static_cast<const PtrType *>(type);
+        return getPtrType(ty->type_, quals);
+    }
+    case BaseType::StructTyID:
+    {
+        auto *ty = static_cast<const StructType *>(type);
+        return getStructType(ty->type_, ty->name_, ty->getID(), quals);
+    }
+    }
+
+    throw std::runtime_error("Unknown type");
+}
+
+size_t ASTContext::getNumTypes() const
+{
+    return numTypes_;
+}
+
+} // namespace AST
@@ -10,7 +10,7 @@ ArrayDecl::ArrayDecl(const Decl *decl, const Expr *size)
 {
 }
 
-std::string ArrayDecl::getID() const
+Symbol ArrayDecl::getID() const
 {
     return decl_->getID();
 }
@@ -32,7 +32,7 @@ FnDef::FnDef(
 {
 }
 
-std::string FnDef::getID() const
+Symbol FnDef::getID() const
 {
     return decl_->getID();
 }
@@ -46,14 +46,14 @@ InitDecl::InitDecl(const Decl *decl, const Init *init)
 {
 }
 
-std::string InitDecl::getID() const
+Symbol InitDecl::getID() const
 {
     return decl_->getID();
 }
 
-std::vector<std::string> DeclNode::getIDs() const
+std::vector<Symbol> DeclNode::getIDs() const
 {
-    std::vector<std::string> ids;
+    std::vector<Symbol> ids;
     for (const auto &decl : initDeclList_->nodes_)
     {
         ids.push_back(
@@ -62,18 +62,42 @@ std::vector<std::string> DeclNode::getIDs() const
     return ids;
 }
 
-Struct::Struct(Type type, std::string name, const StructMemberList *members)
-    : type_(type), name_(std::move(name)), members_(members)
+Enum::Enum(ASTContext &ctx, Symbol name, const EnumMemberList *members)
+    : name_(name), tag_(ctx.getIdentifier("enum " + name.getName())),
+      members_(members)
 {
 }
 
-Struct::Struct(Type type, const StructMemberList *members)
-    : type_(type), members_(members)
+Enum::Enum(ASTContext &ctx, const EnumMemberList *members)
+    : name_(), tag_(ctx.getIdentifier("enum ")), members_(members)
 {
 }
 
-Struct::Struct(Type type, std::string name)
-    : type_(type), name_(std::move(name))
+Enum::Enum(ASTContext &ctx, Symbol name)
+    : name_(name), tag_(ctx.getIdentifier("enum " + name.getName()))
+{
+}
+
+Struct::Struct(
+    ASTContext &ctx,
+    Type type,
+    Symbol name,
+    const StructMemberList *members)
+    : type_(type), name_(name),
+      tag_(ctx.getIdentifier(StructType::getName(type, name.getName()))),
+      members_(members)
+{
+}
+
+Struct::Struct(ASTContext &ctx, Type type, const StructMemberList *members)
+    : type_(type), name_(),
+      tag_(ctx.getIdentifier(StructType::getName(type, ""))), members_(members)
+{
+}
+
+Struct::Struct(ASTContext &ctx, Type type, Symbol name)
+    : type_(type), name_(name),
+      tag_(ctx.getIdentifier(StructType::getName(type, name.getName())))
 {
 }
 
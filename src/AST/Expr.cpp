@@ -120,9 +120,11 @@ BinaryOp::BinaryOp(const Expr *lhs, const Expr *rhs, Op op)
 
 EvalType BinaryOp::eval() const
 {
-    auto l = lhs_->eval();
-    auto r = rhs_->eval();
+    return fold(lhs_->eval(), rhs_->eval());
+}
 
+EvalType BinaryOp::fold(const EvalType &l, const EvalType &r) const
+{
     if (!l || !r || l.is<std::string>() || r.is<std::string>())
     {
         return {};
@@ -271,18 +273,32 @@ EvalType Constant::eval() const
     {
         return static_cast<uint64_t>(getChar());
     }
-    if (value_.find_first_of("eEpP.") != std::string::npos)
+    if (isFloating())
     {
         // std::stod does not work for Inf, NaN or subnormals
         return std::strtod(value_.c_str(), nullptr);
     }
-    else if (
-        static_cast<uint64_t>(std::stoull(value_)) >
-        std::numeric_limits<int64_t>::max())
+
+    // Base 0 reads the 0x and 0 prefixes, and stops at the suffix
+    uint64_t value = std::stoull(value_, nullptr, 0);
+    if (value > std::numeric_limits<int64_t>::max())
+    {
+        return value;
+    }
+    return static_cast<int64_t>(value);
+}
+
+bool Constant::isFloating() const
+{
+    if (value_.find_first_of("'\"") != std::string::npos)
     {
-        return static_cast<uint64_t>(std::stoull(value_));
+        return false;
     }
-    return static_cast<int64_t>(std::stoll(value_));
+
+    // In hexadecimal, e is a digit and p starts the exponent
+    bool isHex = value_.size() > 1 && value_[0] == '0' &&
+                 (value_[1] == 'x' || value_[1] == 'X');
+    return value_.find_first_of(isHex ? ".pP" : ".eE") != std::string::npos;
 }
 
 char Constant::getChar() const
@@ -315,8 +331,11 @@ const std::unordered_map<char, char> Constant::escapeChars = {
 
 EvalType UnaryOp::eval() const
 {
-    auto e = expr_->eval();
+    return fold(expr_->eval());
+}
 
+EvalType UnaryOp::fold(const EvalType &e) const
+{
     // Helper function to run the operation
     auto runOp = [this](auto expr) -> EvalType
     {
@@ -0,0 +1,84 @@
+#include "AST/ParseContext.hpp"
+
+#include <stdexcept>
+
+namespace AST
+{
+
+ParseContext::ParseContext(ASTContext &astContext)
+    : astContext_(astContext), typedefScopes_(1)
+{
+}
+
+ASTContext &ParseContext::getASTContext()
+{
+    return astContext_;
+}
+
+Symbol ParseContext::getIdentifier(std::string_view name)
+{
+    return astContext_.getIdentifier(name);
+}
+
+void ParseContext::addTypedef(Symbol name)
+{
+    typedefScopes_.back().insert(name);
+}
+
+bool ParseContext::isTypedef(Symbol name) const
+{
+    for (auto it = typedefScopes_.rbegin(); it != typedefScopes_.rend(); ++it)
+    {
+        if (it->count(name))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ParseContext::pushScope()
+{
+    typedefScopes_.emplace_back();
+}
+
+void ParseContext::popScope()
+{
+    if (typedefScopes_.size() == 1)
+    {
+        throw std::runtime_error("Cannot pop the file scope");
+    }
+
+    typedefScopes_.pop_back();
+}
+
+void ParseContext::setRoot(const TranslationUnit *root)
+{
+    root_ = root;
+}
+
+const TranslationUnit *ParseContext::getRoot() const
+{
+    return root_;
+}
+
+void ParseContext::setError(std::string_view message)
+{
+    if (error_.empty())
+    {
+        error_ = message;
+    }
+}
+
+bool ParseContext::hasError() const
+{
+    return !error_.empty();
+}
+
+const std::string &ParseContext::getError() const
+{
+    return error_;
+}
+
+} // namespace AST
@@ -736,6 +736,11 @@ void Printer::visit(const Case &node)
     {
         os << "case ";
         node.expr_->accept(*this);
+        if (node.rangeEnd_)
+        {
+            os << " ... ";
+            node.rangeEnd_->accept(*this);
+        }
     }
     else
     {
@@ -787,13 +792,13 @@ void Printer::visit(const ExprStmt &node)
 void Printer::visit(const For &node)
 {
     os << "for (";
-    if (std::holds_alternative<Ptr<DeclNode>>(node.init_))
+    if (std::holds_alternative<const DeclNode *>(node.init_))
     {
-        std::get<Ptr<DeclNode>>(node.init_)->accept(*this);
+        std::get<const DeclNode *>(node.init_)->accept(*this);
     }
     else
     {
-        std::get<Ptr<Stmt>>(node.init_)->accept(*this);
+        std::get<const Stmt *>(node.init_)->accept(*this);
     }
     os << " ";
     node.cond_->accept(*this);
@@ -3,56 +3,51 @@
 namespace AST
 {
 
-size_t BaseType::idProvider_ = 0;
-
-BaseType::BaseType(TypeID tid) : tid_(tid)
+bool Qualifiers::empty() const noexcept
 {
-    id_ = idProvider_++;
+    return !cvrQualifier && !functionSpecifier && !linkage && !storageDuration;
 }
 
-BaseType::BaseType(const BaseType &other)
+bool Qualifiers::operator==(const Qualifiers &other) const noexcept
 {
-    id_ = other.id_;
-    tid_ = other.tid_;
-
-    cvrQualifier_ = other.cvrQualifier_;
-    functionSpecifier_ = other.functionSpecifier_;
-    linkage_ = other.linkage_;
-    storageDuration_ = other.storageDuration_;
+    return cvrQualifier == other.cvrQualifier &&
+           functionSpecifier == other.functionSpecifier &&
+           linkage == other.linkage && storageDuration == other.storageDuration;
 }
 
-size_t BaseType::getID() const noexcept
+std::atomic<size_t> BaseType::idProvider_ = 0;
+
+BaseType::BaseType(TypeID tid, const Qualifiers &quals)
+    : tid_(tid), cvrQualifier_(quals.cvrQualifier),
+      functionSpecifier_(quals.functionSpecifier), linkage_(quals.linkage),
+      storageDuration_(quals.storageDuration)
 {
-    return id_;
+    id_ = idProvider_++;
 }
 
-ArrayType::ArrayType(Ptr<BaseType> type, size_t size)
-    : size_(size), PtrType(std::move(type)), BaseType(ArrayTyID)
+size_t BaseType::getID() const noexcept
 {
-    cvrQualifier_ = type_->cvrQualifier_;
-    functionSpecifier_ = type_->functionSpecifier_;
-    linkage_ = type_->linkage_;
-    storageDuration_ = type_->storageDuration_;
+    return id_;
 }
 
-ArrayType::ArrayType(const ArrayType &other)
-    : size_(other.size_), PtrType(other), BaseType(other)
+Qualifiers BaseType::getQualifiers() const noexcept
 {
+    return {cvrQualifier_, functionSpecifier_, linkage_, storageDuration_};
 }
 
-bool ArrayType::operator==(const ArrayType &other) const
+ArrayType::ArrayType(const BaseType *type, size_t size, const Qualifiers &quals)
+    : size_(size), PtrType(type, quals, ArrayTyID)
 {
-    return *type_ == *other.type_ && size_ == other.size_;
 }
 
 bool ArrayType::operator<(const BaseType &other) const
 {
-    if (auto otherType = dynamic_cast<const PtrType *>(&other))
+    if (auto otherType = dynCast<PtrType>(&other))
     {
         // Can decay into a pointer, or a void pointer
-        return PtrType(type_->clone()) <= *otherType;
+        return PtrType::operator<(other);
     }
-    else if (auto otherType = dynamic_cast<const ArrayType *>(&other))
+    else if (auto otherType = dynCast<ArrayType>(&other))
     {
         // Types can be casted as well
         // Arrays don't have to be fully initialized e.g. int a[5] = {1};
@@ -60,7 +55,7 @@ bool ArrayType::operator<(const BaseType &other) const
         // "abc" (size 4);
         return size_ <= otherType->size_ + 1 && *type_ < *otherType->type_;
     }
-    else if (auto otherType = dynamic_cast<const StructType *>(&other))
+    else if (auto otherType = dynCast<StructType>(&other))
     {
         // Initializer arrays can fit in structs
         return true;
@@ -69,45 +64,26 @@ bool ArrayType::operator<(const BaseType &other) const
     return false;
 }
 
-BasicType::BasicType(Types type) : type_(type), BaseType(BaseTypeID)
+BasicType::BasicType(Types type, const Qualifiers &quals)
+    : type_(type), BaseType(BaseTypeID, quals)
 {
 }
 
-BasicType::BasicType(
-    Types type,
-    std::optional<CVRQualifier> cvrQualifier,
-    std::optional<FunctionSpecifier> functionSpecifier,
-    std::optional<Linkage> linkage,
-    std::optional<StorageDuration> storageDuration)
-    : type_(type), BaseType(BaseTypeID)
-{
-    cvrQualifier_ = cvrQualifier;
-    functionSpecifier_ = functionSpecifier;
-    linkage_ = linkage;
-    storageDuration_ = storageDuration;
-}
-
-BasicType::BasicType(const BasicType &other)
-    : type_(other.type_), BaseType(other)
-{
-}
-
-bool BasicType::operator==(const BasicType &other) const
-{
-    return type_ == other.type_;
-}
-
 bool BasicType::operator<(const BaseType &other) const
 {
     // Compatible with other type, also compatible with pointers (only if it is
     // 0, but give benefit of the doubt)
-    return dynamic_cast<const BasicType *>(&other) ||
-           dynamic_cast<const PtrType *>(&other);
+    return dynCast<BasicType>(&other) || dynCast<PtrType>(&other);
 }
 
 bool BasicType::isSigned() const noexcept
 {
-    switch (type_)
+    return isSigned(type_);
+}
+
+bool BasicType::isSigned(Types type) noexcept
+{
+    switch (type)
     {
     case Types::BOOL:
     case Types::UNSIGNED_CHAR:
@@ -121,58 +97,36 @@ bool BasicType::isSigned() const noexcept
     }
 }
 
-EnumType::EnumType(std::string name, EnumConsts consts)
-    : name_(std::move(name)), consts_(std::move(consts)), BaseType(EnumTypeID)
-{
-}
-
-EnumType::EnumType(const EnumType &other)
-    : name_(other.name_), consts_(other.consts_), BaseType(other)
-{
-}
-
-bool EnumType::operator==(const EnumType &other) const
+EnumType::EnumType(std::string name, EnumConsts consts, const Qualifiers &quals)
+    : name_(std::move(name)), consts_(std::move(consts)),
+      BaseType(EnumTypeID, quals)
 {
-    return name_ == other.name_ && consts_ == other.consts_;
 }
 
 bool EnumType::operator<(const BaseType &other) const
 {
     // Can only decay into an integer
-    if (auto otherType = dynamic_cast<const BasicType *>(&other))
+    if (auto otherType = dynCast<BasicType>(&other))
     {
         return otherType->type_ <= Types::INT;
     }
     return false;
 }
 
-FnType::FnType(Ptr<ParamType> params, Ptr<BaseType> retType)
-    : params_(std::move(params)), retType_(std::move(retType)), BaseType(FnTyID)
-{
-    cvrQualifier_ = retType_->cvrQualifier_;
-    functionSpecifier_ = retType_->functionSpecifier_;
-    linkage_ = retType_->linkage_;
-    storageDuration_ = retType_->storageDuration_;
-}
-
-FnType::FnType(const FnType &other)
-    : params_(other.params_->cloneAsDerived()),
-      retType_(other.retType_->clone()), BaseType(other)
-{
-}
-
-bool FnType::operator==(const FnType &other) const
+FnType::FnType(
+    const ParamType *params,
+    const BaseType *retType,
+    const Qualifiers &quals)
+    : params_(params), retType_(retType), BaseType(FnTyID, quals)
 {
-    return *params_ == *other.params_ && *retType_ == *other.retType_;
 }
 
 bool FnType::operator<(const BaseType &other) const
 {
     // Can only decay into a function pointer with the same signature
-    if (auto otherType = dynamic_cast<const PtrType *>(&other))
+    if (auto otherType = dynCast<PtrType>(&other))
     {
-        if (auto otherFnType =
-                dynamic_cast<const FnType *>(otherType->type_.get()))
+        if (auto otherFnType = dynCast<FnType>(otherType->type_))
         {
             return *this == *otherFnType;
         }
@@ -181,51 +135,24 @@ bool FnType::operator<(const BaseType &other) const
     return false;
 }
 
-std::string FnType::getParamName(size_t i) const noexcept
+Symbol FnType::getParamName(size_t i) const noexcept
 {
     return params_->types_.at(i).first;
 }
 
 const BaseType *FnType::getParamType(size_t i) const noexcept
 {
-    return params_->types_.at(i).second.get();
+    return params_->types_.at(i).second;
 }
 
-ParamType::ParamType(Params types)
-    : types_(std::move(types)), BaseType(ParamTyID)
+ParamType::ParamType(Params types, const Qualifiers &quals)
+    : types_(std::move(types)), BaseType(ParamTyID, quals)
 {
 }
 
-ParamType::ParamType(const ParamType &other) : BaseType(other)
-{
-    for (const auto &type : other.types_)
-    {
-        types_.push_back({type.first, type.second->clone()});
-    }
-}
-
-bool ParamType::operator==(const ParamType &other) const
-{
-    if (types_.size() != other.types_.size())
-    {
-        return false;
-    }
-
-    for (size_t i = 0; i < types_.size(); ++i)
-    {
-        if (types_[i].first != other.types_[i].first ||
-            *types_[i].second != *other.types_[i].second)
-        {
-            return false;
-        }
-    }
-
-    return true;
-}
-
 bool ParamType::operator<(const BaseType &other) const
 {
-    auto otherType = dynamic_cast<const ParamType *>(&other);
+    auto otherType = dynCast<ParamType>(&other);
     if (!otherType)
     {
         return false;
@@ -254,23 +181,23 @@ size_t ParamType::size() const noexcept
 
 const BaseType *ParamType::at(size_t i) const
 {
-    return types_[i].second.get();
+    return types_[i].second;
 }
 
-Ptr<BaseType> ParamType::getMemberType(std::string name) const
+const BaseType *ParamType::getMemberType(Symbol name) const
 {
     for (const auto &type : types_)
     {
         if (type.first == name)
         {
-            return type.second->clone();
+            return type.second;
         }
     }
 
     return nullptr;
 }
 
-unsigned ParamType::getMemberIndex(std::string name) const
+unsigned ParamType::getMemberIndex(Symbol name) const
 {
 
     for (size_t i = 0; i < types_.size(); ++i)
@@ -284,36 +211,27 @@ unsigned ParamType::getMemberIndex(std::string name) const
     return -1;
 }
 
-PtrType::PtrType(Ptr<BaseType> type) : type_(std::move(type)), BaseType(PtrTyID)
-{
-    cvrQualifier_ = type_->cvrQualifier_;
-    functionSpecifier_ = type_->functionSpecifier_;
-    linkage_ = type_->linkage_;
-    storageDuration_ = type_->storageDuration_;
-}
-
-PtrType::PtrType(const PtrType &other)
-    : type_(other.type_->clone()), BaseType(other)
+PtrType::PtrType(const BaseType *type, const Qualifiers &quals, TypeID tid)
+    : type_(type), BaseType(tid, quals)
 {
 }
 
-bool PtrType::operator==(const PtrType &other) const
-{
-    return *type_ == *other.type_;
-}
-
 bool PtrType::operator<(const BaseType &other) const
 {
     // C is uncivilized, we can cast any pointer to any pointer
-    if (auto otherType = dynamic_cast<const PtrType *>(&other))
+    if (auto otherType = dynCast<PtrType>(&other))
     {
         return true;
     }
     return false;
 }
 
-StructType::StructType(Type type, std::string name, size_t id)
-    : type_(type), name_(std::move(name)), BaseType(StructTyID)
+StructType::StructType(
+    Type type,
+    std::string name,
+    size_t id,
+    const Qualifiers &quals)
+    : type_(type), name_(std::move(name)), BaseType(StructTyID, quals)
 {
     // StructID only really useful in finding the correct scope
     if (id != -1)
@@ -322,17 +240,6 @@ StructType::StructType(Type type, std::string name, size_t id)
     }
 }
 
-StructType::StructType(const StructType &other)
-    : type_(other.type_), name_(other.name_), BaseType(other)
-{
-}
-
-bool StructType::operator==(const StructType &other) const
-{
-    // Both nullptr = OK
-    return type_ == other.type_ && name_ == other.name_;
-}
-
 bool StructType::operator<(const BaseType &other) const
 {
     return false;
@@ -340,8 +247,13 @@ bool StructType::operator<(const BaseType &other) const
 
 std::string StructType::getName() const noexcept
 {
-    std::string prefix = type_ == Type::STRUCT ? "struct" : "union";
-    return prefix + "." + name_;
+    return getName(type_, name_);
+}
+
+std::string StructType::getName(Type type, const std::string &name)
+{
+    std::string prefix = type == Type::STRUCT ? "struct" : "union";
+    return prefix + "." + name;
 }
 
 } // namespace AST
@@ -0,0 +1,77 @@
+#include "CodeGen/ABI.hpp"
+#include "CodeGen/AArch64ABI.hpp"
+#include "CodeGen/X86_64ABI.hpp"
+
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/TargetParser/Triple.h"
+
+#include <stdexcept>
+
+namespace CodeGen
+{
+
+std::unique_ptr<ABI> ABI::create(llvm::Module &module)
+{
+    llvm::Triple triple(module.getTargetTriple());
+
+    if (triple.isAArch64())
+    {
+        return std::make_unique<AArch64ABI>(module);
+    }
+    else if (triple.isX86())
+    {
+        return std::make_unique<X86_64ABI>(module);
+    }
+
+    llvm::errs() << "Warning: Target architecture not recognised, "
+                    "defaulting to x86-64\n";
+    return std::make_unique<X86_64ABI>(module);
+}
+
+llvm::Type *ABI::getLLVMType(AST::Types ty, llvm::LLVMContext &context) const
+{
+    using Types = AST::Types;
+
+    unsigned size = getTypeSize(ty);
+
+    switch (ty)
+    {
+    case Types::VOID:
+        return llvm::Type::getVoidTy(context);
+    case Types::BOOL:
+    case Types::CHAR:
+    case Types::UNSIGNED_CHAR:
+    case Types::SHORT:
+    case Types::UNSIGNED_SHORT:
+    case Types::INT:
+    case Types::UNSIGNED_INT:
+    case Types::LONG:
+    case Types::UNSIGNED_LONG:
+    case Types::LONG_LONG:
+    case Types::UNSIGNED_LONG_LONG:
+        return llvm::Type::getIntNTy(context, size);
+    case Types::FLOAT:
+    case Types::DOUBLE:
+    case Types::LONG_DOUBLE:
+        if (size == 32)
+        {
+            return llvm::Type::getFloatTy(context);
+        }
+        else if (size == 64)
+        {
+            return llvm::Type::getDoubleTy(context);
+        }
+        else if (size == 80)
+        {
+            return llvm::Type::getX86_FP80Ty(context);
+        }
+        else if (size == 128)
+        {
+            return llvm::Type::getFP128Ty(context);
+        }
+    }
+
+    throw std::runtime_error("Unknown type");
+}
+
+} // namespace CodeGen
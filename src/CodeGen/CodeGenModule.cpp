@@ -7,26 +7,66 @@
 
 #include "CodeGen/ScopeGuard.hpp"
 
+#include <llvm/Analysis/ValueTracking.h>
 #include <llvm/IR/Constants.h>
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/IR/LegacyPassManager.h>
+#include <llvm/IR/MDBuilder.h>
 #include <llvm/IR/PassManager.h>
+#include <llvm/IR/PassTimingInfo.h>
 #include <llvm/IR/Verifier.h>
-#include <llvm/MC/TargetRegistry.h>
 #include <llvm/Passes/PassBuilder.h>
-#include <llvm/Support/TargetSelect.h>
+#include <llvm/Passes/StandardInstrumentations.h>
+#include <llvm/Support/TimeProfiler.h>
 #include <llvm/Support/raw_os_ostream.h>
-#include <llvm/Target/TargetOptions.h>
 #include <llvm/TargetParser/Host.h>
-#include <llvm/Transforms/InstCombine/InstCombine.h>
-#include <llvm/Transforms/Scalar/GVN.h>
-#include <llvm/Transforms/Scalar/Reassociate.h>
-#include <llvm/Transforms/Scalar/SimplifyCFG.h>
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 namespace CodeGen
 {
+namespace
+{
+llvm::CodeGenOptLevel getCodeGenOptLevel(OptLevel level)
+{
+    switch (level)
+    {
+    case OptLevel::O0:
+        return llvm::CodeGenOptLevel::None;
+    case OptLevel::O1:
+        return llvm::CodeGenOptLevel::Less;
+    case OptLevel::O2:
+    case OptLevel::Os:
+        return llvm::CodeGenOptLevel::Default;
+    case OptLevel::O3:
+        return llvm::CodeGenOptLevel::Aggressive;
+    }
+
+    throw std::runtime_error("Unknown optimisation level");
+}
+
+llvm::OptimizationLevel getOptimizationLevel(OptLevel level)
+{
+    switch (level)
+    {
+    case OptLevel::O0:
+        return llvm::OptimizationLevel::O0;
+    case OptLevel::O1:
+        return llvm::OptimizationLevel::O1;
+    case OptLevel::O2:
+        return llvm::OptimizationLevel::O2;
+    case OptLevel::O3:
+        return llvm::OptimizationLevel::O3;
+    case OptLevel::Os:
+        return llvm::OptimizationLevel::Os;
+    }
+
+    throw std::runtime_error("Unknown optimisation level");
+}
+} // namespace
+
 /******************************************************************************
  *                          Public functions                                  *
  *****************************************************************************/
@@ -34,62 +74,34 @@ namespace CodeGen
 CodeGenModule::CodeGenModule(
     std::string sourceFile,
     std::string outputFile,
+    ASTContext &astContext,
     NodeMap &nodeMap,
     StructMap &structMap,
-    std::string targetTriple)
-    : outputFile_(std::move(outputFile)), nodeMap_(nodeMap),
-      structMap_(structMap), context_(std::make_unique<llvm::LLVMContext>()),
+    ConstantMap &constantMap,
+    std::string targetTriple,
+    OptLevel optLevel)
+    : outputFile_(std::move(outputFile)), astContext_(astContext),
+      nodeMap_(nodeMap), structMap_(structMap), constantMap_(constantMap),
+      context_(std::make_unique<llvm::LLVMContext>()),
       builder_(std::make_unique<llvm::IRBuilder<>>(*context_)),
-      module_(std::make_unique<llvm::Module>("Module", *context_))
+      module_(std::make_unique<llvm::Module>("Module", *context_)),
+      optLevel_(optLevel)
 {
-    // Initialise all the targets for emitting object code
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmPrinters();
-    llvm::InitializeAllAsmParsers();
-
     if (targetTriple.empty())
     {
         targetTriple = llvm::sys::getDefaultTargetTriple();
     }
 
-    auto CPU = "generic";
-    auto features = "";
-
-    std::string error;
-    auto target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
-    if (!target)
-    {
-        llvm::errs() << error;
-    }
-
-    // PIC = Position Independent Code
-    llvm::TargetOptions opt;
-    targetMachine_ = target->createTargetMachine(
-        targetTriple, CPU, features, opt, llvm::Reloc::Model::PIC_);
+    // Shared with other compile jobs for the same target
+    targetMachine_ = TargetMachineCache::getInstance().acquire(
+        targetTriple, "generic", "", getCodeGenOptLevel(optLevel_));
 
     module_->setDataLayout(targetMachine_->createDataLayout());
     module_->setTargetTriple(targetTriple);
     module_->setSourceFileName(sourceFile);
     module_->setModuleIdentifier(sourceFile);
 
-    llvm::Triple triple = llvm::Triple(targetTriple);
-
-    if (triple.isAArch64())
-    {
-        abi_ = std::make_unique<AArch64ABI>(*module_);
-    }
-    else if (triple.isX86())
-    {
-        abi_ = std::make_unique<X86_64ABI>(*module_);
-    }
-    else
-    {
-        llvm::errs() << "Warning: Target architecture not recognised, "
-                        "defaulting to x86-64\n";
-        abi_ = std::make_unique<X86_64ABI>(*module_);
-    }
+    abi_ = ABI::create(*module_);
 }
 
 void CodeGenModule::emitLLVM()
@@ -108,9 +120,6 @@ void CodeGenModule::emitLLVM()
 
 void CodeGenModule::emitObject()
 {
-    // Emit the code
-    llvm::legacy::PassManager passManager;
-    auto fileType = llvm::CodeGenFileType::ObjectFile;
     std::error_code ec;
     llvm::raw_fd_ostream os(outputFile_, ec);
 
@@ -120,6 +129,15 @@ void CodeGenModule::emitObject()
         return;
     }
 
+    emitObject(os);
+}
+
+void CodeGenModule::emitObject(llvm::raw_pwrite_stream &os)
+{
+    // Emit the code
+    llvm::legacy::PassManager passManager;
+    auto fileType = llvm::CodeGenFileType::ObjectFile;
+
     if (targetMachine_->addPassesToEmitFile(passManager, os, nullptr, fileType))
     {
         llvm::errs() << "TargetMachine can't emit a file of this type\n";
@@ -130,36 +148,68 @@ void CodeGenModule::emitObject()
     os.flush();
 }
 
-void CodeGenModule::optimize()
+void CodeGenModule::optimize(llvm::raw_ostream *passTimings)
 {
+    // Times every pass and analysis when asked for. Must outlive the
+    // analysis managers, which hold on to the callbacks.
+    llvm::PassInstrumentationCallbacks pic;
+    llvm::TimePassesHandler timePasses(passTimings != nullptr);
+    if (passTimings)
+    {
+        timePasses.setOutStream(*passTimings);
+        timePasses.registerCallbacks(pic);
+    }
+
+    // Adds a span per pass to the -ftime-trace output, when it is enabled
+    llvm::TimeProfilingPassesHandler timeProfiling;
+    if (llvm::timeTraceProfilerEnabled())
+    {
+        timeProfiling.registerCallbacks(pic);
+    }
+
     // Analysis managers - must be in order
     auto lam = std::make_unique<llvm::LoopAnalysisManager>();
     auto fam = std::make_unique<llvm::FunctionAnalysisManager>();
     auto cgam = std::make_unique<llvm::CGSCCAnalysisManager>();
     auto mam = std::make_unique<llvm::ModuleAnalysisManager>();
 
-    auto fpm = std::make_unique<llvm::FunctionPassManager>();
-
-    // Peephole optimizations and bit-twiddling
-    fpm->addPass(llvm::InstCombinePass());
-    // Reassociate expressions
-    fpm->addPass(llvm::ReassociatePass());
-    // Eliminate common subexpressions
-    fpm->addPass(llvm::GVNPass());
-    // Simplify the control flow graph (deleting unreachable blocks, etc.)
-    fpm->addPass(llvm::SimplifyCFGPass());
-
     // Customisation options available in the PassBuilder
-    auto pb = llvm::PassBuilder();
+    auto pb = llvm::PassBuilder(
+        targetMachine_.get(),
+        llvm::PipelineTuningOptions(),
+        std::nullopt,
+        &pic);
     pb.registerModuleAnalyses(*mam);
     pb.registerCGSCCAnalyses(*cgam);
     pb.registerFunctionAnalyses(*fam);
     pb.registerLoopAnalyses(*lam);
     pb.crossRegisterProxies(*lam, *fam, *cgam, *mam);
 
-    auto mpm = pb.buildPerModuleDefaultPipeline(llvm::OptimizationLevel::O2);
+    // The default pipelines already contain InstCombine, Reassociate, GVN,
+    // SimplifyCFG, etc. -O0 must use the dedicated pipeline (it only runs the
+    // passes required for correctness, e.g. AlwaysInliner)
+    llvm::ModulePassManager mpm;
+    if (optLevel_ == OptLevel::O0)
+    {
+        mpm = pb.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+    }
+    else
+    {
+        mpm = pb.buildPerModuleDefaultPipeline(
+            getOptimizationLevel(optLevel_));
+    }
 
     mpm.run(*module_.get(), *mam);
+
+    if (passTimings)
+    {
+        timePasses.print();
+    }
+}
+
+size_t CodeGenModule::getNumInstructions() const
+{
+    return module_->getInstructionCount();
 }
 
 /******************************************************************************
@@ -205,7 +255,7 @@ void CodeGenModule::visit(const DeclNode &node)
 
     // Allocate memory for the variable
     // Exception for typedefs, don't want to allocate "memory" for them
-    if (node.initDeclList_ && !dynamic_cast<const Typedef *>(node.type_.get()))
+    if (node.initDeclList_ && !dynamic_cast<const Typedef *>(node.type_))
     {
         node.initDeclList_->accept(*this);
     }
@@ -219,7 +269,7 @@ void CodeGenModule::visit(const DefinedTypeDecl &node)
 void CodeGenModule::visit(const Enum &node)
 {
     // Register the constants
-    if (auto *enumType = dynamic_cast<const EnumType *>(nodeMap_[&node].get()))
+    if (auto *enumType = dynCast<EnumType>(nodeMap_[&node]))
     {
         for (const auto &member : enumType->consts_)
         {
@@ -248,12 +298,13 @@ void CodeGenModule::visit(const FnDecl &node)
 
 void CodeGenModule::visit(const FnDef &node)
 {
-    std::string fnName = node.decl_->getID();
+    const std::string &fnName = node.decl_->getID().getName();
+    llvm::TimeTraceScope timeScope("CodeGen Function", fnName);
     llvm::Function *fn = module_->getFunction(fnName);
 
     // Safe to do... this was checked in the TypeChecker
-    const FnType *type = dynamic_cast<const FnType *>(nodeMap_[&node].get());
-    llvm::Type *retType = getLLVMType(type->retType_.get());
+    const FnType *type = dynCast<FnType>(nodeMap_[&node]);
+    llvm::Type *retType = getLLVMType(type->retType_);
 
     // If we haven't declared the function yet, create it
     if (!fn)
@@ -267,6 +318,15 @@ void CodeGenModule::visit(const FnDef &node)
     llvm::BasicBlock *bb = llvm::BasicBlock::Create(*context_, "entry", fn);
     builder_->SetInsertPoint(bb);
 
+    // Like clang, every alloca goes at the top of the entry block, wherever
+    // the variable is declared. Only these static allocas are promoted to
+    // registers by mem2reg and SROA, and the stack does not grow in loops.
+    allocaInsertPt_ = new llvm::BitCastInst(
+        llvm::PoisonValue::get(builder_->getInt32Ty()),
+        builder_->getInt32Ty(),
+        "allocapt",
+        bb);
+
     // Required, quick solution to scopes being inside compound statements
     // Works the same, but we have 1 extra scope that only contains the function
     // arguments
@@ -279,7 +339,7 @@ void CodeGenModule::visit(const FnDef &node)
 
     for (size_t j = 0; j < type->params_->size(); j++)
     {
-        std::string paramName = type->getParamName(j);
+        AST::Symbol paramName = type->getParamName(j);
         llvm::Type *rawParamType = rawParamTypes.at(j);
 
         if (rawParamType->isStructTy() &&
@@ -307,7 +367,8 @@ void CodeGenModule::visit(const FnDef &node)
 
                 llvm::AllocaInst *tempAlloca =
                     createAlignedAlloca(assignedType);
-                allocaInst = createAlignedAlloca(rawParamType, paramName);
+                allocaInst =
+                    createAlignedAlloca(rawParamType, paramName.getName());
 
                 // Copy the params to an alloca of the (anonymous) struct type
                 for (size_t i = 0; i < tys.size(); i++)
@@ -330,7 +391,8 @@ void CodeGenModule::visit(const FnDef &node)
             }
             else
             {
-                allocaInst = createAlignedAlloca(rawParamType, paramName);
+                allocaInst =
+                    createAlignedAlloca(rawParamType, paramName.getName());
                 builder_->CreateStore(fn->getArg(argPtr), allocaInst);
                 argPtr++;
             }
@@ -359,17 +421,30 @@ void CodeGenModule::visit(const FnDef &node)
 
     popScope();
 
+    allocaInsertPt_->eraseFromParent();
+    allocaInsertPt_ = nullptr;
+
     // Attributes required for strings
-    fn->addFnAttr(llvm::Attribute::NoInline);
     fn->addFnAttr(llvm::Attribute::NoUnwind);
-    fn->addFnAttr(llvm::Attribute::OptimizeNone);
+
+    // OptimizeNone makes the optimiser skip the function, so (like clang) it
+    // is only applied at -O0
+    if (optLevel_ == OptLevel::O0)
+    {
+        fn->addFnAttr(llvm::Attribute::NoInline);
+        fn->addFnAttr(llvm::Attribute::OptimizeNone);
+    }
+    else if (optLevel_ == OptLevel::Os)
+    {
+        fn->addFnAttr(llvm::Attribute::OptimizeForSize);
+    }
 
     llvm::verifyFunction(*fn, &llvm::errs());
 }
 
 void CodeGenModule::visit(const InitDecl &node)
 {
-    const auto *ty = nodeMap_[&node].get();
+    const auto *ty = nodeMap_[&node];
     llvm::Type *type = getLLVMType(ty);
     bool hasStatic = ty->linkage_ == Linkage::INTERNAL;
     bool hasExtern = ty->linkage_ == Linkage::EXTERNAL;
@@ -379,13 +454,15 @@ void CodeGenModule::visit(const InitDecl &node)
     if (type->isFunctionTy())
     {
         // Global or local function declaration
-        llvm::Function *fn = module_->getFunction(node.getID());
+        llvm::Function *fn = module_->getFunction(node.getID().getName());
 
         if (!fn)
         {
             // Function declaration
             fn = createFunction(
-                dynamic_cast<const FnType *>(ty), linkage, node.getID());
+                dynCast<FnType>(ty),
+                linkage,
+                node.getID().getName());
         }
         else if (
             hasExtern && fn->getLinkage() != llvm::GlobalValue::InternalLinkage)
@@ -408,7 +485,12 @@ void CodeGenModule::visit(const InitDecl &node)
 
         if (node.init_)
         {
-            init = visitAsConstant(*node.init_.get(), ty);
+            init = visitAsConstant(*node.init_, ty);
+            if (!init)
+            {
+                throw std::runtime_error(
+                    "Initializer element is not a compile-time constant");
+            }
         }
         else if (!hasExtern)
         {
@@ -417,7 +499,8 @@ void CodeGenModule::visit(const InitDecl &node)
         }
 
         std::string name =
-            (isGlobal_) ? node.getID() : getLocalStaticName(node.getID());
+            (isGlobal_) ? node.getID().getName()
+                        : getLocalStaticName(node.getID().getName());
         llvm::GlobalVariable *gb = module_->getGlobalVariable(name, true);
         if (gb)
         {
@@ -432,14 +515,20 @@ void CodeGenModule::visit(const InitDecl &node)
         }
         else
         {
-            // Declaration
+            // Declaration. The type of an earlier declaration can't change,
+            // so only a new global has its trailing zeroes compressed
+            if (init)
+            {
+                init = compressTrailingZeros(init);
+            }
             gb = createAlignedGlobalVariable(
                 *module_,
-                type,
+                init ? init->getType() : type,
                 /* isConstant */ false,
                 linkage,
                 init,
                 name);
+            gb->setAlignment(getAlign(type));
         }
 
         // Local static variables searched up by ID not name
@@ -449,7 +538,7 @@ void CodeGenModule::visit(const InitDecl &node)
     {
         // Local extern variable
         llvm::GlobalVariable *gb =
-            module_->getGlobalVariable(node.getID(), true);
+            module_->getGlobalVariable(node.getID().getName(), true);
         if (!gb)
         {
             // Variable is already declared somewhere else
@@ -459,7 +548,7 @@ void CodeGenModule::visit(const InitDecl &node)
                 /* isConstant */ false,
                 llvm::GlobalValue::ExternalLinkage,
                 /* Initializer */ nullptr,
-                node.getID());
+                node.getID().getName());
         }
         symbolTablePush(node.getID(), gb);
         // An initializer is not allowed for an extern declaration
@@ -468,7 +557,9 @@ void CodeGenModule::visit(const InitDecl &node)
     {
         // Local non-static, non-extern variable
         // Allocate memory for the variable
-        llvm::AllocaInst *alloca = createAlignedAlloca(type, node.getID());
+        llvm::AllocaInst *alloca =
+            createAlignedAlloca(type, node.getID().getName());
+        emitLifetimeStart(alloca);
 
         symbolTablePush(node.getID(), alloca);
 
@@ -476,35 +567,8 @@ void CodeGenModule::visit(const InitDecl &node)
         {
             if (type->isAggregateType())
             {
-                try
-                {
-                    // Try to initialize as a constant (generates less code)
-                    llvm::Constant *cons = visitAsConstant(*node.init_, ty);
-                    llvm::GlobalVariable *gb = createAlignedGlobalVariable(
-                        *module_,
-                        type,
-                        /* isConstant */ true,
-                        llvm::GlobalValue::InternalLinkage,
-                        cons,
-                        "__const." + getLocalStaticName(node.getID()));
-                    builder_->CreateMemCpy(
-                        alloca,
-                        getAlign(type),
-                        gb,
-                        getAlign(type),
-                        module_->getDataLayout().getTypeAllocSize(type));
-                }
-                catch (...)
-                {
-                    // Array initialization (placed here to init only once)
-                    builder_->CreateMemSet(
-                        alloca,
-                        llvm::ConstantInt::get(
-                            llvm::Type::getInt8Ty(*context_), 0, false),
-                        module_->getDataLayout().getTypeAllocSize(type),
-                        llvm::MaybeAlign());
-                    visitAsStore(*node.init_, alloca, ty);
-                }
+                emitAggregateInit(
+                    *node.init_, alloca, ty, node.getID().getName());
             }
             else
             {
@@ -557,47 +621,27 @@ void CodeGenModule::visit(const Struct &node)
     // If not then, it's an opaque struct
 
     // All information is available in the typeMap
-    const StructType *type =
-        dynamic_cast<const StructType *>(nodeMap_[&node].get());
+    const StructType *type = dynCast<StructType>(nodeMap_[&node]);
 
-    std::string name = "struct." + node.name_;
-    if (structIDs_.find(name) == structIDs_.end())
+    llvm::StructType *structType = getLLVMStructType(type);
+    if (!structType->isOpaque())
     {
-        structIDs_[name] = {type->getID()};
-    }
-    else
-    {
-        auto it = std::find(
-            structIDs_[name].begin(), structIDs_[name].end(), type->getID());
-        if (it != structIDs_[name].end())
-        {
-            // Struct already defined
-            return;
-        }
-
-        // New ID - add to the list
-        structIDs_[name].push_back(type->getID());
-        name += "." + std::to_string(structIDs_[name].size() - 1);
+        // Struct already defined
+        return;
     }
 
+    // Forward declarations stay opaque
     if (auto &params = structMap_[type->getID()])
     {
         std::vector<llvm::Type *> memberTypes;
         for (const auto &member : params->types_)
         {
-            memberTypes.push_back(getLLVMType(member.second.get()));
+            memberTypes.push_back(getLLVMType(member.second));
         }
 
         // Set the type in LLVM
-        llvm::StructType *structType =
-            llvm::StructType::create(*context_, name);
         structType->setBody(memberTypes);
     }
-    else
-    {
-        // Opaque struct
-        llvm::StructType::create(*context_, name);
-    }
 }
 
 void CodeGenModule::visit(const StructDecl &node)
@@ -653,9 +697,9 @@ void CodeGenModule::visit(const ArrayAccess &node)
     auto valueCategory = valueCategory_;
 
     // Weird semantics of C... `a[5] == 5[a]`
-    const Expr *arrNode = node.arr_.get();
-    const Expr *indexNode = node.index_.get();
-    if (dynamic_cast<const BasicType *>(nodeMap_[arrNode].get()))
+    const Expr *arrNode = node.arr_;
+    const Expr *indexNode = node.index_;
+    if (dynCast<BasicType>(nodeMap_[arrNode]))
     {
         std::swap(arrNode, indexNode);
     }
@@ -698,11 +742,11 @@ void CodeGenModule::visit(const Assignment &node)
 
     using Op = Assignment::Op;
 
-    auto *lhsType = nodeMap_[node.lhs_.get()].get();
+    auto *lhsType = nodeMap_[node.lhs_];
     llvm::Value *lhs = visitAsLValue(*node.lhs_);
     bool isFloatTy = lhs->getType()->isFloatingPointTy();
     bool isSigned = false;
-    if (auto *basicType = dynamic_cast<const BasicType *>(lhsType))
+    if (auto *basicType = dynCast<BasicType>(lhsType))
     {
         isSigned = basicType->isSigned();
     }
@@ -788,8 +832,8 @@ void CodeGenModule::visit(const BinaryOp &node)
         return;
     }
 
-    auto *lhsType = nodeMap_[node.lhs_.get()].get();
-    auto *rhsType = nodeMap_[node.rhs_.get()].get();
+    auto *lhsType = nodeMap_[node.lhs_];
+    auto *rhsType = nodeMap_[node.rhs_];
 
     if (lhsType->isArrayOrPtrTy() || rhsType->isArrayOrPtrTy())
     {
@@ -804,7 +848,7 @@ void CodeGenModule::visit(const BinaryOp &node)
 
     bool isFloat = lhs->getType()->isFloatingPointTy();
     bool isSigned =
-        BasicType(getArithmeticConversionType(lhsType, rhsType)).isSigned();
+        BasicType::isSigned(getArithmeticConversionType(lhsType, rhsType));
 
     switch (node.op_)
     {
@@ -931,10 +975,10 @@ void CodeGenModule::visitPtrOp(const BinaryOp &node)
     using Op = BinaryOp::Op;
 
     // Array types are loaded in raw (i.e. as pointers)
-    llvm::Value *lhs = (getLLVMType(node.lhs_.get())->isArrayTy())
+    llvm::Value *lhs = (getLLVMType(node.lhs_)->isArrayTy())
                            ? visitAsLValue(*node.lhs_)
                            : visitAsRValue(*node.lhs_);
-    llvm::Value *rhs = (getLLVMType(node.rhs_.get())->isArrayTy())
+    llvm::Value *rhs = (getLLVMType(node.rhs_)->isArrayTy())
                            ? visitAsLValue(*node.rhs_)
                            : visitAsRValue(*node.rhs_);
 
@@ -971,7 +1015,7 @@ void CodeGenModule::visitPtrOp(const BinaryOp &node)
         // Pointer subtraction
         if (rhs->getType()->isPointerTy())
         {
-            llvm::Type *ptrType = getPointerElementType(node.lhs_.get());
+            llvm::Type *ptrType = getPointerElementType(node.lhs_);
             currentValue_ = builder_->CreatePtrDiff(ptrType, lhs, rhs, "sub");
         }
         else
@@ -1030,7 +1074,7 @@ void CodeGenModule::visit(const Cast &node)
         throw std::runtime_error("Cast to LValue not supported");
     }
 
-    auto *expectedType = nodeMap_[node.type_.get()].get();
+    auto *expectedType = nodeMap_[node.type_];
 
     currentValue_ = visitAsCastedRValue(*node.expr_, expectedType);
 }
@@ -1042,26 +1086,11 @@ void CodeGenModule::visit(const Constant &node)
         throw std::runtime_error("Constant to LValue not supported");
     }
 
-    auto *ty = nodeMap_[&node].get();
-    auto basicType = dynamic_cast<const BasicType *>(ty);
-    llvm::Type *type = getLLVMType(ty);
-
-    if (type->isIntegerTy(8))
-    {
-        // Gets the 1 or 2 characters between the single quotes
-        currentValue_ = llvm::ConstantInt::get(type, node.getChar());
-    }
-    else if (type->isFloatingPointTy())
-    {
-        currentValue_ = llvm::ConstantFP::get(type, *node.eval().getDouble());
-    }
-    else if (!basicType->isSigned())
-    {
-        currentValue_ = llvm::ConstantInt::get(type, *node.eval().getUInt());
-    }
-    else
+    // Already converted to its type by the TypeChecker
+    currentValue_ = getFoldedConstant(node);
+    if (!currentValue_)
     {
-        currentValue_ = llvm::ConstantInt::get(type, *node.eval().getInt());
+        throw std::runtime_error("Unknown constant: " + node.value_);
     }
 }
 
@@ -1072,11 +1101,19 @@ void CodeGenModule::visit(const FnCall &node)
         // throw std::runtime_error("FnCall to LValue not supported");
     }
 
+    if (isBuiltinExpect(node))
+    {
+        // Only a hint for the branch using it, the value is exp
+        auto *params = dynCast<ParamType>(nodeMap_[node.args_]);
+        currentValue_ = visitAsCastedRValue(
+            *std::get<0>(node.args_->nodes_[0]), params->at(0));
+        return;
+    }
+
     llvm::Function *fn = visitAsFnDesignator(*node.fn_);
-    const FnType *fnType =
-        dynamic_cast<const FnType *>(nodeMap_[node.fn_.get()].get());
+    const FnType *fnType = dynCast<FnType>(nodeMap_[node.fn_]);
     auto paramTypes = getParamTypes(fnType);
-    llvm::Type *originalRetType = getLLVMType(fnType->retType_.get());
+    llvm::Type *originalRetType = getLLVMType(fnType->retType_);
     auto fnParams = abi_->getFunctionParams(originalRetType, paramTypes);
     std::vector<llvm::Value *> args;
 
@@ -1095,8 +1132,8 @@ void CodeGenModule::visit(const FnCall &node)
             std::visit(
                 [&](const auto &arg)
                 {
-                    auto *expectedType = dynamic_cast<const ParamType *>(
-                                             nodeMap_[node.args_.get()].get())
+                    auto *expectedType = dynCast<ParamType>(
+                                             nodeMap_[node.args_])
                                              ->at(i);
                     auto *ty = getLLVMType(expectedType);
 
@@ -1243,7 +1280,8 @@ void CodeGenModule::visit(const Identifier &node)
         }
         else
         {
-            throw std::runtime_error("Unknown identifier: " + node.getID());
+            throw std::runtime_error(
+                "Unknown identifier: " + node.getID().getName());
         }
     }
     else if (valueCategory_ == ValueCategory::RVALUE)
@@ -1258,7 +1296,7 @@ void CodeGenModule::visit(const Identifier &node)
         else if (auto **alloca = std::get_if<llvm::AllocaInst *>(&symbol))
         {
             currentValue_ = builder_->CreateLoad(
-                (*alloca)->getAllocatedType(), *alloca, node.getID());
+                (*alloca)->getAllocatedType(), *alloca, node.getID().getName());
         }
         else if (auto **arg = std::get_if<llvm::Argument *>(&symbol))
         {
@@ -1272,16 +1310,17 @@ void CodeGenModule::visit(const Identifier &node)
         else if (auto **global = std::get_if<llvm::GlobalVariable *>(&symbol))
         {
             currentValue_ = builder_->CreateLoad(
-                (*global)->getValueType(), *global, node.getID());
+                (*global)->getValueType(), *global, node.getID().getName());
         }
         else
         {
-            throw std::runtime_error("Unknown identifier: " + node.getID());
+            throw std::runtime_error(
+                "Unknown identifier: " + node.getID().getName());
         }
     }
     else
     {
-        currentValue_ = module_->getFunction(node.getID());
+        currentValue_ = module_->getFunction(node.getID().getName());
     }
 }
 
@@ -1300,24 +1339,30 @@ void CodeGenModule::visit(const Init &node)
     else
     {
         // Scenario 2. visitAsConstant
-        if (auto *initList = dynamic_cast<const InitList *>(node.expr_.get()))
+        if (auto *initList = dynamic_cast<const InitList *>(node.expr_))
         {
             initList->accept(*this);
         }
         else
         {
-            // Use .value() as it could throw an exception
+            // Not a constant unless shown otherwise, e.g. `{x, 1}`
+            currentValue_ = nullptr;
+
             auto *expectedType = getLLVMType(currentExpectedType_);
-            auto *basicType =
-                dynamic_cast<const BasicType *>(currentExpectedType_);
+            auto *basicType = dynCast<BasicType>(currentExpectedType_);
+            EvalType value = getConstant(*node.expr_);
 
-            if (auto *arrType =
-                    dynamic_cast<const ArrayType *>(currentExpectedType_))
+            if (auto *arrType = dynCast<ArrayType>(currentExpectedType_))
             {
+                if (!value.is<std::string>())
+                {
+                    return;
+                }
+
                 // String literal (doesn't go through InitList)
                 int strlen = arrType->size_;
                 std::vector<llvm::Constant *> values;
-                std::string str = node.expr_->eval().getString().value();
+                std::string str = *value.getString();
                 for (size_t i = 0; i < strlen; i++)
                 {
                     if (i < str.size())
@@ -1340,42 +1385,37 @@ void CodeGenModule::visit(const Init &node)
             }
             else if (currentExpectedType_->isPtrTy())
             {
-                if (node.expr_->eval().is<std::string>())
+                if (value.is<std::string>())
                 {
                     // String literal (decays to a pointer)
-                    std::string value = node.expr_->eval().getString().value();
                     currentValue_ = builder_->CreateGlobalString(
-                        value, "", 0U, module_.get());
+                        *value.getString(), "", 0U, module_.get());
                 }
-                else if (node.expr_->eval().getUInt().value() == 0)
+                else if (value && *value.getUInt() == 0)
                 {
                     currentValue_ = llvm::ConstantPointerNull::get(
                         static_cast<llvm::PointerType *>(expectedType));
                 }
-                else
-                {
-                    throw std::runtime_error("Expected a null pointer");
-                }
             }
-            else if (!basicType)
+            else if (!basicType || !value || value.is<std::string>())
             {
-                // OK, this will be caught in a try-catch block in InitDecl
-                throw std::runtime_error("Expected a basic type");
+                // e.g. a struct copy, or a variable
+                return;
             }
             else if (expectedType->isFloatingPointTy())
             {
-                currentValue_ = llvm::ConstantFP::get(
-                    expectedType, node.expr_->eval().getDouble().value());
+                currentValue_ =
+                    llvm::ConstantFP::get(expectedType, *value.getDouble());
             }
             else if (basicType->isSigned())
             {
-                currentValue_ = llvm::ConstantInt::get(
-                    expectedType, node.expr_->eval().getInt().value());
+                currentValue_ =
+                    llvm::ConstantInt::get(expectedType, *value.getInt());
             }
             else
             {
-                currentValue_ = llvm::ConstantInt::get(
-                    expectedType, node.expr_->eval().getUInt().value());
+                currentValue_ =
+                    llvm::ConstantInt::get(expectedType, *value.getUInt());
             }
         }
     }
@@ -1391,8 +1431,7 @@ void CodeGenModule::visit(const InitList &node)
     if (currentStore_)
     {
         // Scenario 1. visitAsStore
-        visitRecursiveStore(
-            node, std::vector<llvm::Value *>{builder_->getInt32(0)});
+        visitRecursiveStore(node);
         currentValue_ = nullptr;
     }
     else
@@ -1402,59 +1441,42 @@ void CodeGenModule::visit(const InitList &node)
     }
 }
 
-void CodeGenModule::visitRecursiveStore(
-    const InitList &node,
-    std::vector<llvm::Value *> indices)
+void CodeGenModule::visitRecursiveStore(const InitList &node)
 {
+    llvm::Type *type = getLLVMType(currentExpectedType_);
     for (size_t i = 0; i < node.nodes_.size(); i++)
     {
         const BaseType *newType;
-        if (auto *arrType =
-                dynamic_cast<const ArrayType *>(currentExpectedType_))
+        if (auto *arrType = dynCast<ArrayType>(currentExpectedType_))
         {
-            newType = arrType->type_.get(); // Change the expected type
+            newType = arrType->type_; // Change the expected type
         }
-        else if (
-            auto *structType =
-                dynamic_cast<const StructType *>(currentExpectedType_))
+        else if (auto *structType = dynCast<StructType>(currentExpectedType_))
         {
             // Some long indirection going on but whatever...
-            newType =
-                structMap_.at(structType->getID())->types_[i].second.get();
+            newType = structMap_.at(structType->getID())->types_[i].second;
         }
 
-        std::visit(
-            [&](const Ptr<Init> &n)
-            {
-                // Push the index, pop on exit
-                llvm::Value *index = llvm::ConstantInt::get(
-                    llvm::Type::getInt32Ty(*context_), i);
-                ScopeGuard sg(indices, index);
-                llvm::Value *gep = builder_->CreateInBoundsGEP(
-                    getLLVMType(currentExpectedType_),
-                    currentStore_,
-                    indices,
-                    "gep");
-
-                if (auto *initList = dynamic_cast<const InitList *>(n.get()))
-                {
-                    // Recursive case
-                    ScopeGuard sg2(currentExpectedType_, newType);
-                    ScopeGuard sg3(currentStore_, gep);
-                    visitRecursiveStore(*initList, indices);
-                }
-                else
-                {
-                    // Base case (ScopeGuards inserted in function)
-                    visitAsStore(*n, gep, newType);
-                }
-            },
-            node.nodes_[i]);
+        // Nested lists recurse through visitAsStore, relative to this GEP
+        llvm::Value *gep = builder_->CreateInBoundsGEP(
+            type,
+            currentStore_,
+            {builder_->getInt32(0), builder_->getInt32(i)},
+            "gep");
+        visitAsStore(*std::get<const Init *>(node.nodes_[i]), gep, newType);
     }
 }
 
 llvm::Constant *CodeGenModule::visitRecursiveConst(const InitList &node)
 {
+    if (auto *arrType = dynCast<ArrayType>(currentExpectedType_))
+    {
+        if (isDataArrayInit(node, arrType))
+        {
+            return visitDataArrayConst(node, arrType);
+        }
+    }
+
     // Assume it's an array
     std::vector<llvm::Constant *> values;
     llvm::Type *type = getLLVMType(currentExpectedType_);
@@ -1462,38 +1484,46 @@ llvm::Constant *CodeGenModule::visitRecursiveConst(const InitList &node)
     for (size_t i = 0; i < node.nodes_.size(); i++)
     {
         const BaseType *newType;
-        if (auto *arrType =
-                dynamic_cast<const ArrayType *>(currentExpectedType_))
+        if (auto *arrType = dynCast<ArrayType>(currentExpectedType_))
         {
-            newType = arrType->type_.get(); // Change the expected type
+            newType = arrType->type_; // Change the expected type
         }
-        else if (
-            auto *structType =
-                dynamic_cast<const StructType *>(currentExpectedType_))
+        else if (auto *structType = dynCast<StructType>(currentExpectedType_))
         {
             // Some long indirection going on but whatever...
-            newType =
-                structMap_.at(structType->getID())->types_[i].second.get();
+            newType = structMap_.at(structType->getID())->types_[i].second;
         }
         ScopeGuard sg(currentExpectedType_, newType);
 
-        std::visit(
+        llvm::Value *index = builder_->getInt32(i);
+        ScopeGuard sg2(constIndices_, index);
+
+        llvm::Constant *val = std::visit(
             [&](const auto &n)
             {
-                if (auto *initList = dynamic_cast<const InitList *>(n.get()))
+                if (auto *initList = dynamic_cast<const InitList *>(n))
                 {
                     // Recursive case
-                    llvm::Constant *val = visitRecursiveConst(*initList);
-                    values.push_back(val);
+                    return visitRecursiveConst(*initList);
                 }
-                else
+
+                // Base case
+                llvm::Constant *val = visitAsConstant(*n, newType);
+                if (!val && dynamicInits_)
                 {
-                    // Base case
-                    llvm::Constant *val = visitAsConstant(*n, newType);
-                    values.push_back(val);
+                    // Zero for now, stored after the constant part is copied
+                    dynamicInits_->push_back({constIndices_, n, newType});
+                    val = llvm::Constant::getNullValue(getLLVMType(newType));
                 }
+                return val;
             },
             node.nodes_[i]);
+
+        if (!val)
+        {
+            return nullptr;
+        }
+        values.push_back(val);
     }
 
     // C99 6.7.8.21
@@ -1525,6 +1555,107 @@ llvm::Constant *CodeGenModule::visitRecursiveConst(const InitList &node)
         static_cast<llvm::StructType *>(type), values);
 }
 
+bool CodeGenModule::isDataArrayInit(
+    const InitList &node,
+    const ArrayType *arrType)
+{
+    if (!dynCast<BasicType>(arrType->type_) || node.nodes_.size() == 0 ||
+        node.nodes_.size() > arrType->size_)
+    {
+        return false;
+    }
+
+    llvm::Type *elementType = getLLVMType(arrType->type_);
+    if (!elementType->isIntegerTy(8) && !elementType->isIntegerTy(16) &&
+        !elementType->isIntegerTy(32) && !elementType->isIntegerTy(64) &&
+        !elementType->isFloatTy() && !elementType->isDoubleTy())
+    {
+        return false;
+    }
+
+    // Braces around a scalar, e.g. `{{1}, 2}`
+    return std::none_of(
+        node.nodes_.begin(),
+        node.nodes_.end(),
+        [](const auto &n)
+        {
+            return dynamic_cast<const InitList *>(
+                       std::get<const Init *>(n)->expr_) != nullptr;
+        });
+}
+
+llvm::Constant *CodeGenModule::visitDataArrayConst(
+    const InitList &node,
+    const ArrayType *arrType)
+{
+    // Elements are written straight into the array's bytes, so large tables
+    // don't create (and unique) a ConstantInt per element
+    llvm::Type *elementType = getLLVMType(arrType->type_);
+    bool isSigned = dynCast<BasicType>(arrType->type_)->isSigned();
+    size_t elementSize =
+        module_->getDataLayout().getTypeAllocSize(elementType);
+
+    // C99 6.7.8.21: the elements not listed are zero
+    std::string data(arrType->size_ * elementSize, '\0');
+    for (size_t i = 0; i < node.nodes_.size(); i++)
+    {
+        const Init *n = std::get<const Init *>(node.nodes_[i]);
+        EvalType value = getConstant(*n->expr_);
+        if (!value || value.is<std::string>())
+        {
+            if (!dynamicInits_)
+            {
+                return nullptr;
+            }
+            llvm::Value *index = builder_->getInt32(i);
+            ScopeGuard sg(constIndices_, index);
+            dynamicInits_->push_back({constIndices_, n, arrType->type_});
+            continue;
+        }
+
+        // In host byte order, as ConstantDataArray expects
+        char *dest = data.data() + i * elementSize;
+        if (elementType->isFloatTy())
+        {
+            float v = *value.getDouble();
+            std::memcpy(dest, &v, sizeof(v));
+        }
+        else if (elementType->isDoubleTy())
+        {
+            double v = *value.getDouble();
+            std::memcpy(dest, &v, sizeof(v));
+        }
+        else
+        {
+            // Truncated to the element's width, like ConstantInt::get
+            uint64_t bits = isSigned ? *value.getInt() : *value.getUInt();
+            switch (elementSize)
+            {
+            case 1:
+                *reinterpret_cast<uint8_t *>(dest) = bits;
+                break;
+            case 2:
+            {
+                uint16_t v = bits;
+                std::memcpy(dest, &v, sizeof(v));
+                break;
+            }
+            case 4:
+            {
+                uint32_t v = bits;
+                std::memcpy(dest, &v, sizeof(v));
+                break;
+            }
+            default:
+                std::memcpy(dest, &bits, sizeof(bits));
+                break;
+            }
+        }
+    }
+
+    return llvm::ConstantDataArray::getRaw(data, arrType->size_, elementType);
+}
+
 void CodeGenModule::visit(const Paren &node)
 {
     // Intentionally don't use the LValue/RValue handling
@@ -1546,8 +1677,8 @@ void CodeGenModule::visit(const SizeOf &node)
         throw std::runtime_error("SizeOf to LValue not supported");
     }
 
-    llvm::Type *type = (node.expr_) ? getLLVMType(node.expr_.get())
-                                    : getLLVMType(node.type_.get());
+    llvm::Type *type = (node.expr_) ? getLLVMType(node.expr_)
+                                    : getLLVMType(node.type_);
 
     currentValue_ = llvm::ConstantInt::get(
         llvm::Type::getInt64Ty(*context_),
@@ -1571,8 +1702,7 @@ void CodeGenModule::visit(const StructAccess &node)
     auto valueCategory = valueCategory_;
 
     llvm::Value *structPtr = visitAsLValue(*node.expr_);
-    auto structType =
-        dynamic_cast<const StructType *>(nodeMap_[node.expr_.get()].get());
+    auto structType = dynCast<StructType>(nodeMap_[node.expr_]);
     auto index =
         structMap_.at(structType->getID())->getMemberIndex(node.member_);
     llvm::Value *indices[] = {
@@ -1602,24 +1732,22 @@ void CodeGenModule::visit(const StructPtrAccess &node)
     // Only difference is that we need to load the pointer
     llvm::Value *structPtr;
     const StructType *structType;
-    llvm::Type *exprType = getLLVMType(node.expr_.get());
+    llvm::Type *exprType = getLLVMType(node.expr_);
     auto *zero = builder_->getInt32(0);
     if (exprType->isArrayTy())
     {
         structPtr = visitAsLValue(*node.expr_);
         structPtr =
             builder_->CreateInBoundsGEP(exprType, structPtr, {zero, zero});
-        auto arrayType =
-            dynamic_cast<const ArrayType *>(nodeMap_[node.expr_.get()].get());
-        structType = dynamic_cast<const StructType *>(arrayType->type_.get());
+        auto arrayType = dynCast<ArrayType>(nodeMap_[node.expr_]);
+        structType = dynCast<StructType>(arrayType->type_);
     }
     else
     {
         // Normal pointer type
         structPtr = visitAsRValue(*node.expr_);
-        auto ptrType =
-            dynamic_cast<const PtrType *>(nodeMap_[node.expr_.get()].get());
-        structType = dynamic_cast<const StructType *>(ptrType->type_.get());
+        auto ptrType = dynCast<PtrType>(nodeMap_[node.expr_]);
+        structType = dynCast<StructType>(ptrType->type_);
     }
     auto index =
         structMap_.at(structType->getID())->getMemberIndex(node.member_);
@@ -1651,8 +1779,8 @@ void CodeGenModule::visit(const TernaryOp &node)
     llvm::BasicBlock *lhsBB = llvm::BasicBlock::Create(*context_, "lhs", fn);
     llvm::BasicBlock *rhsBB = llvm::BasicBlock::Create(*context_, "rhs");
     llvm::BasicBlock *afterBB = llvm::BasicBlock::Create(*context_, "after");
-    auto lhsType = nodeMap_[node.lhs_.get()].get();
-    auto rhsType = nodeMap_[node.rhs_.get()].get();
+    auto lhsType = nodeMap_[node.lhs_];
+    auto rhsType = nodeMap_[node.rhs_];
     // Void types in the ternary operator (lhsType and rhsType) is valid in C
     bool isVoidType = getLLVMType(&node)->isVoidTy();
 
@@ -1717,8 +1845,8 @@ void CodeGenModule::visit(const UnaryOp &node)
     else
     {
         llvm::Value *expr, *add, *sub;
-        auto *expectedType = nodeMap_[&node].get();
-        llvm::Type *type = getLLVMType(node.expr_.get());
+        auto *expectedType = nodeMap_[&node];
+        llvm::Type *type = getLLVMType(node.expr_);
         bool isFloat = type->isFloatingPointTy();
         llvm::Value *one = (isFloat) ? llvm::ConstantFP::get(type, 1.0)
                                      : builder_->getInt32(1);
@@ -1791,7 +1919,7 @@ void CodeGenModule::visit(const UnaryOp &node)
             if (expr->getType()->isPointerTy())
             {
                 sub = builder_->CreateInBoundsGEP(
-                    getPointerElementType(node.expr_.get()),
+                    getPointerElementType(node.expr_),
                     expr,
                     builder_->getInt32(-1),
                     "postdec");
@@ -1810,7 +1938,7 @@ void CodeGenModule::visit(const UnaryOp &node)
             if (expr->getType()->isPointerTy())
             {
                 add = builder_->CreateInBoundsGEP(
-                    getPointerElementType(node.expr_.get()),
+                    getPointerElementType(node.expr_),
                     expr,
                     builder_->getInt32(1),
                     "postinc");
@@ -1828,7 +1956,7 @@ void CodeGenModule::visit(const UnaryOp &node)
             if (expr->getType()->isPointerTy())
             {
                 currentValue_ = builder_->CreateInBoundsGEP(
-                    getPointerElementType(node.expr_.get()),
+                    getPointerElementType(node.expr_),
                     expr,
                     builder_->getInt32(-1),
                     "predec");
@@ -1845,7 +1973,7 @@ void CodeGenModule::visit(const UnaryOp &node)
             if (expr->getType()->isPointerTy())
             {
                 currentValue_ = builder_->CreateInBoundsGEP(
-                    getPointerElementType(node.expr_.get()),
+                    getPointerElementType(node.expr_),
                     expr,
                     builder_->getInt32(1),
                     "preinc");
@@ -1908,12 +2036,33 @@ void CodeGenModule::visit(const Case &node)
     // Add the case to the switch
     if (node.expr_)
     {
-        // Must evaluate, it is a constant expression
-        // Must be an int (or unsigned int) due to integer promotion
-        uint64_t value = *node.expr_->eval().getUInt();
-        currentSwitch_->addCase(
-            llvm::ConstantInt::get(llvm::Type::getInt32Ty(*context_), value),
-            caseBB);
+        // C99 6.8.4.2: an integer constant expression, converted to the
+        // promoted type of the controlling expression
+        EvalType low = getConstant(*node.expr_);
+        EvalType high = node.rangeEnd_ ? getConstant(*node.rangeEnd_) : low;
+        if (!low || !high)
+        {
+            throw std::runtime_error("Case label is not a constant");
+        }
+
+        auto *type = llvm::cast<llvm::IntegerType>(
+            currentSwitch_->getCondition()->getType());
+        // A range of maxCaseRangeSize_ values or more is checked separately
+        if (*high.getInt() - *low.getInt() + 1 >= maxCaseRangeSize_)
+        {
+            // Checked by Switch, before the default case
+            currentCaseRanges_->push_back(
+                {*low.getInt(), *high.getInt(), caseBB});
+        }
+        else
+        {
+            // An empty range (e.g. `case 2 ... 1:`) has no values
+            for (int64_t i = *low.getInt(); i <= *high.getInt(); i++)
+            {
+                currentSwitch_->addCase(
+                    llvm::ConstantInt::get(type, i, true), caseBB);
+            }
+        }
     }
     else
     {
@@ -1963,7 +2112,8 @@ void CodeGenModule::visit(const DoWhile &node)
     builder_->SetInsertPoint(condBB);
     llvm::Value *cond = visitAsRValue(*node.cond_);
     cond = isNotZero(cond);
-    builder_->CreateCondBr(cond, loopBB, afterBB);
+    setExpectWeights(
+        builder_->CreateCondBr(cond, loopBB, afterBB), *node.cond_);
 
     // After loop
     fn->insert(fn->end(), afterBB);
@@ -2001,7 +2151,9 @@ void CodeGenModule::visit(const For &node)
     {
         llvm::Value *cond = visitAsRValue(*node.cond_->expr_);
         cond = isNotZero(cond);
-        builder_->CreateCondBr(cond, loopBB, afterBB);
+        setExpectWeights(
+            builder_->CreateCondBr(cond, loopBB, afterBB),
+            *node.cond_->expr_);
     }
     else
     {
@@ -2048,14 +2200,10 @@ void CodeGenModule::visit(const IfElse &node)
     llvm::BasicBlock *elseBB = llvm::BasicBlock::Create(*context_, "else");
     bool insertMergeBB = !node.elseStmt_;
 
-    if (node.elseStmt_)
-    {
-        builder_->CreateCondBr(cond, thenBB, elseBB);
-    }
-    else
-    {
-        builder_->CreateCondBr(cond, thenBB, mergeBB);
-    }
+    llvm::BranchInst *br = node.elseStmt_
+                               ? builder_->CreateCondBr(cond, thenBB, elseBB)
+                               : builder_->CreateCondBr(cond, thenBB, mergeBB);
+    setExpectWeights(br, *node.cond_);
 
     // Then block
     builder_->SetInsertPoint(thenBB);
@@ -2093,11 +2241,11 @@ void CodeGenModule::visit(const Return &node)
 {
     if (node.expr_)
     {
-        auto *expectedType = nodeMap_[&node].get();
+        auto *expectedType = nodeMap_[&node];
         auto *ty = getLLVMType(expectedType);
 
         // Return struct, in memory
-        if (dynamic_cast<const StructType *>(expectedType))
+        if (dynCast<StructType>(expectedType))
         {
             if (getCurrentFunction()->getReturnType()->isVoidTy())
             {
@@ -2135,12 +2283,22 @@ void CodeGenModule::visit(const Switch &node)
     llvm::BasicBlock *mergeBB =
         llvm::BasicBlock::Create(*context_, "switchcont");
 
-    llvm::Value *switchValue = visitAsRValue(*node.expr_);
+    // C99 6.8.4.2: "The integer promotions are performed on the controlling
+    // expression."
+    const BaseType *type = nodeMap_[node.expr_];
+    if (auto *basicType = dynCast<BasicType>(type))
+    {
+        type = astContext_.getBasicType(
+            TypeChecker::runIntegerPromotions(basicType->type_));
+    }
+    llvm::Value *switchValue = visitAsCastedRValue(*node.expr_, type);
 
     // mergeBB is default destination, may be replaced
     llvm::SwitchInst *switchInst = builder_->CreateSwitch(switchValue, mergeBB);
+    std::vector<CaseRange> caseRanges;
     ScopeGuard<llvm::SwitchInst *> sg(currentSwitch_, switchInst);
-    ScopeGuard<std::stack<llvm::BasicBlock *>> sg2(breakStack_, mergeBB);
+    ScopeGuard<std::vector<CaseRange> *> sg2(currentCaseRanges_, &caseRanges);
+    ScopeGuard<std::stack<llvm::BasicBlock *>> sg3(breakStack_, mergeBB);
 
     node.body_->accept(*this);
 
@@ -2150,6 +2308,45 @@ void CodeGenModule::visit(const Switch &node)
         builder_->CreateBr(mergeBB);
     }
 
+    // Large case ranges are tested in source order, before the default case
+    auto expected = getExpectedValue(*node.expr_);
+    auto *intType = llvm::cast<llvm::IntegerType>(switchValue->getType());
+    llvm::BasicBlock *defaultBB = switchInst->getDefaultDest();
+    for (auto it = caseRanges.rbegin(); it != caseRanges.rend(); ++it)
+    {
+        llvm::BasicBlock *rangeBB =
+            llvm::BasicBlock::Create(*context_, "caserange", fn);
+        builder_->SetInsertPoint(rangeBB);
+
+        // low <= x <= high is one unsigned compare, x - low <= high - low
+        llvm::Value *offset = builder_->CreateSub(
+            switchValue, llvm::ConstantInt::get(intType, it->low, true));
+        llvm::Value *inRange = builder_->CreateICmpULE(
+            offset, llvm::ConstantInt::get(intType, it->high - it->low));
+        llvm::BranchInst *br =
+            builder_->CreateCondBr(inRange, it->dest, defaultBB);
+        if (expected)
+        {
+            setBranchWeights(
+                br, it->low <= *expected && *expected <= it->high);
+        }
+        defaultBB = rangeBB;
+    }
+    switchInst->setDefaultDest(defaultBB);
+
+    // The expected case (or the default, if none matches) is the likely one
+    if (expected)
+    {
+        auto likelyCase = switchInst->findCaseValue(
+            llvm::ConstantInt::get(intType, *expected, true));
+        std::vector<uint32_t> weights(
+            switchInst->getNumSuccessors(), unlikelyWeight_);
+        weights[likelyCase->getSuccessorIndex()] = likelyWeight_;
+        llvm::MDBuilder mdBuilder(*context_);
+        switchInst->setMetadata(
+            llvm::LLVMContext::MD_prof, mdBuilder.createBranchWeights(weights));
+    }
+
     // Merge block
     fn->insert(fn->end(), mergeBB);
     builder_->SetInsertPoint(mergeBB);
@@ -2175,7 +2372,8 @@ void CodeGenModule::visit(const While &node)
     ScopeGuard<std::stack<llvm::BasicBlock *>> sg(breakStack_, afterBB);
     ScopeGuard<std::stack<llvm::BasicBlock *>> sg2(continueStack_, condBB);
     fn->insert(fn->end(), loopBB);
-    builder_->CreateCondBr(cond, loopBB, afterBB);
+    setExpectWeights(
+        builder_->CreateCondBr(cond, loopBB, afterBB), *node.cond_);
     builder_->SetInsertPoint(loopBB);
     node.body_->accept(*this);
     if (!builder_->GetInsertBlock()->getTerminator())
@@ -2195,12 +2393,216 @@ void CodeGenModule::visit(const While &node)
 llvm::AllocaInst *
 CodeGenModule::createAlignedAlloca(llvm::Type *type, const llvm::Twine &name)
 {
-    llvm::AllocaInst *inst = builder_->CreateAlloca(type, nullptr, name);
+    llvm::AllocaInst *inst = new llvm::AllocaInst(
+        type,
+        module_->getDataLayout().getAllocaAddrSpace(),
+        name,
+        allocaInsertPt_);
     inst->setAlignment(getAlign(type));
 
     return inst;
 }
 
+void CodeGenModule::emitAggregateInit(
+    const Init &init,
+    llvm::AllocaInst *alloca,
+    const BaseType *type,
+    const std::string &name)
+{
+    llvm::Type *ty = getLLVMType(type);
+
+    // Split into a constant part, written in bulk, and the elements only
+    // known at runtime, e.g. `{1, x, 3}`
+    std::vector<DynamicInit> dynamicInits;
+    llvm::Value *zero = builder_->getInt32(0);
+    llvm::Constant *cons;
+    {
+        ScopeGuard sg(dynamicInits_, &dynamicInits);
+        ScopeGuard sg2(constIndices_, zero);
+        cons = visitAsConstant(init, type);
+    }
+
+    if (!cons)
+    {
+        // Not an initializer list, e.g. a struct copy
+        visitAsStore(init, alloca, type);
+        return;
+    }
+
+    // Like clang: one memset if every byte is the same (e.g. all zero),
+    // otherwise zero then a few stores if the rest is zero, otherwise copy
+    // from a constant global
+    const llvm::DataLayout &dataLayout = module_->getDataLayout();
+    uint64_t size = dataLayout.getTypeAllocSize(ty);
+    InitStores stores;
+    std::vector<llvm::Value *> indices = {zero};
+    if (llvm::Value *byte = llvm::isBytewiseValue(cons, dataLayout))
+    {
+        if (llvm::isa<llvm::UndefValue>(byte))
+        {
+            byte = builder_->getInt8(0);
+        }
+        builder_->CreateMemSet(alloca, byte, size, getAlign(ty));
+    }
+    else if (
+        size > maxMemcpyInitSize_ &&
+        collectNonZeroStores(cons, indices, stores, maxInitStores_))
+    {
+        builder_->CreateMemSet(
+            alloca, builder_->getInt8(0), size, getAlign(ty));
+        for (const auto &[storeIndices, value] : stores)
+        {
+            llvm::Value *gep =
+                builder_->CreateInBoundsGEP(ty, alloca, storeIndices, "gep");
+            builder_->CreateStore(value, gep);
+        }
+    }
+    else
+    {
+        llvm::Constant *init = compressTrailingZeros(cons);
+        llvm::GlobalVariable *gb = createAlignedGlobalVariable(
+            *module_,
+            init->getType(),
+            /* isConstant */ true,
+            llvm::GlobalValue::InternalLinkage,
+            init,
+            "__const." + getLocalStaticName(name));
+        gb->setAlignment(getAlign(ty));
+        builder_->CreateMemCpy(alloca, getAlign(ty), gb, getAlign(ty), size);
+    }
+
+    for (const auto &dynamicInit : dynamicInits)
+    {
+        llvm::Value *gep = builder_->CreateInBoundsGEP(
+            ty, alloca, dynamicInit.indices, "gep");
+        visitAsStore(*dynamicInit.init, gep, dynamicInit.type);
+    }
+}
+
+bool CodeGenModule::collectNonZeroStores(
+    llvm::Constant *cons,
+    std::vector<llvm::Value *> &indices,
+    InitStores &stores,
+    size_t budget)
+{
+    if (cons->isNullValue())
+    {
+        return true;
+    }
+
+    if (auto *data = llvm::dyn_cast<llvm::ConstantDataSequential>(cons))
+    {
+        for (unsigned i = 0; i < data->getNumElements(); i++)
+        {
+            llvm::Value *index = builder_->getInt32(i);
+            ScopeGuard sg(indices, index);
+            if (!collectNonZeroStores(
+                    data->getElementAsConstant(i), indices, stores, budget))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    if (llvm::isa<llvm::ConstantAggregate>(cons))
+    {
+        for (unsigned i = 0; i < cons->getNumOperands(); i++)
+        {
+            llvm::Value *index = builder_->getInt32(i);
+            ScopeGuard sg(indices, index);
+            if (!collectNonZeroStores(
+                    cons->getAggregateElement(i), indices, stores, budget))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    stores.emplace_back(indices, cons);
+    return stores.size() <= budget;
+}
+
+llvm::Constant *CodeGenModule::compressTrailingZeros(llvm::Constant *cons)
+{
+    auto *arrayType = llvm::dyn_cast<llvm::ArrayType>(cons->getType());
+    if (!arrayType || cons->isNullValue())
+    {
+        return cons;
+    }
+
+    // Elements of a data array are compared as bytes, so -0.0 is kept
+    auto *data = llvm::dyn_cast<llvm::ConstantDataArray>(cons);
+    auto isZero = [&](uint64_t i)
+    {
+        if (data)
+        {
+            size_t size = data->getElementByteSize();
+            return data->getRawDataValues()
+                       .substr(i * size, size)
+                       .find_first_not_of('\0') == llvm::StringRef::npos;
+        }
+        return cons->getAggregateElement(i)->isNullValue();
+    };
+
+    uint64_t numElements = arrayType->getNumElements();
+    uint64_t length = numElements;
+    while (length > 0 && isZero(length - 1))
+    {
+        length--;
+    }
+    if (numElements - length < minTrailingZeros_)
+    {
+        return cons;
+    }
+
+    llvm::Type *elementType = arrayType->getElementType();
+    llvm::Constant *prefix;
+    if (data)
+    {
+        prefix = llvm::ConstantDataArray::getRaw(
+            data->getRawDataValues().take_front(
+                length * data->getElementByteSize()),
+            length,
+            elementType);
+    }
+    else
+    {
+        std::vector<llvm::Constant *> elements;
+        for (uint64_t i = 0; i < length; i++)
+        {
+            elements.push_back(cons->getAggregateElement(i));
+        }
+        prefix = llvm::ConstantArray::get(
+            llvm::ArrayType::get(elementType, length), elements);
+    }
+
+    // Packed, so the layout is the same as the array's
+    return llvm::ConstantStruct::getAnon(
+        {prefix,
+         llvm::ConstantAggregateZero::get(
+             llvm::ArrayType::get(elementType, numElements - length))},
+        /* Packed */ true);
+}
+
+void CodeGenModule::emitLifetimeStart(llvm::AllocaInst *alloca)
+{
+    // Markers only help the optimiser and stack colouring, so (like clang)
+    // they are left out at -O0. A switch can jump past a declaration into
+    // its scope, where the variable would be used before its start.
+    if (optLevel_ == OptLevel::O0 || currentSwitch_)
+    {
+        return;
+    }
+
+    builder_->CreateLifetimeStart(
+        alloca,
+        builder_->getInt64(module_->getDataLayout().getTypeAllocSize(
+            alloca->getAllocatedType())));
+    lifetimeScopes_.back().push_back(alloca);
+}
+
 llvm::GlobalVariable *CodeGenModule::createAlignedGlobalVariable(
     llvm::Module &M,
     llvm::Type *Ty,
@@ -2236,7 +2638,7 @@ llvm::Function *CodeGenModule::createFunction(
     const std::string &name)
 {
     std::vector<llvm::Type *> paramTypes = getParamTypes(fnType);
-    llvm::Type *originalRetType = getLLVMType(fnType->retType_.get());
+    llvm::Type *originalRetType = getLLVMType(fnType->retType_);
     auto fnParams = abi_->getFunctionParams(originalRetType, paramTypes);
 
     std::vector<llvm::Type *> flatParams;
@@ -2266,7 +2668,8 @@ llvm::Function *CodeGenModule::createFunction(
     for (size_t i = argPtr; i < fnParams.paramTypes.size(); i++)
     {
         size_t astIndex = i - fnParams.structReturnInMemory;
-        std::string paramName = fnType->getParamName(astIndex);
+        const std::string &paramName =
+            fnType->getParamName(astIndex).getName();
         llvm::Type *paramType = getLLVMType(fnType->getParamType(astIndex));
 
         // Label the function arguments
@@ -2326,16 +2729,15 @@ llvm::Function *CodeGenModule::getCurrentFunction() const
     return builder_->GetInsertBlock()->getParent();
 }
 
-std::string CodeGenModule::getLocalStaticName(const std::string &name) const
+std::string CodeGenModule::getLocalStaticName(const std::string &name)
 {
     // If already seen before, return "name.1" (local statics can only be
     // defined once, if it's defined again, it's in another scope, i.e. fresh)
-    static std::unordered_map<std::string, int> counter;
-    counter[name]++;
-    if (counter[name] > 1)
+    int count = ++localStaticCounter_[name];
+    if (count > 1)
     {
         return getCurrentFunction()->getName().str() + "." + name + "." +
-               std::to_string(counter[name]);
+               std::to_string(count);
     }
 
     return getCurrentFunction()->getName().str() + "." + name;
@@ -2343,107 +2745,81 @@ std::string CodeGenModule::getLocalStaticName(const std::string &name) const
 
 llvm::Type *CodeGenModule::getLLVMType(const BaseNode *node)
 {
-    return getLLVMType(nodeMap_.at(node).get());
+    return getLLVMType(nodeMap_.at(node));
 }
 
 llvm::Type *CodeGenModule::getLLVMType(const BaseType *type)
 {
-    // Basic types
-    if (auto basicType = dynamic_cast<const BasicType *>(type))
+    // Types are uniqued, so each one only needs lowering once
+    auto it = llvmTypes_.find(type);
+    if (it != llvmTypes_.end())
     {
-        return getLLVMType(basicType->type_);
+        return it->second;
     }
-    else if (auto fnType = dynamic_cast<const FnType *>(type))
+
+    llvm::Type *llvmType = lowerType(type);
+    llvmTypes_.emplace(type, llvmType);
+    return llvmType;
+}
+
+llvm::Type *CodeGenModule::lowerType(const BaseType *type)
+{
+    switch (type->tid_)
+    {
+    case BaseType::BaseTypeID:
+        return getLLVMType(static_cast<const BasicType *>(type)->type_);
+    case BaseType::FnTyID:
     {
+        auto *fnType = static_cast<const FnType *>(type);
         std::vector<llvm::Type *> paramTypes = getParamTypes(fnType);
-        return abi_->getFunctionType(
-            getLLVMType(fnType->retType_.get()), paramTypes);
+        return abi_->getFunctionType(getLLVMType(fnType->retType_), paramTypes);
     }
-    else if (auto arrType = dynamic_cast<const ArrayType *>(type))
+    case BaseType::ArrayTyID:
     {
-        // Must place ABOVE PtrType as it inherits PtrType
+        auto *arrType = static_cast<const ArrayType *>(type);
         return llvm::ArrayType::get(
-            getLLVMType(arrType->type_.get()), arrType->size_);
+            getLLVMType(arrType->type_), arrType->size_);
     }
-    else if (auto ptrType = dynamic_cast<const PtrType *>(type))
-    {
+    case BaseType::PtrTyID:
         // Opaque pointers do not contain the type they point to
         return llvm::PointerType::get(*context_, 0);
-    }
-    else if (auto structType = dynamic_cast<const StructType *>(type))
-    {
+    case BaseType::StructTyID:
         // Structs are not defined here
-        std::string name = "struct." + structType->name_;
-        auto it = std::find(
-            structIDs_[name].begin(),
-            structIDs_[name].end(),
-            structType->getID());
-
-        size_t index = it - structIDs_[name].begin();
-        if (index != 0)
-        {
-            name += "." + std::to_string(index);
-        }
-
-        if (auto *ty = llvm::StructType::getTypeByName(*context_, name))
-        {
-            return ty;
-        }
-
-        // Opaque structs
-        return llvm::StructType::create(*context_, name);
-    }
-    else if (auto enumType = dynamic_cast<const EnumType *>(type))
-    {
+        return getLLVMStructType(static_cast<const StructType *>(type));
+    case BaseType::EnumTypeID:
         // Enums are not defined here
         return llvm::Type::getInt32Ty(*context_);
+    case BaseType::ParamTyID:
+        break;
     }
 
     throw std::runtime_error("Unknown type");
 }
 
-llvm::Type *CodeGenModule::getLLVMType(Types ty)
+llvm::StructType *CodeGenModule::getLLVMStructType(const StructType *type)
 {
-    unsigned size = abi_->getTypeSize(ty);
-
-    switch (ty)
+    // Every declaration of a struct has its own ID. Later declarations with
+    // the same name are numbered, e.g. `struct.S.1`.
+    auto [it, inserted] = llvmStructTypes_.try_emplace(type->getID());
+    if (inserted)
     {
-    case Types::VOID:
-        return llvm::Type::getVoidTy(*context_);
-    case Types::BOOL:
-    case Types::CHAR:
-    case Types::UNSIGNED_CHAR:
-    case Types::SHORT:
-    case Types::UNSIGNED_SHORT:
-    case Types::INT:
-    case Types::UNSIGNED_INT:
-    case Types::LONG:
-    case Types::UNSIGNED_LONG:
-    case Types::LONG_LONG:
-    case Types::UNSIGNED_LONG_LONG:
-        return llvm::Type::getIntNTy(*context_, size);
-    case Types::FLOAT:
-    case Types::DOUBLE:
-    case Types::LONG_DOUBLE:
-        if (size == 32)
-        {
-            return llvm::Type::getFloatTy(*context_);
-        }
-        else if (size == 64)
-        {
-            return llvm::Type::getDoubleTy(*context_);
-        }
-        else if (size == 80)
-        {
-            return llvm::Type::getX86_FP80Ty(*context_);
-        }
-        else if (size == 128)
+        std::string name = "struct." + type->name_;
+        size_t index = structCounts_[name]++;
+        if (index != 0)
         {
-            return llvm::Type::getFP128Ty(*context_);
+            name += "." + std::to_string(index);
         }
+
+        // Opaque until its definition is visited
+        it->second = llvm::StructType::create(*context_, name);
     }
 
-    throw std::runtime_error("Unknown type");
+    return it->second;
+}
+
+llvm::Type *CodeGenModule::getLLVMType(Types ty)
+{
+    return abi_->getLLVMType(ty, *context_);
 }
 
 std::vector<llvm::Type *> CodeGenModule::getParamTypes(const FnType *fnType)
@@ -2451,7 +2827,7 @@ std::vector<llvm::Type *> CodeGenModule::getParamTypes(const FnType *fnType)
     std::vector<llvm::Type *> paramTypes;
     for (const auto &p : fnType->params_->types_)
     {
-        paramTypes.push_back(getLLVMType(p.second.get()));
+        paramTypes.push_back(getLLVMType(p.second));
     }
 
     return paramTypes;
@@ -2459,13 +2835,13 @@ std::vector<llvm::Type *> CodeGenModule::getParamTypes(const FnType *fnType)
 
 llvm::Type *CodeGenModule::getPointerElementType(const BaseNode *node)
 {
-    if (auto *ty = dynamic_cast<const ArrayType *>(nodeMap_[node].get()))
+    if (auto *ty = dynCast<ArrayType>(nodeMap_[node]))
     {
-        return getLLVMType(ty->type_.get());
+        return getLLVMType(ty->type_);
     }
-    else if (auto *ty = dynamic_cast<const PtrType *>(nodeMap_[node].get()))
+    else if (auto *ty = dynCast<PtrType>(nodeMap_[node]))
     {
-        return getLLVMType(ty->type_.get());
+        return getLLVMType(ty->type_);
     }
 
     throw std::runtime_error("Expected PtrType");
@@ -2483,13 +2859,18 @@ llvm::Value *CodeGenModule::visitAsLValue(const Expr &node)
     }
 
     llvm::AllocaInst *allocaInst =
-        createAlignedAlloca(getLLVMType(nodeMap_[&node].get()));
+        createAlignedAlloca(getLLVMType(nodeMap_[&node]));
     builder_->CreateStore(currentValue_, allocaInst);
     return allocaInst;
 }
 
 llvm::Value *CodeGenModule::visitAsRValue(const Expr &node)
 {
+    if (auto *constant = getFoldedConstant(node))
+    {
+        return constant;
+    }
+
     // Everything can be decayed into an RValue
     valueCategory_ = ValueCategory::RVALUE;
     node.accept(*this);
@@ -2500,7 +2881,12 @@ llvm::Value *CodeGenModule::visitAsCastedRValue(
     const Expr &node,
     const BaseType *expectedType)
 {
-    auto *initialType = nodeMap_[&node].get();
+    auto *initialType = nodeMap_[&node];
+
+    if (auto *constant = getFoldedConstant(node))
+    {
+        return runCast(constant, initialType, expectedType);
+    }
 
     if (getLLVMType(initialType)->isArrayTy())
     {
@@ -2532,6 +2918,85 @@ CodeGenModule::visitAsConstant(const Expr &node, const BaseType *expectedType)
     return static_cast<llvm::Constant *>(currentValue_);
 }
 
+EvalType CodeGenModule::getConstant(const Expr &node) const
+{
+    auto it = constantMap_.find(&node);
+    return (it != constantMap_.end()) ? it->second : EvalType();
+}
+
+llvm::Constant *CodeGenModule::getFoldedConstant(const Expr &node)
+{
+    // Pointers and string literals still need their globals and casts
+    EvalType value = getConstant(node);
+    const BaseType *type = nodeMap_[&node];
+    if (!value || value.is<std::string>() ||
+        !(dynCast<BasicType>(type) || dynCast<EnumType>(type)))
+    {
+        return nullptr;
+    }
+
+    llvm::Type *llvmType = getLLVMType(type);
+    if (llvmType->isFloatingPointTy())
+    {
+        return llvm::ConstantFP::get(llvmType, *value.getDouble());
+    }
+    // Sign extended (or not) to 64 bits by the TypeChecker
+    return llvm::ConstantInt::get(
+        llvmType, *value.getUInt(), value.is<int64_t>());
+}
+
+std::optional<int64_t> CodeGenModule::getExpectedValue(const Expr &cond) const
+{
+    const Expr *expr = &cond;
+    while (auto *paren = dynamic_cast<const Paren *>(expr))
+    {
+        if (!paren->expr_)
+        {
+            break;
+        }
+        expr = paren->expr_;
+    }
+
+    auto *call = dynamic_cast<const FnCall *>(expr);
+    if (!call || !isBuiltinExpect(*call))
+    {
+        return std::nullopt;
+    }
+
+    EvalType expected = getConstant(*std::get<0>(call->args_->nodes_[1]));
+    if (!expected)
+    {
+        return std::nullopt;
+    }
+    return *expected.getInt();
+}
+
+bool CodeGenModule::isBuiltinExpect(const FnCall &node)
+{
+    auto *fn = dynamic_cast<const Identifier *>(node.fn_);
+    return fn && fn->getID().getName() == "__builtin_expect" && node.args_ &&
+           node.args_->nodes_.size() == 2;
+}
+
+void CodeGenModule::setBranchWeights(llvm::BranchInst *br, bool isTrueLikely)
+{
+    llvm::MDBuilder mdBuilder(*context_);
+    br->setMetadata(
+        llvm::LLVMContext::MD_prof,
+        isTrueLikely
+            ? mdBuilder.createBranchWeights(likelyWeight_, unlikelyWeight_)
+            : mdBuilder.createBranchWeights(unlikelyWeight_, likelyWeight_));
+}
+
+void CodeGenModule::setExpectWeights(llvm::BranchInst *br, const Expr &cond)
+{
+    // e.g. `if (__builtin_expect(err, 0))` makes the else branch likely
+    if (auto expected = getExpectedValue(cond))
+    {
+        setBranchWeights(br, *expected != 0);
+    }
+}
+
 llvm::Value *CodeGenModule::visitAsStore(
     const Expr &node,
     llvm::Value *storeVal,
@@ -2614,20 +3079,16 @@ llvm::Value *CodeGenModule::visitAsStore(
     return val;
 }
 
-void CodeGenModule::symbolTablePush(std::string id, Symbol symbol)
+void CodeGenModule::symbolTablePush(AST::Symbol id, Symbol symbol)
 {
-    symbolTable_.back()[id] = symbol;
+    symbolTable_.insert(id, symbol);
 }
 
-Symbol CodeGenModule::symbolTableLookup(std::string id) const
+Symbol CodeGenModule::symbolTableLookup(AST::Symbol id) const
 {
-    for (auto it = symbolTable_.rbegin(); it != symbolTable_.rend(); ++it)
+    if (auto *symbol = symbolTable_.lookup(id))
     {
-        auto search = it->find(id);
-        if (search != it->end())
-        {
-            return search->second;
-        }
+        return *symbol;
     }
 
     return std::monostate{};
@@ -2635,12 +3096,28 @@ Symbol CodeGenModule::symbolTableLookup(std::string id) const
 
 void CodeGenModule::pushScope()
 {
-    symbolTable_.push_back(std::unordered_map<std::string, Symbol>());
+    symbolTable_.pushScope();
+    lifetimeScopes_.emplace_back();
 }
 
 void CodeGenModule::popScope()
 {
-    symbolTable_.pop_back();
+    symbolTable_.popScope();
+
+    // Only on the fall through path. Scopes left by return, break or continue
+    // end the lifetime implicitly, a repeated start is allowed.
+    std::vector<llvm::AllocaInst *> &allocas = lifetimeScopes_.back();
+    if (!allocas.empty() && !builder_->GetInsertBlock()->getTerminator())
+    {
+        for (auto it = allocas.rbegin(); it != allocas.rend(); ++it)
+        {
+            builder_->CreateLifetimeEnd(
+                *it,
+                builder_->getInt64(module_->getDataLayout().getTypeAllocSize(
+                    (*it)->getAllocatedType())));
+        }
+    }
+    lifetimeScopes_.pop_back();
 }
 
 llvm::Value *CodeGenModule::isNotZero(llvm::Value *val)
@@ -2673,8 +3150,8 @@ Types CodeGenModule::getArithmeticConversionType(
     const BaseType *lhs,
     const BaseType *rhs)
 {
-    auto lhsBasic = dynamic_cast<const BasicType *>(lhs);
-    auto rhsBasic = dynamic_cast<const BasicType *>(rhs);
+    auto lhsBasic = dynCast<BasicType>(lhs);
+    auto rhsBasic = dynCast<BasicType>(rhs);
 
     if (!lhsBasic || !rhsBasic)
     {
@@ -2714,7 +3191,7 @@ llvm::Value *CodeGenModule::runUsualArithmeticConversions(
         return lhsVal;
     }
 
-    auto *expectedType = new BasicType(t);
+    auto *expectedType = astContext_.getBasicType(t);
 
     return runCast(lhsVal, lhs, expectedType);
 }
@@ -2723,7 +3200,7 @@ void CodeGenModule::runIntegerPromotions(
     const BaseType *type,
     llvm::Value *&val)
 {
-    auto basicType = dynamic_cast<const BasicType *>(type);
+    auto basicType = dynCast<BasicType>(type);
 
     if (!basicType)
     {
@@ -2735,7 +3212,7 @@ void CodeGenModule::runIntegerPromotions(
 
     // sext is not allowed for i1 (because 1 -> -1)
     // doesn't matter if we want to promote to signed int
-    if (BasicType(t).isSigned() && val->getType()->isIntegerTy(1))
+    if (BasicType::isSigned(t) && val->getType()->isIntegerTy(1))
     {
         val = builder_->CreateSExt(val, getLLVMType(t));
     }
@@ -2777,8 +3254,8 @@ llvm::Value *CodeGenModule::runCast(
     }
 
     // Should be basic types now
-    auto *initialBasic = dynamic_cast<const BasicType *>(initialType);
-    auto *expectedBasic = dynamic_cast<const BasicType *>(expectedType);
+    auto *initialBasic = dynCast<BasicType>(initialType);
+    auto *expectedBasic = dynCast<BasicType>(expectedType);
 
     if (!initialBasic || !expectedBasic)
     {
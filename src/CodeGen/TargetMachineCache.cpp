@@ -0,0 +1,164 @@
+#include "CodeGen/TargetMachineCache.hpp"
+
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetOptions.h>
+
+#include <optional>
+#include <stdexcept>
+
+namespace CodeGen
+{
+
+/******************************************************************************
+ *                          Lease                                             *
+ *****************************************************************************/
+
+TargetMachineCache::Lease::Lease(Lease &&other) noexcept
+    : cache_(other.cache_), key_(std::move(other.key_)),
+      machine_(other.machine_)
+{
+    other.machine_ = nullptr;
+}
+
+TargetMachineCache::Lease &
+TargetMachineCache::Lease::operator=(Lease &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        cache_ = other.cache_;
+        key_ = std::move(other.key_);
+        machine_ = other.machine_;
+        other.machine_ = nullptr;
+    }
+    return *this;
+}
+
+TargetMachineCache::Lease::~Lease()
+{
+    reset();
+}
+
+void TargetMachineCache::Lease::reset() noexcept
+{
+    if (machine_)
+    {
+        cache_->release(key_, machine_);
+        machine_ = nullptr;
+    }
+}
+
+/******************************************************************************
+ *                          TargetMachineCache                                *
+ *****************************************************************************/
+
+TargetMachineCache &TargetMachineCache::getInstance()
+{
+    static TargetMachineCache cache;
+    return cache;
+}
+
+void TargetMachineCache::initializeTargets()
+{
+    // The registry is global and not thread safe, so only do this once per
+    // process. Only the backends we link are registered.
+    static std::once_flag targetsInitialised;
+    std::call_once(
+        targetsInitialised,
+        []()
+        {
+            auto start = Clock::now();
+
+            LLVMInitializeX86TargetInfo();
+            LLVMInitializeX86Target();
+            LLVMInitializeX86TargetMC();
+            LLVMInitializeX86AsmPrinter();
+            LLVMInitializeX86AsmParser();
+
+            LLVMInitializeAArch64TargetInfo();
+            LLVMInitializeAArch64Target();
+            LLVMInitializeAArch64TargetMC();
+            LLVMInitializeAArch64AsmPrinter();
+            LLVMInitializeAArch64AsmParser();
+
+            TargetMachineCache &cache = getInstance();
+            std::lock_guard<std::mutex> lock(cache.mutex_);
+            cache.stats_.initTime = Clock::now() - start;
+        });
+}
+
+TargetMachineCache::Lease TargetMachineCache::acquire(
+    const std::string &triple,
+    const std::string &cpu,
+    const std::string &features,
+    llvm::CodeGenOptLevel optLevel)
+{
+    initializeTargets();
+
+    Lease lease;
+    lease.cache_ = this;
+    // Neither triples nor CPU names contain spaces
+    lease.key_ = triple + " " + cpu + " " + features;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto &idle = idle_[lease.key_];
+        if (!idle.empty())
+        {
+            lease.machine_ = idle.back();
+            idle.pop_back();
+            stats_.numReused++;
+        }
+    }
+
+    if (!lease.machine_)
+    {
+        auto start = Clock::now();
+
+        std::string error;
+        auto *target = llvm::TargetRegistry::lookupTarget(triple, error);
+        if (!target)
+        {
+            throw std::runtime_error(error);
+        }
+
+        // PIC = Position Independent Code
+        llvm::TargetOptions opt;
+        std::unique_ptr<llvm::TargetMachine> machine(
+            target->createTargetMachine(
+                triple,
+                cpu,
+                features,
+                opt,
+                llvm::Reloc::Model::PIC_,
+                std::nullopt,
+                optLevel));
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        lease.machine_ = machine.get();
+        machines_.push_back(std::move(machine));
+        stats_.createTime += Clock::now() - start;
+        stats_.numCreated++;
+    }
+
+    // The only option that differs between jobs sharing a machine
+    lease.machine_->setOptLevel(optLevel);
+    return lease;
+}
+
+TargetMachineCache::Stats TargetMachineCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void TargetMachineCache::release(
+    const std::string &key,
+    llvm::TargetMachine *machine) noexcept
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_[key].push_back(machine);
+}
+
+} // namespace CodeGen
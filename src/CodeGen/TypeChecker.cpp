@@ -5,6 +5,9 @@
 #include "AST/Type.hpp"
 
 #include "CodeGen/ScopeGuard.hpp"
+#include "CodeGen/TargetMachineCache.hpp"
+
+#include "llvm/TargetParser/Host.h"
 
 #include <algorithm>
 #include <cassert>
@@ -18,93 +21,121 @@ namespace
 {
 bool checkType(const BaseType *actual, const BaseType *expected);
 bool assertIsIntegerTy(const BaseType *type);
+uint64_t alignTo(uint64_t size, uint64_t align);
+std::optional<Types> getArithmeticType(const BaseType *type);
+EvalType
+convertConstant(const EvalType &value, const BaseType *type, const ABI &abi);
 } // namespace
 
 /******************************************************************************
  *                          Declarations                                      *
  *****************************************************************************/
 
-TypeChecker::TypeChecker()
+TypeChecker::TypeChecker(ASTContext &astContext, std::string targetTriple)
+    : astContext_(astContext),
+      layoutContext_(std::make_unique<llvm::LLVMContext>()),
+      layoutModule_(std::make_unique<llvm::Module>("Layout", *layoutContext_))
 {
-    typeContext_.push_back({});
+    if (targetTriple.empty())
+    {
+        targetTriple = llvm::sys::getDefaultTargetTriple();
+    }
+
+    // The same layout CodeGen lowers the types with, so sizeof agrees
+    auto targetMachine = TargetMachineCache::getInstance().acquire(
+        targetTriple, "generic", "", llvm::CodeGenOptLevel::None);
+    layoutModule_->setDataLayout(targetMachine->createDataLayout());
+    layoutModule_->setTargetTriple(targetTriple);
+    abi_ = ABI::create(*layoutModule_);
+
+    typeContext_.pushScope();
+    constantContext_.pushScope();
+
+    // GCC builtins, implemented by CodeGen
+    // long __builtin_expect(long exp, long c)
+    auto *longType = astContext_.getBasicType(Types::LONG);
+    insertType(
+        astContext_.getIdentifier("__builtin_expect"),
+        astContext_.getFnType(
+            astContext_.getParamType(
+                {{Symbol(), longType}, {Symbol(), longType}}),
+            longType));
 }
 
 void TypeChecker::visit(const AbstractArrayDecl &node)
 {
     // Type check the size
     node.size_->accept(*this);
-    assertIsIntegerTy(nodeMap_[node.size_.get()].get());
+    assertIsIntegerTy(nodeMap_[node.size_]);
 
     // Attempt to get a size (otherwise, VLA)
-    auto size = node.size_->eval();
+    EvalType size = getConstant(node.size_);
 
     if (size)
     {
-        currentType_ =
-            std::make_unique<ArrayType>(currentType_->clone(), *size.getUInt());
+        currentType_ = astContext_.getArrayType(currentType_, *size.getUInt());
     }
     else
     {
-        currentType_ = std::make_unique<ArrayType>(currentType_->clone(), 0);
+        currentType_ = astContext_.getArrayType(currentType_, 0);
     }
 
     if (node.decl_)
     {
         node.decl_->accept(*this);
-        nodeMap_[&node] = nodeMap_[node.decl_.get()]->clone();
+        nodeMap_[&node] = nodeMap_[node.decl_];
     }
     else
     {
         // Technically not the truth, but our TypeChecker is dependent on this
         // otherwise, we have to do a lot of state tracking (annoying)
-        nodeMap_[&node] = currentType_->clone();
+        nodeMap_[&node] = currentType_;
     }
 }
 
 void TypeChecker::visit(const AbstractTypeDecl &node)
 {
     // Does not instantiate a type, rather passes information down
-    Ptr<BaseType> oldType = currentType_->clone();
+    const BaseType *oldType = currentType_;
     node.type_->accept(*this);
     node.decl_->accept(*this);
-    nodeMap_[&node] = nodeMap_[node.decl_.get()]->clone();
-    currentType_ = std::move(oldType);
+    nodeMap_[&node] = nodeMap_[node.decl_];
+    currentType_ = oldType;
 }
 
 void TypeChecker::visit(const ArrayDecl &node)
 {
     // Type check the size
     node.size_->accept(*this);
-    assertIsIntegerTy(nodeMap_[node.size_.get()].get());
+    assertIsIntegerTy(nodeMap_[node.size_]);
 
     // Attempt to get a size (otherwise, VLA)
-    auto size = node.size_->eval();
+    EvalType size = getConstant(node.size_);
 
     // Does not instantiate a type, rather passes information down
-    Ptr<BaseType> oldType = currentType_->clone();
+    const BaseType *oldType = currentType_;
     if (size)
     {
-        currentType_ =
-            std::make_unique<ArrayType>(currentType_->clone(), *size.getUInt());
+        currentType_ = astContext_.getArrayType(currentType_, *size.getUInt());
     }
     else
     {
-        currentType_ = std::make_unique<ArrayType>(currentType_->clone(), 0);
+        currentType_ = astContext_.getArrayType(currentType_, 0);
     }
     node.decl_->accept(*this);
-    nodeMap_[&node] = nodeMap_[node.decl_.get()]->clone();
-    currentType_ = std::move(oldType);
+    nodeMap_[&node] = nodeMap_[node.decl_];
+    currentType_ = oldType;
 }
 
 void TypeChecker::visit(const BasicTypeDecl &node)
 {
-    nodeMap_[&node] = std::make_unique<BasicType>(node.type_);
+    nodeMap_[&node] = astContext_.getBasicType(node.type_);
 }
 
 void TypeChecker::visit(const CompoundTypeDecl &node)
 {
     // Default to int if no type is found (e.g. signed)
-    currentType_ = std::make_unique<BasicType>(Types::INT);
+    currentType_ = astContext_.getBasicType(Types::INT);
 
     // First pass: Find base type
     for (const auto &variant : node.nodes_)
@@ -112,10 +143,10 @@ void TypeChecker::visit(const CompoundTypeDecl &node)
         std::visit(
             [this](const auto &decl)
             {
-                if (!dynamic_cast<const TypeModifier *>(decl.get()))
+                if (!dynamic_cast<const TypeModifier *>(decl))
                 {
                     decl->accept(*this);
-                    currentType_ = nodeMap_[decl.get()]->clone();
+                    currentType_ = nodeMap_[decl];
                 }
             },
             variant);
@@ -127,7 +158,7 @@ void TypeChecker::visit(const CompoundTypeDecl &node)
         std::visit(
             [this](const auto &decl)
             {
-                if (dynamic_cast<const TypeModifier *>(decl.get()))
+                if (dynamic_cast<const TypeModifier *>(decl))
                 {
                     decl->accept(*this);
                 }
@@ -135,20 +166,20 @@ void TypeChecker::visit(const CompoundTypeDecl &node)
             variant);
     }
 
-    nodeMap_[&node] = currentType_->clone();
+    nodeMap_[&node] = currentType_;
 }
 
 void TypeChecker::visit(const DeclNode &node)
 {
     // Pass type information down
     node.type_->accept(*this);
-    Ptr<BaseType> type = nodeMap_[node.type_.get()]->clone();
-    nodeMap_[&node] = type->clone();
+    const BaseType *type = nodeMap_[node.type_];
+    nodeMap_[&node] = type;
 
     // Type check the initializer list
     if (node.initDeclList_)
     {
-        currentType_ = type->clone();
+        currentType_ = type;
         node.initDeclList_->accept(*this);
     }
     else if (type->isStructTy())
@@ -156,8 +187,8 @@ void TypeChecker::visit(const DeclNode &node)
         // Struct declaration/definition (e.g. struct s;), not a struct instance
         // (e.g. struct s x;). This shadows an outer scope. We do it here, as
         // there's enough information here
-        auto *s = dynamic_cast<const StructType *>(type.get());
-        insertType(s->getName(), s->clone());
+        auto *s = static_cast<const StructType *>(type);
+        insertType(astContext_.getIdentifier(s->getName()), s);
     }
 }
 
@@ -170,35 +201,46 @@ void TypeChecker::visit(const Enum &node)
 {
     if (node.members_)
     {
-        // Only does type checking
-        node.members_->accept(*this);
-
         EnumConsts enumConsts;
         int lastSeenVal = -1;
         for (const auto &member : node.members_->nodes_)
         {
-            auto *enumMember = std::get<0>(member).get();
+            // One at a time, as a value may use the constants before it
+            auto *enumMember = std::get<0>(member);
+            enumMember->accept(*this);
 
-            int val = (enumMember->expr_) ? *enumMember->expr_->eval().getUInt()
-                                          : lastSeenVal + 1;
+            int val = lastSeenVal + 1;
+            if (enumMember->expr_)
+            {
+                EvalType value = getConstant(enumMember->expr_);
+                if (!value)
+                {
+                    throw std::runtime_error(
+                        "Error: Enumerator value is not a constant");
+                }
+                val = *value.getInt();
+            }
             enumConsts.push_back({enumMember->getID(), val});
+            constantContext_.insert(
+                enumMember->getID(), static_cast<int64_t>(val));
             lastSeenVal = val;
         }
 
-        nodeMap_[&node] = std::make_unique<EnumType>(node.name_, enumConsts);
-        insertType(node.getID(), nodeMap_[&node]->clone());
+        nodeMap_[&node] =
+            astContext_.getEnumType(node.name_.getName(), enumConsts);
+        insertType(node.getID(), nodeMap_[&node]);
     }
     else
     {
         // Grab the definition, if it exists
         if (auto t = lookupType(node.getID()))
         {
-            nodeMap_[&node] = std::move(t);
+            nodeMap_[&node] = t;
         }
         else
         {
             nodeMap_[&node] =
-                std::make_unique<EnumType>(node.name_, EnumConsts());
+                astContext_.getEnumType(node.name_.getName(), EnumConsts());
         }
     }
 }
@@ -209,10 +251,10 @@ void TypeChecker::visit(const EnumMember &node)
     if (node.expr_)
     {
         node.expr_->accept(*this);
-        assertIsIntegerTy(nodeMap_[node.expr_.get()].get());
+        assertIsIntegerTy(nodeMap_[node.expr_]);
     }
 
-    insertType(node.getID(), std::make_unique<BasicType>(Types::INT));
+    insertType(node.getID(), astContext_.getBasicType(Types::INT));
 }
 
 void TypeChecker::visit(const EnumMemberList &node)
@@ -226,37 +268,34 @@ void TypeChecker::visit(const EnumMemberList &node)
 
 void TypeChecker::visit(const FnDecl &node)
 {
-    Ptr<BaseType> retType = currentType_->clone();
+    const BaseType *retType = currentType_;
     node.params_->accept(*this);
-    Ptr<ParamType> params =
-        dynamic_cast<const ParamType *>(nodeMap_[node.params_.get()].get())
-            ->cloneAsDerived();
+    auto *params = static_cast<const ParamType *>(nodeMap_[node.params_]);
 
-    auto ty = std::make_unique<FnType>(std::move(params), std::move(retType));
-    nodeMap_[&node] = ty->clone();
+    auto *ty = astContext_.getFnType(params, retType);
+    nodeMap_[&node] = ty;
 
-    insertType(node.getID(), std::move(ty));
+    insertType(node.getID(), ty);
 }
 
 void TypeChecker::visit(const FnDef &node)
 {
     currentFunction_ = &node;
     node.retType_->accept(*this);
-    currentType_ = nodeMap_[node.retType_.get()]->clone();
+    currentType_ = nodeMap_[node.retType_];
 
     // Add enough context to the type map, including the parameters
     node.decl_->accept(*this);
-    nodeMap_[&node] = nodeMap_[node.decl_.get()]->clone();
+    nodeMap_[&node] = nodeMap_[node.decl_];
 
     // Parameters gets its own scope
     pushScope();
 
     // Add the parameters to the context
-    auto *fnType =
-        dynamic_cast<const FnType *>(nodeMap_[node.decl_.get()].get());
+    auto *fnType = dynCast<FnType>(nodeMap_[node.decl_]);
     for (const auto &param : fnType->params_->types_)
     {
-        insertType(param.first, param.second->clone());
+        insertType(param.first, param.second);
     }
 
     // Now run the type check (on the body)
@@ -272,19 +311,19 @@ void TypeChecker::visit(const InitDecl &node)
         ScopeGuard<bool> guard(fromDecl_, true);
         node.decl_->accept(*this);
     }
-    Ptr<BaseType> expectedType = nodeMap_[node.decl_.get()]->clone();
-    insertType(node.getID(), expectedType->clone());
+    const BaseType *expectedType = nodeMap_[node.decl_];
+    insertType(node.getID(), expectedType);
 
     if (node.init_)
     {
         node.init_->accept(*this);
 
         // Check the type of the expression
-        auto *actual = nodeMap_[node.init_.get()].get();
-        checkType(actual, expectedType.get());
+        auto *actual = nodeMap_[node.init_];
+        checkType(actual, expectedType);
     }
 
-    nodeMap_[&node] = std::move(expectedType);
+    nodeMap_[&node] = expectedType;
 }
 
 void TypeChecker::visit(const InitDeclList &node)
@@ -301,7 +340,7 @@ void TypeChecker::visit(const ParamDecl &node)
 {
     // Pass type information down
     node.type_->accept(*this);
-    currentType_ = nodeMap_[node.type_.get()]->clone();
+    currentType_ = nodeMap_[node.type_];
 
     // Don't insert into context yet, just collect types (we scan node.decl_ for
     // compound types)
@@ -309,20 +348,20 @@ void TypeChecker::visit(const ParamDecl &node)
     {
         ScopeGuard<bool> guard(fromDecl_, true);
         node.decl_->accept(*this);
-        nodeMap_[&node] = nodeMap_[node.decl_.get()]->clone();
+        nodeMap_[&node] = nodeMap_[node.decl_];
     }
     else
     {
-        nodeMap_[&node] = currentType_->clone();
+        nodeMap_[&node] = currentType_;
     }
 
     // Array types are not allowed in function parameters
-    auto *thisType = nodeMap_[&node].get();
-    if (auto *arrayType = dynamic_cast<const ArrayType *>(thisType))
+    auto *thisType = nodeMap_[&node];
+    if (auto *arrayType = dynCast<ArrayType>(thisType))
     {
         // Decay to a pointer type (we lose information, but this is OK, because
         // we don't care about UB)
-        nodeMap_[&node] = std::make_unique<PtrType>(arrayType->type_->clone());
+        nodeMap_[&node] = astContext_.getPtrType(arrayType->type_);
     }
 }
 
@@ -335,37 +374,35 @@ void TypeChecker::visit(const ParamList &node)
             [this, &types](const auto &param)
             {
                 param->accept(*this);
-                types.push_back(
-                    {param->getID(), nodeMap_[param.get()]->clone()});
+                types.push_back({param->getID(), nodeMap_[param]});
             },
             param);
     }
 
     // Parameter List can be the single keyword void (no parameters)
-    if (types.size() == 1 && types[0].first == "" &&
-        dynamic_cast<const BasicType *>(types[0].second.get())->type_ ==
-            Types::VOID)
+    if (types.size() == 1 && types[0].first.empty() &&
+        dynCast<BasicType>(types[0].second)->type_ == Types::VOID)
     {
         types.clear();
     }
 
-    nodeMap_[&node] = std::make_unique<ParamType>(std::move(types));
+    nodeMap_[&node] = astContext_.getParamType(std::move(types));
 }
 
 void TypeChecker::visit(const PtrDecl &node)
 {
     // Does not instantiate a type, rather passes information down
-    Ptr<BaseType> oldType = currentType_->clone();
+    const BaseType *oldType = currentType_;
     node.ptr_->accept(*this);
     node.decl_->accept(*this);
-    nodeMap_[&node] = nodeMap_[node.decl_.get()]->clone();
-    currentType_ = std::move(oldType);
+    nodeMap_[&node] = nodeMap_[node.decl_];
+    currentType_ = oldType;
 }
 
 void TypeChecker::visit(const PtrNode &node)
 {
     // Changes the type
-    currentType_ = std::make_unique<PtrType>(currentType_->clone());
+    currentType_ = astContext_.getPtrType(currentType_);
     if (node.ptr_)
     {
         node.ptr_->accept(*this);
@@ -373,7 +410,7 @@ void TypeChecker::visit(const PtrNode &node)
 
     // Technically not the truth, but our TypeChecker is dependent on this
     // otherwise, we have to do a lot of state tracking (annoying)
-    nodeMap_[&node] = currentType_->clone();
+    nodeMap_[&node] = currentType_;
 }
 
 void TypeChecker::visit(const Struct &node)
@@ -383,12 +420,10 @@ void TypeChecker::visit(const Struct &node)
         // Struct Definition
 
         // Grab the declaration/definition, if it exists
-        auto it = typeContext_.back().find(node.getID());
-        auto t = lookupType(node.getID());
-        bool foundInCurrentScope = it != typeContext_.back().end();
-        if (t && foundInCurrentScope)
+        auto *t = typeContext_.lookupInCurrentScope(node.getID());
+        if (t)
         {
-            size_t id = t->getID();
+            size_t id = (*t)->getID();
 
             if (structMap_.find(id) != structMap_.end())
             {
@@ -397,31 +432,28 @@ void TypeChecker::visit(const Struct &node)
 
             // Declaration found, now definition
             node.members_->accept(*this);
-            Ptr<ParamType> members = dynamic_cast<const ParamType *>(
-                                         nodeMap_[node.members_.get()].get())
-                                         ->cloneAsDerived();
+            auto *members =
+                static_cast<const ParamType *>(nodeMap_[node.members_]);
 
             // Reuse the ID- it is imperative for later in CodeGen
-            nodeMap_[&node] = std::make_unique<StructType>(
-                StructType::Type::STRUCT, node.name_, id);
-            structMap_[id] = std::move(members);
+            nodeMap_[&node] = astContext_.getStructType(
+                StructType::Type::STRUCT, node.name_.getName(), id);
+            structMap_[id] = members;
         }
         else
         {
             // Both undefined and undeclared in current scope
             // Necessary for the self referential struct to have the same ID
-            Ptr<StructType> emptyStruct = std::make_unique<StructType>(
-                StructType::Type::STRUCT, node.name_);
+            const StructType *emptyStruct = astContext_.createStructType(
+                StructType::Type::STRUCT, node.name_.getName());
             size_t id = emptyStruct->getID();
-            insertType(node.getID(), emptyStruct->clone());
+            insertType(node.getID(), emptyStruct);
             node.members_->accept(*this);
-            Ptr<ParamType> members = dynamic_cast<const ParamType *>(
-                                         nodeMap_[node.members_.get()].get())
-                                         ->cloneAsDerived();
+            auto *members =
+                static_cast<const ParamType *>(nodeMap_[node.members_]);
 
-            nodeMap_[&node] = std::make_unique<StructType>(
-                StructType::Type::STRUCT, node.name_, id);
-            structMap_[id] = std::move(members);
+            nodeMap_[&node] = emptyStruct;
+            structMap_[id] = members;
         }
     }
     else
@@ -429,12 +461,12 @@ void TypeChecker::visit(const Struct &node)
         // Grab the definition, if it exists
         if (auto t = lookupType(node.getID()))
         {
-            nodeMap_[&node] = t->clone();
+            nodeMap_[&node] = t;
         }
         else
         {
-            nodeMap_[&node] = std::make_unique<StructType>(
-                StructType::Type::STRUCT, node.name_);
+            nodeMap_[&node] = astContext_.createStructType(
+                StructType::Type::STRUCT, node.name_.getName());
         }
     }
 }
@@ -443,7 +475,7 @@ void TypeChecker::visit(const StructDecl &node)
 {
     ScopeGuard guard(fromDecl_, true);
     node.decl_->accept(*this);
-    nodeMap_[&node] = nodeMap_[node.decl_.get()]->clone();
+    nodeMap_[&node] = nodeMap_[node.decl_];
 }
 
 void TypeChecker::visit(const StructDeclList &node)
@@ -457,20 +489,20 @@ void TypeChecker::visit(const StructDeclList &node)
             {
                 // "Returns" any type
                 decl->accept(*this);
-                types.push_back({decl->getID(), nodeMap_[decl.get()]->clone()});
+                types.push_back({decl->getID(), nodeMap_[decl]});
             },
             decl);
     }
 
-    nodeMap_[&node] = std::make_unique<ParamType>(std::move(types));
+    nodeMap_[&node] = astContext_.getParamType(std::move(types));
 }
 
 void TypeChecker::visit(const StructMember &node)
 {
     node.type_->accept(*this);
-    currentType_ = nodeMap_[node.type_.get()]->clone();
+    currentType_ = nodeMap_[node.type_];
     node.declList_->accept(*this);
-    nodeMap_[&node] = nodeMap_[node.declList_.get()]->clone();
+    nodeMap_[&node] = nodeMap_[node.declList_];
 }
 
 void TypeChecker::visit(const StructMemberList &node)
@@ -484,17 +516,16 @@ void TypeChecker::visit(const StructMemberList &node)
             {
                 // "Returns" a ParamType
                 member->accept(*this);
-                auto *paramType = dynamic_cast<const ParamType *>(
-                    nodeMap_[member.get()].get());
+                auto *paramType = dynCast<ParamType>(nodeMap_[member]);
                 for (const auto &type : paramType->types_)
                 {
-                    types.push_back({type.first, type.second->clone()});
+                    types.push_back({type.first, type.second});
                 }
             },
             member);
     }
 
-    nodeMap_[&node] = std::make_unique<ParamType>(std::move(types));
+    nodeMap_[&node] = astContext_.getParamType(std::move(types));
 }
 
 void TypeChecker::visit(const TranslationUnit &node)
@@ -510,7 +541,7 @@ void TypeChecker::visit(const Typedef &node)
     // Actually REALLY simple to implement, this can be treated EXACTLY like a
     // normal declaration
     node.type_->accept(*this);
-    nodeMap_[&node] = nodeMap_[node.type_.get()]->clone();
+    nodeMap_[&node] = nodeMap_[node.type_];
 }
 
 void TypeChecker::visit(const TypeModifier &node)
@@ -523,8 +554,7 @@ void TypeChecker::visit(const TypeModifier &node)
     auto visitComplex = [this](Complex c)
     {
         // MUST be a BasicType
-        auto *basicType =
-            dynamic_cast<const BasicType *>(this->currentType_.get());
+        auto *basicType = dynCast<BasicType>(this->currentType_);
         if (!basicType)
         {
             throw std::runtime_error("Expected basic type");
@@ -567,37 +597,46 @@ void TypeChecker::visit(const TypeModifier &node)
             break;
         }
 
-        this->currentType_ = std::make_unique<BasicType>(t);
+        this->currentType_ = this->astContext_.getBasicType(t);
     };
-    auto visitCVRQualifier = [this](CVRQualifier cvr)
+    // Types are immutable, so modifiers swap in the requalified type
+    Qualifiers quals = currentType_->getQualifiers();
+    auto requalify = [this, &quals]()
+    {
+        this->currentType_ =
+            this->astContext_.getQualifiedType(this->currentType_, quals);
+    };
+
+    auto visitCVRQualifier = [&](CVRQualifier cvr)
     {
         switch (cvr)
         {
         case CVRQualifier::CONST:
-            this->currentType_->cvrQualifier_ = CVRQualifier::CONST;
+            quals.cvrQualifier = CVRQualifier::CONST;
             break;
         case CVRQualifier::VOLATILE:
-            this->currentType_->cvrQualifier_ = CVRQualifier::VOLATILE;
+            quals.cvrQualifier = CVRQualifier::VOLATILE;
             break;
         case CVRQualifier::RESTRICT:
-            this->currentType_->cvrQualifier_ = CVRQualifier::RESTRICT;
+            quals.cvrQualifier = CVRQualifier::RESTRICT;
             break;
         }
+        requalify();
     };
-    auto visitFunctionSpecifier = [this](FunctionSpecifier fs)
+    auto visitFunctionSpecifier = [&](FunctionSpecifier fs)
     {
         switch (fs)
         {
         case FunctionSpecifier::INLINE:
-            this->currentType_->functionSpecifier_ = FunctionSpecifier::INLINE;
+            quals.functionSpecifier = FunctionSpecifier::INLINE;
             break;
         }
+        requalify();
     };
-    auto visitLength = [this](Length l)
+    auto visitLength = [this, &quals](Length l)
     {
         // MUST be a BasicType
-        auto *basicType =
-            dynamic_cast<const BasicType *>(this->currentType_.get());
+        auto *basicType = dynCast<BasicType>(this->currentType_);
         if (!basicType)
         {
             throw std::runtime_error("Expected basic type");
@@ -622,18 +661,12 @@ void TypeChecker::visit(const TypeModifier &node)
             throw std::runtime_error("Invalid type for length modifier");
         }
 
-        this->currentType_ = std::make_unique<BasicType>(
-            t,
-            this->currentType_->cvrQualifier_,
-            this->currentType_->functionSpecifier_,
-            this->currentType_->linkage_,
-            this->currentType_->storageDuration_);
+        this->currentType_ = this->astContext_.getBasicType(t, quals);
     };
-    auto visitSignedness = [this](Signedness s)
+    auto visitSignedness = [this, &quals](Signedness s)
     {
         // MUST be a BasicType
-        auto *basicType =
-            dynamic_cast<const BasicType *>(this->currentType_.get());
+        auto *basicType = dynCast<BasicType>(this->currentType_);
         if (!basicType)
         {
             throw std::runtime_error("Expected basic type");
@@ -666,33 +699,29 @@ void TypeChecker::visit(const TypeModifier &node)
                 throw std::runtime_error(
                     "Invalid type for signedness modifier");
             }
-            this->currentType_ = std::make_unique<BasicType>(
-                ty,
-                this->currentType_->cvrQualifier_,
-                this->currentType_->functionSpecifier_,
-                this->currentType_->linkage_,
-                this->currentType_->storageDuration_);
+            this->currentType_ = this->astContext_.getBasicType(ty, quals);
             break;
         }
     };
-    auto visitStorageClass = [this](StorageClass sc)
+    auto visitStorageClass = [&](StorageClass sc)
     {
         switch (sc)
         {
         case StorageClass::AUTO:
         case StorageClass::REGISTER:
-            this->currentType_->linkage_ = Linkage::NONE;
-            this->currentType_->storageDuration_ = StorageDuration::AUTO;
+            quals.linkage = Linkage::NONE;
+            quals.storageDuration = StorageDuration::AUTO;
             break;
         case StorageClass::STATIC:
-            this->currentType_->linkage_ = Linkage::INTERNAL;
-            this->currentType_->storageDuration_ = StorageDuration::STATIC;
+            quals.linkage = Linkage::INTERNAL;
+            quals.storageDuration = StorageDuration::STATIC;
             break;
         case StorageClass::EXTERN:
-            this->currentType_->linkage_ = Linkage::EXTERNAL;
-            this->currentType_->storageDuration_ = StorageDuration::STATIC;
+            quals.linkage = Linkage::EXTERNAL;
+            quals.storageDuration = StorageDuration::STATIC;
             break;
         }
+        requalify();
     };
 
     std::visit(
@@ -715,20 +744,20 @@ void TypeChecker::visit(const ArrayAccess &node)
     // Check the type of the array and index
     node.arr_->accept(*this);
     node.index_->accept(*this);
-    auto *arrayType = nodeMap_[node.arr_.get()].get();
-    auto *indexType = nodeMap_[node.index_.get()].get();
+    auto *arrayType = nodeMap_[node.arr_];
+    auto *indexType = nodeMap_[node.index_];
 
     // Weird semantics but allowed in C... `a[5] == 5[a]`
-    if (dynamic_cast<const BasicType *>(arrayType))
+    if (dynCast<BasicType>(arrayType))
     {
         // Swap for the purposes of type checking
         std::swap(arrayType, indexType);
     }
 
     // ArrayType can be coerced into PtrType, no info is lost
-    if (auto *t = dynamic_cast<const PtrType *>(arrayType))
+    if (auto *t = dynCast<PtrType>(arrayType))
     {
-        nodeMap_[&node] = t->type_->clone();
+        nodeMap_[&node] = t->type_;
     }
     else
     {
@@ -745,11 +774,11 @@ void TypeChecker::visit(const Assignment &node)
     node.lhs_->accept(*this);
     node.rhs_->accept(*this);
 
-    auto *lhs = nodeMap_[node.lhs_.get()].get();
-    auto *rhs = nodeMap_[node.rhs_.get()].get();
+    auto *lhs = nodeMap_[node.lhs_];
+    auto *rhs = nodeMap_[node.rhs_];
 
     // TODO: Do this properly
-    nodeMap_[&node] = lhs->clone();
+    nodeMap_[&node] = lhs;
 }
 
 void TypeChecker::visit(const ArgExprList &node)
@@ -762,11 +791,11 @@ void TypeChecker::visit(const ArgExprList &node)
             {
                 arg->accept(*this);
                 // Ignore the name of the parameter
-                types.push_back({"", nodeMap_[arg.get()]->clone()});
+                types.push_back({Symbol(), nodeMap_[arg]});
             },
             arg);
     }
-    nodeMap_[&node] = std::make_unique<ParamType>(std::move(types));
+    nodeMap_[&node] = astContext_.getParamType(std::move(types));
 }
 
 void TypeChecker::visit(const BinaryOp &node)
@@ -777,8 +806,8 @@ void TypeChecker::visit(const BinaryOp &node)
     node.lhs_->accept(*this);
     node.rhs_->accept(*this);
 
-    auto *lhs = nodeMap_[node.lhs_.get()].get();
-    auto *rhs = nodeMap_[node.rhs_.get()].get();
+    auto *lhs = nodeMap_[node.lhs_];
+    auto *rhs = nodeMap_[node.rhs_];
 
     switch (node.op_)
     {
@@ -791,21 +820,21 @@ void TypeChecker::visit(const BinaryOp &node)
     case Op::LAND:
     case Op::LOR:
         // Result is always a bool
-        nodeMap_[&node] = std::make_unique<BasicType>(Types::BOOL);
+        nodeMap_[&node] = astContext_.getBasicType(Types::BOOL);
         break;
     default:
         // Pointer arithmetic
-        auto *lhsPtr = dynamic_cast<const PtrType *>(lhs);
-        auto *rhsPtr = dynamic_cast<const PtrType *>(rhs);
-        auto *lhsArray = dynamic_cast<const ArrayType *>(lhs);
-        auto *rhsArray = dynamic_cast<const ArrayType *>(rhs);
+        auto *lhsPtr = dynCast<PtrType>(lhs);
+        auto *rhsPtr = dynCast<PtrType>(rhs);
+        auto *lhsArray = dynCast<ArrayType>(lhs);
+        auto *rhsArray = dynCast<ArrayType>(rhs);
         if (lhsPtr || lhsArray)
         {
             if (rhsPtr || rhsArray)
             {
                 // Pointer subtraction, must be same type
                 checkType(lhs, rhs);
-                nodeMap_[&node] = std::make_unique<BasicType>(Types::INT);
+                nodeMap_[&node] = astContext_.getBasicType(Types::INT);
             }
             else
             {
@@ -813,12 +842,11 @@ void TypeChecker::visit(const BinaryOp &node)
                 if (lhsArray)
                 {
                     // Array decay
-                    nodeMap_[&node] =
-                        std::make_unique<PtrType>(lhsArray->type_->clone());
+                    nodeMap_[&node] = astContext_.getPtrType(lhsArray->type_);
                 }
                 else
                 {
-                    nodeMap_[&node] = lhsPtr->clone();
+                    nodeMap_[&node] = lhsPtr;
                 }
             }
         }
@@ -828,29 +856,59 @@ void TypeChecker::visit(const BinaryOp &node)
             if (rhsArray)
             {
                 // Array decay
-                nodeMap_[&node] =
-                    std::make_unique<PtrType>(rhsArray->type_->clone());
+                nodeMap_[&node] = astContext_.getPtrType(rhsArray->type_);
             }
             else
             {
-                nodeMap_[&node] = rhsPtr->clone();
+                nodeMap_[&node] = rhsPtr;
             }
         }
         else
         {
             // Must be BasicType
-            auto *lhsBasic = dynamic_cast<const BasicType *>(lhs);
-            auto *rhsBasic = dynamic_cast<const BasicType *>(rhs);
+            auto *lhsBasic = dynCast<BasicType>(lhs);
+            auto *rhsBasic = dynCast<BasicType>(rhs);
             if (!lhsBasic || !rhsBasic)
             {
                 throw std::runtime_error("Error: Expected basic type");
                 return;
             }
             nodeMap_[&node] =
-                std::make_unique<BasicType>(runUsualArithmeticConversions(
+                astContext_.getBasicType(runUsualArithmeticConversions(
                     lhsBasic->type_, rhsBasic->type_));
         }
     }
+
+    // Both operands are converted to their common type before the operation
+    auto lhsType = getArithmeticType(lhs);
+    auto rhsType = getArithmeticType(rhs);
+    if (!lhsType || !rhsType)
+    {
+        return;
+    }
+    auto *commonType = astContext_.getBasicType(
+        runUsualArithmeticConversions(*lhsType, *rhsType));
+    EvalType l = convertConstant(getConstant(node.lhs_), commonType, *abi_);
+    EvalType r = convertConstant(getConstant(node.rhs_), commonType, *abi_);
+    if (!l || !r)
+    {
+        return;
+    }
+
+    // Undefined behaviour is left for the program to run into, not rcc
+    if (!r.is<double>())
+    {
+        bool isDivision = node.op_ == Op::DIV || node.op_ == Op::MOD;
+        bool isShift = node.op_ == Op::SHL || node.op_ == Op::SHR;
+        if ((isDivision && *r.getUInt() == 0) ||
+            (isDivision && *r.getInt() == -1 &&
+             *l.getInt() == std::numeric_limits<int64_t>::min()) ||
+            (isShift && *r.getUInt() >= 64))
+        {
+            return;
+        }
+    }
+    foldConstant(node, node.fold(l, r));
 }
 
 void TypeChecker::visit(const Cast &node)
@@ -860,13 +918,14 @@ void TypeChecker::visit(const Cast &node)
 
     // Check the type of the cast
     node.type_->accept(*this);
-    auto *castType = nodeMap_[node.type_.get()].get();
-    auto *exprType = nodeMap_[node.expr_.get()].get();
+    auto *castType = nodeMap_[node.type_];
+    auto *exprType = nodeMap_[node.expr_];
 
     // Since C is uncivilized, we can cast pretty much anything to anything
     // Therefore, don't run checkType()
 
-    nodeMap_[&node] = castType->clone();
+    nodeMap_[&node] = castType;
+    foldConstant(node, getConstant(node.expr_));
 }
 
 void TypeChecker::visit(const Constant &node)
@@ -874,12 +933,9 @@ void TypeChecker::visit(const Constant &node)
     // C99 6.4.4 Constants
     Types t;
     std::string value = node.value_;
+    EvalType constant = node.eval();
 
-    if (value.find('.') != std::string::npos ||
-        value.find('e') != std::string::npos ||
-        value.find('E') != std::string::npos ||
-        value.find('p') != std::string::npos ||
-        value.find('P') != std::string::npos)
+    if (node.isFloating())
     {
         // Floating point constant
         if (value.back() == 'f' || value.back() == 'F')
@@ -911,7 +967,7 @@ void TypeChecker::visit(const Constant &node)
     else
     {
         // Integer constant
-        auto x = value.find_first_not_of("0123456789x");
+        auto x = value.find_first_of("uUlL");
         std::string suffix = (x == std::string::npos) ? "" : value.substr(x);
         bool isUnsigned = suffix.find('u') != std::string::npos ||
                           suffix.find('U') != std::string::npos;
@@ -919,72 +975,50 @@ void TypeChecker::visit(const Constant &node)
                       suffix.find('L') != std::string::npos;
         bool isLongLong = suffix.find("ll") != std::string::npos ||
                           suffix.find("LL") != std::string::npos;
-
-        // Helper function to determine the type of the integer constant
-        auto getTypeForValue = [](const std::string &value, bool isUnsigned)
+        // Octal and hexadecimal constants may also be unsigned
+        bool isDecimal = value[0] != '0';
+
+        // C99 6.4.4.1.5: "The type of an integer constant is the first of
+        // the corresponding list in which its value can be represented."
+        uint64_t val = *constant.getUInt();
+        Types first = isLongLong ? Types::LONG_LONG
+                      : isLong   ? Types::LONG
+                                 : Types::INT;
+        t = Types::UNSIGNED_LONG_LONG;
+        for (Types candidate :
+             {Types::INT,
+              Types::UNSIGNED_INT,
+              Types::LONG,
+              Types::UNSIGNED_LONG,
+              Types::LONG_LONG,
+              Types::UNSIGNED_LONG_LONG})
         {
-            if (isUnsigned)
+            bool isSigned = BasicType::isSigned(candidate);
+            if (candidate < first || (isSigned && isUnsigned) ||
+                (!isSigned && isDecimal && !isUnsigned))
             {
-                unsigned long long val = std::stoull(value);
-                if (val <= std::numeric_limits<unsigned int>::max())
-                {
-                    return Types::UNSIGNED_INT;
-                }
-                else if (val <= std::numeric_limits<unsigned long>::max())
-                {
-                    return Types::UNSIGNED_LONG;
-                }
-                else
-                {
-                    return Types::UNSIGNED_LONG_LONG;
-                }
+                continue;
             }
-            else
+
+            // The largest value of a signed type has one bit fewer
+            int bits = abi_->getTypeSize(candidate) - isSigned;
+            if (bits == 64 || val < (uint64_t(1) << bits))
             {
-                long long val = std::stoll(value);
-                if (val <= std::numeric_limits<int>::max() &&
-                    val >= std::numeric_limits<int>::min())
-                {
-                    return Types::INT;
-                }
-                else if (
-                    val <= std::numeric_limits<long>::max() &&
-                    val >= std::numeric_limits<long>::min())
-                {
-                    return Types::LONG;
-                }
-                else
-                {
-                    return Types::LONG_LONG;
-                }
+                t = candidate;
+                break;
             }
-        };
-
-        if (isLongLong)
-        {
-            t = isUnsigned ? Types::UNSIGNED_LONG_LONG : Types::LONG_LONG;
-        }
-        else if (isLong)
-        {
-            t = isUnsigned
-                    ? std::max(
-                          Types::UNSIGNED_LONG, getTypeForValue(value, true))
-                    : std::max(Types::LONG, getTypeForValue(value, false));
-        }
-        else
-        {
-            t = getTypeForValue(value, isUnsigned);
         }
     }
 
-    nodeMap_[&node] = std::make_unique<BasicType>(t);
+    nodeMap_[&node] = astContext_.getBasicType(t);
+    foldConstant(node, constant);
 }
 
 void TypeChecker::visit(const FnCall &node)
 {
     // Check the type of the function
     node.fn_->accept(*this);
-    auto *fnType = dynamic_cast<const FnType *>(nodeMap_[node.fn_.get()].get());
+    auto *fnType = dynCast<FnType>(nodeMap_[node.fn_]);
     if (!fnType)
     {
         throw std::runtime_error("Error: Expected function type");
@@ -996,8 +1030,7 @@ void TypeChecker::visit(const FnCall &node)
         node.args_->accept(*this);
 
         // Check the type of the arguments
-        auto *argType =
-            dynamic_cast<const ParamType *>(nodeMap_[node.args_.get()].get());
+        auto *argType = dynCast<ParamType>(nodeMap_[node.args_]);
         if (!argType)
         {
             throw std::runtime_error("Error: Expected parameter type");
@@ -1020,10 +1053,10 @@ void TypeChecker::visit(const FnCall &node)
         }
 
         // All get casted to the declared types
-        nodeMap_[node.args_.get()] = fnType->params_->clone();
+        nodeMap_[node.args_] = fnType->params_;
     }
 
-    nodeMap_[&node] = fnType->retType_->clone();
+    nodeMap_[&node] = fnType->retType_;
 }
 
 void TypeChecker::visit(const Identifier &node)
@@ -1031,37 +1064,43 @@ void TypeChecker::visit(const Identifier &node)
     // Problem is that Identifier is both an Expr and a Decl
     if (fromDecl_)
     {
-        nodeMap_[&node] = currentType_->clone();
+        nodeMap_[&node] = currentType_;
     }
     else
     {
         nodeMap_[&node] = lookupType(node.getID());
+
+        // Enum constants
+        if (auto *value = constantContext_.lookup(node.getID()))
+        {
+            foldConstant(node, *value);
+        }
     }
 }
 
 void TypeChecker::visit(const Init &node)
 {
     node.expr_->accept(*this);
-    nodeMap_[&node] = nodeMap_[node.expr_.get()]->clone();
+    nodeMap_[&node] = nodeMap_[node.expr_];
+    foldConstant(node, getConstant(node.expr_));
 }
 
 void TypeChecker::visit(const InitList &node)
 {
-    Ptr<BaseType> type = nullptr;
+    const BaseType *type = nullptr;
     for (const auto &init : node.nodes_)
     {
         std::visit(
             [this, &type](const auto &init)
             {
                 init->accept(*this);
-                type = nodeMap_[init.get()]->clone();
+                type = nodeMap_[init];
             },
             init);
     }
 
     // Could be struct or array, handle struct later
-    nodeMap_[&node] =
-        std::make_unique<ArrayType>(std::move(type), node.nodes_.size());
+    nodeMap_[&node] = astContext_.getArrayType(type, node.nodes_.size());
 }
 
 void TypeChecker::visit(const Paren &node)
@@ -1069,7 +1108,8 @@ void TypeChecker::visit(const Paren &node)
     if (node.expr_)
     {
         node.expr_->accept(*this);
-        nodeMap_[&node] = nodeMap_[node.expr_.get()]->clone();
+        nodeMap_[&node] = nodeMap_[node.expr_];
+        foldConstant(node, getConstant(node.expr_));
     }
     else
     {
@@ -1077,9 +1117,9 @@ void TypeChecker::visit(const Paren &node)
 
         // Abstract declarators could skip this step (if PtrNode)
         // Normal declarators pass this information up
-        if (nodeMap_[node.decl_.get()])
+        if (nodeMap_[node.decl_])
         {
-            nodeMap_[&node] = nodeMap_[node.decl_.get()]->clone();
+            nodeMap_[&node] = nodeMap_[node.decl_];
         }
     }
 }
@@ -1097,25 +1137,34 @@ void TypeChecker::visit(const SizeOf &node)
 
     // C99 6.5.3.4 The sizeof operator has type size_t
     // Implementation defined but LLVM uses uint64_t
-    nodeMap_[&node] = std::make_unique<BasicType>(Types::UNSIGNED_LONG);
+    nodeMap_[&node] = astContext_.getBasicType(Types::UNSIGNED_LONG);
+
+    // Not a constant for VLAs
+    auto *type = node.expr_ ? nodeMap_[node.expr_] : nodeMap_[node.type_];
+    if (auto layout = getSizeAndAlign(type))
+    {
+        foldConstant(node, layout->first);
+    }
 }
 
 void TypeChecker::visit(const StringLiteral &node)
 {
     // + 1 for null terminator
-    nodeMap_[&node] = std::make_unique<ArrayType>(
-        std::make_unique<BasicType>(Types::CHAR), node.value_.size() + 1);
+    nodeMap_[&node] = astContext_.getArrayType(
+        astContext_.getBasicType(Types::CHAR), node.value_.size() + 1);
+    // Kept for initializers, which copy the characters
+    foldConstant(node, node.eval());
 }
 
 void TypeChecker::visit(const StructAccess &node)
 {
     // Check the type of the struct
     node.expr_->accept(*this);
-    auto *structType = nodeMap_[node.expr_.get()].get();
-    if (auto *s = dynamic_cast<const StructType *>(structType))
+    auto *structType = nodeMap_[node.expr_];
+    if (auto *s = dynCast<StructType>(structType))
     {
-        Ptr<ParamType> &params = structMap_.at(s->getID());
-        nodeMap_[&node] = params->getMemberType(node.member_)->clone();
+        const ParamType *params = structMap_.at(s->getID());
+        nodeMap_[&node] = params->getMemberType(node.member_);
     }
     else
     {
@@ -1127,16 +1176,16 @@ void TypeChecker::visit(const StructPtrAccess &node)
 {
     // Check the type of the struct
     node.expr_->accept(*this);
-    auto *exprType = nodeMap_[node.expr_.get()].get();
+    auto *exprType = nodeMap_[node.expr_];
 
     // Should be able to coerce ArrayType into PtrType
-    if (auto *t = dynamic_cast<const PtrType *>(exprType))
+    if (auto *t = dynCast<PtrType>(exprType))
     {
-        auto *s = dynamic_cast<const StructType *>(t->type_.get());
+        auto *s = dynCast<StructType>(t->type_);
         if (s)
         {
-            Ptr<ParamType> &params = structMap_.at(s->getID());
-            nodeMap_[&node] = params->getMemberType(node.member_)->clone();
+            const ParamType *params = structMap_.at(s->getID());
+            nodeMap_[&node] = params->getMemberType(node.member_);
         }
         else
         {
@@ -1156,12 +1205,12 @@ void TypeChecker::visit(const TernaryOp &node)
     node.lhs_->accept(*this);
     node.rhs_->accept(*this);
 
-    auto *thenExpr = nodeMap_[node.lhs_.get()].get();
-    auto *elseExpr = nodeMap_[node.rhs_.get()].get();
+    auto *thenExpr = nodeMap_[node.lhs_];
+    auto *elseExpr = nodeMap_[node.rhs_];
 
     // Check the type of the expressions
-    auto *thenExprBasic = dynamic_cast<const BasicType *>(thenExpr);
-    auto *elseExprBasic = dynamic_cast<const BasicType *>(elseExpr);
+    auto *thenExprBasic = dynCast<BasicType>(thenExpr);
+    auto *elseExprBasic = dynCast<BasicType>(elseExpr);
 
     if (thenExprBasic && elseExprBasic)
     {
@@ -1169,19 +1218,30 @@ void TypeChecker::visit(const TernaryOp &node)
         if (thenExprBasic->type_ == Types::VOID &&
             elseExprBasic->type_ == Types::VOID)
         {
-            nodeMap_[&node] = std::make_unique<BasicType>(Types::VOID);
+            nodeMap_[&node] = astContext_.getBasicType(Types::VOID);
         }
         else
         {
             nodeMap_[&node] =
-                std::make_unique<BasicType>(runUsualArithmeticConversions(
+                astContext_.getBasicType(runUsualArithmeticConversions(
                     thenExprBasic->type_, elseExprBasic->type_));
         }
     }
     else
     {
         // TODO Not 100% correct. See 6.5.15
-        nodeMap_[&node] = nodeMap_[node.lhs_.get()]->clone();
+        nodeMap_[&node] = nodeMap_[node.lhs_];
+    }
+
+    // Both operands must be constants too, even though one is not evaluated
+    EvalType cond = getConstant(node.cond_);
+    EvalType lhs = getConstant(node.lhs_);
+    EvalType rhs = getConstant(node.rhs_);
+    if (cond && !cond.is<std::string>() && lhs && rhs)
+    {
+        bool isTrue = cond.is<double>() ? *cond.getDouble() != 0
+                                        : *cond.getUInt() != 0;
+        foldConstant(node, isTrue ? lhs : rhs);
     }
 }
 
@@ -1189,16 +1249,16 @@ void TypeChecker::visit(const UnaryOp &node)
 {
     node.expr_->accept(*this);
 
-    auto *actual = nodeMap_[node.expr_.get()].get();
+    auto *actual = nodeMap_[node.expr_];
     switch (node.op_)
     {
     case UnaryOp::Op::ADDR:
-        nodeMap_[&node] = std::make_unique<PtrType>(actual->clone());
+        nodeMap_[&node] = astContext_.getPtrType(actual);
         break;
     case UnaryOp::Op::DEREF:
-        if (auto *ptr = dynamic_cast<const PtrType *>(actual))
+        if (auto *ptr = dynCast<PtrType>(actual))
         {
-            nodeMap_[&node] = ptr->type_->clone();
+            nodeMap_[&node] = ptr->type_;
         }
         else
         {
@@ -1206,7 +1266,7 @@ void TypeChecker::visit(const UnaryOp &node)
         }
         break;
     case UnaryOp::Op::LNOT:
-        nodeMap_[&node] = std::make_unique<BasicType>(Types::BOOL);
+        nodeMap_[&node] = astContext_.getBasicType(Types::BOOL);
         break;
     case UnaryOp::Op::NOT:
         assertIsIntegerTy(actual);
@@ -1215,14 +1275,14 @@ void TypeChecker::visit(const UnaryOp &node)
     case UnaryOp::Op::POST_INC:
     case UnaryOp::Op::PRE_DEC:
     case UnaryOp::Op::PRE_INC:
-        if (auto *basicType = dynamic_cast<const BasicType *>(actual))
+        if (auto *basicType = dynCast<BasicType>(actual))
         {
-            nodeMap_[&node] = std::make_unique<BasicType>(
+            nodeMap_[&node] = astContext_.getBasicType(
                 runIntegerPromotions(basicType->type_));
         }
-        else if (auto *ptrType = dynamic_cast<const PtrType *>(actual))
+        else if (auto *ptrType = dynCast<PtrType>(actual))
         {
-            nodeMap_[&node] = actual->clone();
+            nodeMap_[&node] = actual;
         }
         else
         {
@@ -1232,9 +1292,9 @@ void TypeChecker::visit(const UnaryOp &node)
 
     case UnaryOp::Op::PLUS:
     case UnaryOp::Op::MINUS:
-        if (auto *basicType = dynamic_cast<const BasicType *>(actual))
+        if (auto *basicType = dynCast<BasicType>(actual))
         {
-            nodeMap_[&node] = std::make_unique<BasicType>(
+            nodeMap_[&node] = astContext_.getBasicType(
                 runIntegerPromotions(basicType->type_));
         }
         else
@@ -1243,6 +1303,22 @@ void TypeChecker::visit(const UnaryOp &node)
         }
         break;
     }
+
+    // Increments and decrements have side effects, so are never constants
+    using Op = UnaryOp::Op;
+    if (node.op_ == Op::PLUS || node.op_ == Op::MINUS ||
+        node.op_ == Op::NOT || node.op_ == Op::LNOT)
+    {
+        // The operand is promoted first, except for !
+        auto *operandType =
+            (node.op_ == Op::LNOT) ? actual : nodeMap_[&node];
+        EvalType value =
+            convertConstant(getConstant(node.expr_), operandType, *abi_);
+        if (value && !value.is<std::string>())
+        {
+            foldConstant(node, node.fold(value));
+        }
+    }
 }
 
 /******************************************************************************
@@ -1269,14 +1345,23 @@ void TypeChecker::visit(const Case &node)
         node.expr_->accept(*this);
 
         // Case expression must be an integer
-        auto *actual = nodeMap_[node.expr_.get()].get();
-        if (!(*actual == BasicType(Types::INT)))
+        auto *actual = nodeMap_[node.expr_];
+        if (*actual != *astContext_.getBasicType(Types::INT))
         {
             throw std::runtime_error("Error: Expected integer type (Case)");
             return;
         }
     }
 
+    if (node.rangeEnd_)
+    {
+        node.rangeEnd_->accept(*this);
+        if (*nodeMap_[node.rangeEnd_] != *astContext_.getBasicType(Types::INT))
+        {
+            throw std::runtime_error("Error: Expected integer type (Case)");
+        }
+    }
+
     node.body_->accept(*this);
 }
 
@@ -1306,7 +1391,7 @@ void TypeChecker::visit(const ExprStmt &node)
     if (node.expr_)
     {
         node.expr_->accept(*this);
-        nodeMap_[&node] = nodeMap_[node.expr_.get()]->clone();
+        nodeMap_[&node] = nodeMap_[node.expr_];
     }
 }
 
@@ -1326,7 +1411,7 @@ void TypeChecker::visit(const IfElse &node)
     node.cond_->accept(*this);
 
     // Condition can be any type, but will be converted to a boolean
-    auto *actual = nodeMap_[node.cond_.get()].get();
+    auto *actual = nodeMap_[node.cond_];
 
     node.thenStmt_->accept(*this);
     if (node.elseStmt_)
@@ -1338,8 +1423,8 @@ void TypeChecker::visit(const IfElse &node)
 void TypeChecker::visit(const Return &node)
 {
     // Cast expected to FnType
-    auto *t = nodeMap_[currentFunction_].get();
-    auto *fnType = dynamic_cast<const FnType *>(t);
+    auto *t = nodeMap_[currentFunction_];
+    auto *fnType = dynCast<FnType>(t);
     if (!fnType)
     {
         throw std::runtime_error("Error: Expected function type");
@@ -1351,17 +1436,16 @@ void TypeChecker::visit(const Return &node)
         node.expr_->accept(*this);
 
         // Return type must match FnDef return type
-        auto *actual = nodeMap_[node.expr_.get()].get();
-        checkType(actual, fnType->retType_.get());
+        auto *actual = nodeMap_[node.expr_];
+        checkType(actual, fnType->retType_);
     }
     else
     {
-        auto voidType = std::make_unique<BasicType>(Types::VOID);
-        checkType(voidType.get(), fnType->retType_.get());
+        checkType(astContext_.getBasicType(Types::VOID), fnType->retType_);
     }
 
     // Will be casted to the return type of the function
-    nodeMap_[&node] = fnType->retType_->clone();
+    nodeMap_[&node] = fnType->retType_;
 }
 
 void TypeChecker::visit(const Switch &node)
@@ -1369,8 +1453,8 @@ void TypeChecker::visit(const Switch &node)
     node.expr_->accept(*this);
 
     // Expression must be an integer
-    auto *actual = nodeMap_[node.expr_.get()].get();
-    if (!(*actual == BasicType(Types::INT)))
+    auto *actual = nodeMap_[node.expr_];
+    if (*actual != *astContext_.getBasicType(Types::INT))
     {
         throw std::runtime_error("Error: Expected integer type (Switch)");
         return;
@@ -1384,7 +1468,7 @@ void TypeChecker::visit(const While &node)
     node.cond_->accept(*this);
 
     // Condition can be any type, but will be converted to a boolean
-    auto *actual = nodeMap_[node.cond_.get()].get();
+    auto *actual = nodeMap_[node.cond_];
 
     node.body_->accept(*this);
 }
@@ -1468,7 +1552,7 @@ bool checkType(const BaseType *actual, const BaseType *expected)
 
 bool assertIsIntegerTy(const BaseType *type)
 {
-    if (auto *basicType = dynamic_cast<const BasicType *>(type))
+    if (auto *basicType = dynCast<BasicType>(type))
     {
         std::vector<Types> allowed = {
             Types::BOOL,
@@ -1494,6 +1578,99 @@ bool assertIsIntegerTy(const BaseType *type)
     return false;
 }
 
+uint64_t alignTo(uint64_t size, uint64_t align)
+{
+    return (size + align - 1) / align * align;
+}
+
+// Enums are ints, C99 6.7.2.2
+std::optional<Types> getArithmeticType(const BaseType *type)
+{
+    if (auto *basicType = dynCast<BasicType>(type))
+    {
+        return basicType->type_;
+    }
+    else if (dynCast<EnumType>(type))
+    {
+        return Types::INT;
+    }
+
+    return std::nullopt;
+}
+
+// C99 6.3 Conversions, as if the value was stored in an object of the type
+EvalType
+convertConstant(const EvalType &value, const BaseType *type, const ABI &abi)
+{
+    if (value.is<std::string>())
+    {
+        // String literals only initialize arrays and pointers
+        return dynCast<PtrType>(type) ? value : EvalType();
+    }
+    if (!value)
+    {
+        return {};
+    }
+
+    auto arithmeticType = getArithmeticType(type);
+    if (!arithmeticType)
+    {
+        // Null pointer constants, and integers cast to pointers
+        if (dynCast<PtrType>(type) && !dynCast<ArrayType>(type) &&
+            !value.is<double>())
+        {
+            return *value.getUInt();
+        }
+        return {};
+    }
+
+    Types t = *arithmeticType;
+    switch (t)
+    {
+    case Types::FLOAT:
+        return static_cast<double>(static_cast<float>(*value.getDouble()));
+    case Types::DOUBLE:
+    case Types::LONG_DOUBLE:
+        return *value.getDouble();
+    case Types::BOOL:
+        return static_cast<uint64_t>(
+            value.is<double>() ? *value.getDouble() != 0
+                               : *value.getUInt() != 0);
+    default:
+        break;
+    }
+
+    uint64_t bits = abi.getTypeSize(t);
+    if (bits == 0)
+    {
+        return {};
+    }
+
+    // Floating values are truncated toward zero
+    uint64_t raw = *value.getUInt();
+    if (value.is<double>() && *value.getDouble() < 0)
+    {
+        raw = *value.getInt();
+    }
+
+    // Keep the low bits, then sign extend them
+    if (bits < 64)
+    {
+        uint64_t mask = (uint64_t(1) << bits) - 1;
+        raw &= mask;
+        if (BasicType::isSigned(t) && (raw >> (bits - 1)))
+        {
+            raw |= ~mask;
+        }
+    }
+
+    if (BasicType::isSigned(t))
+    {
+        return static_cast<int64_t>(raw);
+    }
+    return raw;
+}
+
 } // namespace
 
 /******************************************************************************
@@ -1502,33 +1679,105 @@ bool assertIsIntegerTy(const BaseType *type)
 
 void TypeChecker::pushScope()
 {
-    typeContext_.push_back({});
+    typeContext_.pushScope();
+    constantContext_.pushScope();
 }
 
 void TypeChecker::popScope()
 {
-    typeContext_.pop_back();
+    typeContext_.popScope();
+    constantContext_.popScope();
+}
+
+const BaseType *TypeChecker::lookupType(Symbol name) const
+{
+    auto *type = typeContext_.lookup(name);
+    return type ? *type : nullptr;
+}
+
+void TypeChecker::insertType(Symbol name, const BaseType *type)
+{
+    typeContext_.insert(name, type);
+
+    // Hides any enum constant of the same name
+    constantContext_.insert(name, EvalType());
+}
+
+void TypeChecker::foldConstant(const Expr &node, const EvalType &value)
+{
+    if (EvalType folded = convertConstant(value, nodeMap_[&node], *abi_))
+    {
+        constantMap_[&node] = std::move(folded);
+    }
+}
+
+EvalType TypeChecker::getConstant(const Expr *node) const
+{
+    auto it = constantMap_.find(node);
+    return (it != constantMap_.end()) ? it->second : EvalType();
 }
 
-Ptr<BaseType> TypeChecker::lookupType(const std::string &name, size_t id) const
+std::optional<std::pair<uint64_t, uint64_t>>
+TypeChecker::getSizeAndAlign(const BaseType *type) const
 {
-    for (auto it = typeContext_.rbegin(); it != typeContext_.rend(); ++it)
+    if (auto *arrayType = dynCast<ArrayType>(type))
     {
-        if (it->find(name) != it->end())
+        // A size of 0 is a VLA, or an array of unknown size
+        auto element = getSizeAndAlign(arrayType->type_);
+        if (!element || arrayType->size_ == 0)
+        {
+            return std::nullopt;
+        }
+        return std::make_pair(
+            element->first * arrayType->size_, element->second);
+    }
+    else if (dynCast<PtrType>(type))
+    {
+        const llvm::DataLayout &layout = layoutModule_->getDataLayout();
+        return std::make_pair(
+            uint64_t(layout.getPointerSize()),
+            uint64_t(layout.getPointerABIAlignment(0).value()));
+    }
+    else if (auto *structType = dynCast<StructType>(type))
+    {
+        // Unions are not laid out yet
+        auto it = structMap_.find(structType->getID());
+        if (structType->type_ == StructType::Type::UNION ||
+            it == structMap_.end())
+        {
+            return std::nullopt;
+        }
+
+        // C99 6.7.2.1: members in order, each at its alignment
+        uint64_t size = 0;
+        uint64_t align = 1;
+        for (const auto &[name, memberType] : it->second->types_)
         {
-            if (id == -1 || id == it->at(name)->getID())
+            auto member = getSizeAndAlign(memberType);
+            if (!member)
             {
-                return it->at(name)->clone();
+                return std::nullopt;
             }
+            size = alignTo(size, member->second) + member->first;
+            align = std::max(align, member->second);
         }
+        return std::make_pair(alignTo(size, align), align);
+    }
+    else if (auto arithmeticType = getArithmeticType(type))
+    {
+        llvm::Type *llvmType =
+            abi_->getLLVMType(*arithmeticType, *layoutContext_);
+        if (!llvmType->isSized())
+        {
+            return std::nullopt;
+        }
+        const llvm::DataLayout &layout = layoutModule_->getDataLayout();
+        return std::make_pair(
+            uint64_t(layout.getTypeAllocSize(llvmType)),
+            uint64_t(layout.getABITypeAlign(llvmType).value()));
     }
 
-    return nullptr;
-}
-
-void TypeChecker::insertType(const std::string &name, Ptr<BaseType> type)
-{
-    typeContext_.back()[name] = std::move(type);
+    return std::nullopt;
 }
 
 } // namespace CodeGen
\ No newline at end of file
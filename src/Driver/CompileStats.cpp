@@ -0,0 +1,138 @@
+#include "Driver/CompileStats.hpp"
+
+#include <iomanip>
+#include <stdexcept>
+
+namespace Driver
+{
+namespace
+{
+double toMilliseconds(CompileStats::Clock::duration duration)
+{
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+} // namespace
+
+void CompileStats::addTime(Phase phase, Clock::duration duration)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    times_[static_cast<size_t>(phase)] += duration;
+}
+
+void CompileStats::addCounter(const std::string &name, size_t value)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_[name] += value;
+}
+
+void CompileStats::addPassTimings(
+    const std::string &sourcePath,
+    std::string report)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    passTimings_.emplace_back(sourcePath, std::move(report));
+}
+
+void CompileStats::setTotalTime(Clock::duration duration)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    totalTime_ = duration;
+}
+
+void CompileStats::printTimeReport(std::ostream &os) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    Clock::duration sum{};
+    for (const auto &time : times_)
+    {
+        sum += time;
+    }
+
+    os << "===---------------------- Time report -----------------------===\n"
+       << "  " << std::left << std::setw(20) << "Phase" << std::right
+       << std::setw(12) << "Time (ms)" << std::setw(10) << "%" << "\n";
+
+    os << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < numPhases_; i++)
+    {
+        double percent = sum.count() ? 100.0 * times_[i] / sum : 0;
+        os << "  " << std::left << std::setw(20)
+           << getPhaseName(static_cast<Phase>(i)) << std::right
+           << std::setw(12) << toMilliseconds(times_[i]) << std::setw(10)
+           << std::setprecision(1) << percent << std::setprecision(3) << "\n";
+    }
+
+    os << "  " << std::left << std::setw(20) << "Total (wall)" << std::right
+       << std::setw(12) << toMilliseconds(totalTime_) << "\n";
+    os << std::defaultfloat << std::setprecision(6);
+
+    for (const auto &[sourcePath, report] : passTimings_)
+    {
+        os << "\nOptimization passes for " << sourcePath << ":\n" << report;
+    }
+}
+
+void CompileStats::printStats(std::ostream &os) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    os << "===----------------------- Statistics -----------------------===\n";
+    for (const auto &[name, value] : counters_)
+    {
+        os << "  " << std::left << std::setw(30) << name << std::right
+           << std::setw(12) << value << "\n";
+    }
+}
+
+void CompileStats::printJSON(std::ostream &os) const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Names are fixed identifiers, so they never need escaping
+    os << "{\n  \"times_ms\": {\n";
+    for (size_t i = 0; i < numPhases_; i++)
+    {
+        os << "    \"" << getPhaseName(static_cast<Phase>(i))
+           << "\": " << toMilliseconds(times_[i]) << ",\n";
+    }
+    os << "    \"total\": " << toMilliseconds(totalTime_) << "\n  },\n";
+
+    os << "  \"counters\": {";
+    const char *separator = "\n";
+    for (const auto &[name, value] : counters_)
+    {
+        os << separator << "    \"" << name << "\": " << value;
+        separator = ",\n";
+    }
+    os << "\n  }\n}\n";
+}
+
+const char *CompileStats::getPhaseName(Phase phase)
+{
+    switch (phase)
+    {
+    case Phase::Startup:
+        return "startup";
+    case Phase::Preprocess:
+        return "preprocess";
+    case Phase::Parse:
+        return "parse";
+    case Phase::TypeCheck:
+        return "typecheck";
+    case Phase::IRGen:
+        return "irgen";
+    case Phase::Optimize:
+        return "optimize";
+    case Phase::Emit:
+        return "emit";
+    case Phase::Link:
+        return "link";
+    case Phase::NumPhases:
+        break;
+    }
+
+    throw std::runtime_error("Unknown phase");
+}
+
+} // namespace Driver
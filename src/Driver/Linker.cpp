@@ -0,0 +1,255 @@
+#include "Driver/Linker.hpp"
+
+#include <lld/Common/Driver.h>
+#include <llvm/Support/raw_ostream.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+LLD_HAS_DRIVER(elf)
+
+namespace Driver
+{
+namespace
+{
+namespace fs = std::filesystem;
+
+// Debian style multiarch directory name, e.g. x86_64-linux-gnu
+std::string getMultiarch(const llvm::Triple &triple)
+{
+    return triple.getArchName().str() + "-linux-gnu";
+}
+
+// Compares the leading numbers of two version strings, e.g. 9 < 12
+bool isOlderVersion(const std::string &lhs, const std::string &rhs)
+{
+    return std::atoi(lhs.c_str()) < std::atoi(rhs.c_str());
+}
+
+std::vector<std::string> getDefaultLibraryPaths(const llvm::Triple &triple)
+{
+    std::string multiarch = getMultiarch(triple);
+    std::vector<std::string> paths = {
+        "/usr/lib/" + multiarch,
+        "/lib/" + multiarch,
+    };
+
+    // crtbegin/crtend and libgcc live in the newest GCC's directory
+    std::error_code ec;
+    std::string newest;
+    for (const auto &entry :
+         fs::directory_iterator("/usr/lib/gcc/" + multiarch, ec))
+    {
+        std::string version = entry.path().filename().string();
+        if (newest.empty() || isOlderVersion(newest, version))
+        {
+            newest = version;
+        }
+    }
+    if (!newest.empty())
+    {
+        paths.push_back("/usr/lib/gcc/" + multiarch + "/" + newest);
+    }
+
+    paths.push_back("/usr/lib");
+    paths.push_back("/lib");
+    return paths;
+}
+
+std::string
+findFile(const std::string &name, const std::vector<std::string> &paths)
+{
+    for (const auto &path : paths)
+    {
+        fs::path candidate = fs::path(path) / name;
+        if (fs::exists(candidate))
+        {
+            return candidate.string();
+        }
+    }
+
+    throw std::runtime_error(
+        "cannot find " + name + ", set the search path with --libc-path");
+}
+
+/**
+ * An object buffer exposed to lld as a file. memfd files only exist in
+ * memory, and lld opens them by path like any other input.
+ */
+class MemoryFile
+{
+public:
+    MemoryFile(const char *name, const ObjectBuffer &contents)
+    {
+        fd_ = memfd_create(name, 0);
+        if (fd_ < 0)
+        {
+            throw std::runtime_error("could not create in-memory object");
+        }
+
+        size_t written = 0;
+        while (written < contents.size())
+        {
+            ssize_t n = write(
+                fd_, contents.data() + written, contents.size() - written);
+            if (n < 0)
+            {
+                close(fd_);
+                throw std::runtime_error("could not write in-memory object");
+            }
+            written += n;
+        }
+    }
+    ~MemoryFile()
+    {
+        close(fd_);
+    }
+
+    MemoryFile(const MemoryFile &) = delete;
+    MemoryFile &operator=(const MemoryFile &) = delete;
+
+    std::string getPath() const
+    {
+        return "/proc/self/fd/" + std::to_string(fd_);
+    }
+
+private:
+    int fd_;
+};
+} // namespace
+
+bool canLinkInProcess(const llvm::Triple &triple)
+{
+    return triple.isOSLinux() && triple.isOSBinFormatELF() &&
+           (triple.getArch() == llvm::Triple::x86_64 ||
+            triple.getArch() == llvm::Triple::aarch64);
+}
+
+void linkInProcess(
+    const std::vector<ObjectBuffer> &objects,
+    const std::string &outputPath,
+    const llvm::Triple &triple,
+    const LinkOptions &options)
+{
+    if (!canLinkInProcess(triple))
+    {
+        throw std::runtime_error(
+            "cannot link for " + triple.str() + " in process");
+    }
+
+    std::vector<std::string> paths = options.libraryPaths.empty()
+                                         ? getDefaultLibraryPaths(triple)
+                                         : options.libraryPaths;
+
+    bool isX86 = triple.getArch() == llvm::Triple::x86_64;
+    const char *emulation = isX86 ? "elf_x86_64" : "aarch64linux";
+    const char *dynamicLinker = isX86 ? "/lib64/ld-linux-x86-64.so.2"
+                                      : "/lib/ld-linux-aarch64.so.1";
+
+    // Objects are position independent, so link a PIE like clang does
+    std::vector<std::string> args = {
+        "ld.lld",
+        "-pie",
+        "--eh-frame-hdr",
+        "-m",
+        emulation,
+        "-dynamic-linker",
+        dynamicLinker,
+        "-o",
+        outputPath,
+        findFile("Scrt1.o", paths),
+        findFile("crti.o", paths),
+        findFile("crtbeginS.o", paths),
+    };
+    for (const auto &path : paths)
+    {
+        args.push_back("-L" + path);
+    }
+
+    std::vector<std::unique_ptr<MemoryFile>> files;
+    for (const auto &object : objects)
+    {
+        files.push_back(std::make_unique<MemoryFile>("rcc-object", object));
+        args.push_back(files.back()->getPath());
+    }
+
+    for (const char *arg :
+         {"-lgcc",
+          "--as-needed",
+          "-lgcc_s",
+          "--no-as-needed",
+          "-lc",
+          "-lgcc",
+          "--as-needed",
+          "-lgcc_s",
+          "--no-as-needed"})
+    {
+        args.push_back(arg);
+    }
+    args.push_back(findFile("crtendS.o", paths));
+    args.push_back(findFile("crtn.o", paths));
+
+    std::vector<const char *> argv;
+    for (const auto &arg : args)
+    {
+        argv.push_back(arg.c_str());
+    }
+
+    lld::Result result = lld::lldMain(
+        argv, llvm::outs(), llvm::errs(), {{lld::Gnu, &lld::elf::link}});
+    if (result.retCode != 0)
+    {
+        throw std::runtime_error("linking failed");
+    }
+}
+
+void linkWithDriver(
+    const std::vector<std::string> &objectPaths,
+    const std::string &outputPath)
+{
+    FILE *pipe = popen("which clang", "r");
+    if (!pipe)
+    {
+        throw std::runtime_error("failed to run which clang");
+    }
+
+    char buffer[256];
+    std::string clangPath;
+    if (fgets(buffer, sizeof(buffer), pipe))
+    {
+        clangPath = buffer;
+        clangPath.erase(
+            std::remove(clangPath.begin(), clangPath.end(), '\n'),
+            clangPath.end());
+    }
+    pclose(pipe);
+
+    if (clangPath.empty())
+    {
+        throw std::runtime_error("clang not found in PATH");
+    }
+
+    std::cout << "Invoking: " << clangPath << std::endl;
+
+    // Calling std::system is not best practice, however, it works here
+    std::string cmd = clangPath;
+    for (const auto &objectPath : objectPaths)
+    {
+        cmd += " " + objectPath;
+    }
+    cmd += " -o " + outputPath;
+    if (std::system(cmd.c_str()) != 0)
+    {
+        throw std::runtime_error("clang invocation failed");
+    }
+}
+
+} // namespace Driver
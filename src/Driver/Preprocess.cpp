@@ -0,0 +1,285 @@
+#include "Driver/Preprocess.hpp"
+
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#define TCPP_IMPLEMENTATION
+#include "Preprocessor.hpp"
+
+namespace Driver
+{
+namespace
+{
+std::string trim(const std::string &str)
+{
+    size_t begin = str.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos)
+    {
+        return "";
+    }
+    size_t end = str.find_last_not_of(" \t\r\n");
+    return str.substr(begin, end - begin + 1);
+}
+
+// Splits "#  ifndef  FOO_H" into {"ifndef", "FOO_H"}
+std::pair<std::string, std::string> parseDirective(const std::string &line)
+{
+    if (line.empty() || line.front() != '#')
+    {
+        return {};
+    }
+
+    std::istringstream iss(line.substr(1));
+    std::string directive;
+    std::string argument;
+    iss >> directive >> argument;
+    return {directive, argument};
+}
+
+std::string readFile(const std::string &path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs)
+    {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+
+    return std::string(
+        (std::istreambuf_iterator<char>(ifs)),
+        (std::istreambuf_iterator<char>()));
+}
+
+/**
+ * Stream over a cached header. The header's directory is pushed while tcpp
+ * reads from it, so nested quoted includes resolve relative to the header.
+ */
+class HeaderInputStream : public tcpp::StringInputStream
+{
+public:
+    HeaderInputStream(
+        const std::string &contents,
+        std::vector<boost::filesystem::path> &includeDirs,
+        const boost::filesystem::path &dir)
+        : tcpp::StringInputStream(contents), includeDirs_(includeDirs)
+    {
+        includeDirs_.push_back(dir);
+    }
+
+    ~HeaderInputStream() override
+    {
+        includeDirs_.pop_back();
+    }
+
+private:
+    std::vector<boost::filesystem::path> &includeDirs_;
+};
+} // namespace
+
+std::shared_ptr<const IncludeCache::Header>
+IncludeCache::get(const std::string &canonicalPath)
+{
+    std::time_t mtime = boost::filesystem::last_write_time(canonicalPath);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = headers_.find(canonicalPath);
+        if (it != headers_.end() && it->second->mtime == mtime)
+        {
+            return it->second;
+        }
+    }
+
+    auto header = std::make_shared<Header>();
+    header->mtime = mtime;
+    header->contents = readFile(canonicalPath);
+    detectIncludeGuard(*header);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    headers_[canonicalPath] = header;
+    return header;
+}
+
+void IncludeCache::detectIncludeGuard(Header &header)
+{
+    // Significant lines are those that are not blank or comments
+    struct Line
+    {
+        size_t offset;
+        std::string text;
+    };
+    std::vector<Line> lines;
+
+    std::istringstream iss(header.contents);
+    std::string line;
+    size_t offset = 0;
+    bool inComment = false;
+    while (std::getline(iss, line))
+    {
+        size_t lineOffset = offset;
+        offset += line.size() + 1;
+
+        std::string text = trim(line);
+        if (inComment)
+        {
+            inComment = text.find("*/") == std::string::npos;
+            continue;
+        }
+        if (text.rfind("/*", 0) == 0)
+        {
+            inComment = text.find("*/") == std::string::npos;
+            continue;
+        }
+        if (text.empty() || text.rfind("//", 0) == 0)
+        {
+            continue;
+        }
+
+        lines.push_back({lineOffset, text});
+    }
+
+    if (lines.empty())
+    {
+        return;
+    }
+
+    // tcpp does not understand #pragma once, so blank it out
+    auto [directive, argument] = parseDirective(lines.front().text);
+    if (directive == "pragma" && argument == "once")
+    {
+        size_t end = header.contents.find('\n', lines.front().offset);
+        end = std::min(end, header.contents.size());
+        header.contents.replace(
+            lines.front().offset,
+            end - lines.front().offset,
+            end - lines.front().offset,
+            ' ');
+        header.isGuarded = true;
+        return;
+    }
+
+    // #ifndef X / #define X ... #endif, where the #endif is the last line
+    // and closes the #ifndef with no #else or #elif of its own
+    if (directive != "ifndef" || lines.size() < 3 ||
+        parseDirective(lines[1].text) !=
+            std::make_pair(std::string("define"), argument))
+    {
+        return;
+    }
+
+    int depth = 0;
+    for (size_t i = 0; i < lines.size(); i++)
+    {
+        std::string current = parseDirective(lines[i].text).first;
+        if (current == "if" || current == "ifdef" || current == "ifndef")
+        {
+            depth++;
+        }
+        else if ((current == "else" || current == "elif") && depth == 1)
+        {
+            return;
+        }
+        else if (current == "endif" && --depth == 0)
+        {
+            if (i == lines.size() - 1)
+            {
+                header.isGuarded = true;
+                header.guardMacro = argument;
+            }
+            return;
+        }
+    }
+}
+
+std::string preprocessFile(
+    const std::string &sourcePath,
+    IncludeCache &cache,
+    CompileStats &stats)
+{
+    return preprocess(
+        readFile(sourcePath),
+        boost::filesystem::path(sourcePath).parent_path().string(),
+        cache,
+        stats);
+}
+
+std::string preprocess(
+    const std::string &source,
+    const std::string &directory,
+    IncludeCache &cache,
+    CompileStats &stats)
+{
+    // Must outlive the lexer, which owns the header streams
+    std::vector<boost::filesystem::path> includeDirs = {directory};
+    std::unordered_set<std::string> includedHeaders;
+    std::vector<std::string> missingHeaders;
+    std::vector<std::string> unreadableHeaders;
+    tcpp::Preprocessor *pPreprocessor = nullptr;
+
+    auto errorCallback = [](const tcpp::TErrorInfo &msg) {};
+    tcpp::Preprocessor::TOnIncludeCallback includeCallback =
+        [&](const std::string &path,
+            bool isSystem) -> tcpp::TInputStreamUniquePtr
+    {
+        // Search the including file's directory for the include file. tcpp
+        // cannot propagate exceptions, so a missing or unreadable header is
+        // reported once preprocessing is done
+        boost::system::error_code error;
+        boost::filesystem::path includePath = boost::filesystem::canonical(
+            includeDirs.back() / path, error);
+        if (error)
+        {
+            missingHeaders.push_back(path);
+            return std::make_unique<tcpp::StringInputStream>("");
+        }
+        std::shared_ptr<const IncludeCache::Header> header;
+        try
+        {
+            header = cache.get(includePath.string());
+        }
+        catch (const std::exception &e)
+        {
+            unreadableHeaders.push_back(e.what());
+            return std::make_unique<tcpp::StringInputStream>("");
+        }
+
+        // Included before and guarded: would expand to nothing
+        bool seen = !includedHeaders.insert(includePath.string()).second;
+        if (seen && header->isGuarded &&
+            (header->guardMacro.empty() ||
+             pPreprocessor->IsMacroDefined(header->guardMacro)))
+        {
+            return std::make_unique<tcpp::StringInputStream>("");
+        }
+
+        // The header shares the includer's macros, as in C
+        return std::make_unique<HeaderInputStream>(
+            header->contents, includeDirs, includePath.parent_path());
+    };
+    tcpp::Lexer lexer(std::make_unique<tcpp::StringInputStream>(source));
+    tcpp::Preprocessor preprocessor(lexer, {errorCallback, includeCallback});
+    pPreprocessor = &preprocessor;
+
+    std::string output = preprocessor.Process();
+    if (!missingHeaders.empty())
+    {
+        throw std::runtime_error(
+            "'" + missingHeaders.front() + "' file not found");
+    }
+    if (!unreadableHeaders.empty())
+    {
+        throw std::runtime_error(unreadableHeaders.front());
+    }
+
+    auto ppStats = preprocessor.GetStats();
+    stats.addCounter("preprocessor.macro_lookups", ppStats.mMacroLookups);
+    stats.addCounter("preprocessor.macro_hits", ppStats.mMacroHits);
+    return output;
+}
+
+} // namespace Driver
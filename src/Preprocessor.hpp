@@ -35,12 +35,13 @@
 
 #include <algorithm>
 #include <cctype>
+#include <deque>
 #include <functional>
-#include <list>
 #include <memory>
 #include <sstream>
 #include <stack>
 #include <string>
+#include <string_view>
 #include <tuple>
 #include <unordered_map>
 #include <unordered_set>
@@ -83,7 +84,8 @@ using TInputStreamUniquePtr = std::unique_ptr<IInputStream>;
     class StringInputStream
 
     \brief The class is the simplest implementation of the input stream, which
-    is a simple string
+    is a simple string. Lines are read by advancing an offset, the source is
+    never copied or erased, so reading is linear in the size of the input
 */
 
 class StringInputStream : public IInputStream
@@ -103,6 +105,7 @@ public:
 
 private:
     std::string mSourceStr;
+    std::string::size_type mCurrOffset = 0;
 };
 
 enum class E_TOKEN_TYPE : unsigned int
@@ -167,12 +170,48 @@ typedef struct TToken
 {
     E_TOKEN_TYPE mType;
 
-    std::string mRawView;
+    std::string_view mRawView; ///< Literal or interned by the Lexer, so
+                               ///< copying a token never allocates
 
     size_t mLineId;
     size_t mPos;
 } TToken, *TTokenPtr;
 
+/*!
+    class StringPool
+
+    \brief The class owns the text of tokens. Strings are copied into a
+    chunked buffer and handed out as views, which stay valid for the lifetime
+    of the pool. Interned strings are deduplicated, stored ones are not
+*/
+
+class StringPool
+{
+public:
+    StringPool() TCPP_NOEXCEPT = default;
+    StringPool(const StringPool &) TCPP_NOEXCEPT = delete;
+    ~StringPool() TCPP_NOEXCEPT = default;
+
+    std::string_view Intern(std::string_view str) TCPP_NOEXCEPT;
+    std::string_view Store(std::string_view str) TCPP_NOEXCEPT;
+
+    StringPool &operator=(const StringPool &) TCPP_NOEXCEPT = delete;
+
+private:
+    void _grow() TCPP_NOEXCEPT;
+
+private:
+    static constexpr size_t mChunkSize = 64 * 1024;
+
+    ///< Open addressing with linear probing, so that interning a new string
+    ///< does not allocate a node. Empty views mark free slots
+    std::vector<std::string_view> mSlots;
+    size_t mCount = 0;
+
+    std::vector<std::unique_ptr<char[]>> mChunks;
+    size_t mChunkOffset = mChunkSize;
+};
+
 /*!
     class Lexer
 
@@ -182,7 +221,7 @@ typedef struct TToken
 class Lexer
 {
 private:
-    using TTokensQueue = std::list<TToken>;
+    using TTokensQueue = std::deque<TToken>;
     using TStreamStack = std::stack<TInputStreamUniquePtr>;
     using TDirectivesMap = std::vector<std::tuple<std::string, E_TOKEN_TYPE>>;
     using TDirectiveHandlersArray = std::unordered_set<std::string>;
@@ -215,25 +254,38 @@ public:
     size_t GetCurrLineIndex() const TCPP_NOEXCEPT;
     size_t GetCurrPos() const TCPP_NOEXCEPT;
 
+    /*!
+        \brief Return views of the string which live as long as the lexer,
+        tokens that outlive the current line must use them. Intern is for
+        names which repeat (identifiers, macros), Store for everything else
+    */
+
+    std::string_view Intern(std::string_view str) TCPP_NOEXCEPT;
+    std::string_view Store(std::string_view str) TCPP_NOEXCEPT;
+
 private:
     TToken _getNextTokenInternal(bool ignoreQueue) TCPP_NOEXCEPT;
 
-    TToken _scanTokens(std::string &inputLine) TCPP_NOEXCEPT;
+    TToken _scanTokens(std::string_view &inputLine) TCPP_NOEXCEPT;
 
     std::string _requestSourceLine() TCPP_NOEXCEPT;
 
-    TToken _scanSeparatorTokens(char ch, std::string &inputLine) TCPP_NOEXCEPT;
+    TToken
+    _scanSeparatorTokens(char ch, std::string_view &inputLine) TCPP_NOEXCEPT;
 
     IInputStream *_getActiveStream() const TCPP_NOEXCEPT;
 
 private:
     static const TToken mEOFToken;
 
+    StringPool mStringPool;
+
     TDirectivesMap mDirectivesTable;
 
     TTokensQueue mTokensQueue;
 
-    std::string mCurrLine;
+    std::string mCurrLineBuffer;
+    std::string_view mCurrLine; ///< Unscanned part of mCurrLineBuffer
 
     size_t mCurrLineIndex = 1;
     size_t mCurrPos = 0;
@@ -302,8 +354,8 @@ public:
     using TOnErrorCallback = std::function<void(const TErrorInfo &)>;
     using TOnIncludeCallback =
         std::function<TInputStreamUniquePtr(const std::string &, bool)>;
-    using TSymTable = std::vector<TMacroDesc>;
-    using TContextStack = std::list<std::string>;
+    using TSymTable = std::unordered_map<std::string_view, TMacroDesc>;
+    using TContextStack = std::vector<std::string_view>;
     using TDirectiveHandler = std::function<
         std::string(Preprocessor &, Lexer &, const std::string &)>;
     using TDirectivesMap = std::unordered_map<std::string, TDirectiveHandler>;
@@ -335,6 +387,12 @@ public:
 
     using TIfStack = std::stack<TIfStackEntry>;
 
+    typedef struct TPreprocessorStats
+    {
+        size_t mMacroLookups = 0; ///< Queries of the macros table
+        size_t mMacroHits = 0;    ///< Queries which found a macro
+    } TPreprocessorStats, *TPreprocessorStatsPtr;
+
 public:
     Preprocessor() TCPP_NOEXCEPT = delete;
     Preprocessor(const Preprocessor &) TCPP_NOEXCEPT = delete;
@@ -352,9 +410,16 @@ public:
 
     TSymTable GetSymbolsTable() const TCPP_NOEXCEPT;
 
+    bool IsMacroDefined(const std::string &macroName) const TCPP_NOEXCEPT;
+
+    TPreprocessorStats GetStats() const TCPP_NOEXCEPT;
+
 private:
+    const TMacroDesc *
+    _findMacro(std::string_view macroName) const TCPP_NOEXCEPT;
+
     void _createMacroDefinition() TCPP_NOEXCEPT;
-    void _removeMacroDefinition(const std::string &macroName) TCPP_NOEXCEPT;
+    void _removeMacroDefinition(std::string_view macroName) TCPP_NOEXCEPT;
 
     std::vector<TToken> _expandMacroDefinition(
         const TMacroDesc &macroDesc,
@@ -385,12 +450,15 @@ private:
     TOnErrorCallback mOnErrorCallback;
     TOnIncludeCallback mOnIncludeCallback;
 
-    TSymTable mSymTable;
+    TSymTable mSymTable; ///< Keyed by names interned in the lexer, every
+                         ///< identifier is looked up
     mutable TContextStack mContextStack;
     TIfStack mConditionalBlocksStack;
     TDirectivesMap mCustomDirectivesHandlersMap;
 
     bool mSkipCommentsTokens;
+
+    mutable TPreprocessorStats mStats;
 };
 
 ///< implementation of the library is placed below
@@ -439,35 +507,38 @@ StringInputStream::StringInputStream(const std::string &source) TCPP_NOEXCEPT
 }
 
 StringInputStream::StringInputStream(const StringInputStream &inputStream)
-    TCPP_NOEXCEPT : mSourceStr(inputStream.mSourceStr)
+    TCPP_NOEXCEPT : mSourceStr(inputStream.mSourceStr),
+                    mCurrOffset(inputStream.mCurrOffset)
 {
 }
 
 StringInputStream::StringInputStream(StringInputStream &&inputStream)
-    TCPP_NOEXCEPT : mSourceStr(std::move(inputStream.mSourceStr))
+    TCPP_NOEXCEPT : mSourceStr(std::move(inputStream.mSourceStr)),
+                    mCurrOffset(inputStream.mCurrOffset)
 {
 }
 
 std::string StringInputStream::ReadLine() TCPP_NOEXCEPT
 {
-    std::string::size_type pos = mSourceStr.find_first_of('\n');
-    pos = (pos == std::string::npos) ? pos : (pos + 1);
+    std::string::size_type pos = mSourceStr.find_first_of('\n', mCurrOffset);
+    pos = (pos == std::string::npos) ? mSourceStr.length() : (pos + 1);
 
-    std::string currLine = mSourceStr.substr(0, pos);
-    mSourceStr.erase(0, pos);
+    std::string currLine = mSourceStr.substr(mCurrOffset, pos - mCurrOffset);
+    mCurrOffset = pos;
 
     return currLine;
 }
 
 bool StringInputStream::HasNextLine() const TCPP_NOEXCEPT
 {
-    return !mSourceStr.empty();
+    return mCurrOffset < mSourceStr.length();
 }
 
 StringInputStream &
 StringInputStream::operator=(const StringInputStream &stream) TCPP_NOEXCEPT
 {
     mSourceStr = stream.mSourceStr;
+    mCurrOffset = stream.mCurrOffset;
     return *this;
 }
 
@@ -475,9 +546,89 @@ StringInputStream &
 StringInputStream::operator=(StringInputStream &&stream) TCPP_NOEXCEPT
 {
     mSourceStr = std::move(stream.mSourceStr);
+    mCurrOffset = stream.mCurrOffset;
     return *this;
 }
 
+std::string_view StringPool::Intern(std::string_view str) TCPP_NOEXCEPT
+{
+    if (str.empty())
+    {
+        return {};
+    }
+
+    if (2 * (mCount + 1) > mSlots.size())
+    {
+        _grow();
+    }
+
+    const size_t mask = mSlots.size() - 1;
+    size_t index = std::hash<std::string_view>{}(str) & mask;
+    while (!mSlots[index].empty())
+    {
+        if (mSlots[index] == str)
+        {
+            return mSlots[index];
+        }
+
+        index = (index + 1) & mask;
+    }
+
+    ++mCount;
+    return mSlots[index] = Store(str);
+}
+
+std::string_view StringPool::Store(std::string_view str) TCPP_NOEXCEPT
+{
+    char *pStorage = nullptr;
+    if (str.length() > mChunkSize)
+    {
+        // \note oversized strings get a chunk of their own, placed before the
+        // current one so that it keeps being filled
+        auto iter = mChunks.empty() ? mChunks.end() : std::prev(mChunks.end());
+        pStorage = mChunks.emplace(iter, new char[str.length()])->get();
+    }
+    else
+    {
+        if (mChunkOffset + str.length() > mChunkSize)
+        {
+            mChunks.emplace_back(new char[mChunkSize]);
+            mChunkOffset = 0;
+        }
+
+        pStorage = mChunks.back().get() + mChunkOffset;
+        mChunkOffset += str.length();
+    }
+
+    std::copy(str.cbegin(), str.cend(), pStorage);
+    return std::string_view(pStorage, str.length());
+}
+
+void StringPool::_grow() TCPP_NOEXCEPT
+{
+    std::vector<std::string_view> slots(
+        mSlots.empty() ? 1024 : 2 * mSlots.size());
+    const size_t mask = slots.size() - 1;
+
+    for (auto &&str : mSlots)
+    {
+        if (str.empty())
+        {
+            continue;
+        }
+
+        size_t index = std::hash<std::string_view>{}(str) & mask;
+        while (!slots[index].empty())
+        {
+            index = (index + 1) & mask;
+        }
+
+        slots[index] = str;
+    }
+
+    mSlots = std::move(slots);
+}
+
 const TToken Lexer::mEOFToken = {E_TOKEN_TYPE::END};
 
 Lexer::Lexer(TInputStreamUniquePtr pIinputStream) TCPP_NOEXCEPT:
@@ -493,7 +644,7 @@ Lexer::Lexer(TInputStreamUniquePtr pIinputStream) TCPP_NOEXCEPT:
 			{ "endif", E_TOKEN_TYPE::ENDIF },
 			{ "include", E_TOKEN_TYPE::INCLUDE },
 			{ "defined", E_TOKEN_TYPE::DEFINED },
-		}, mCurrLine(), mCurrLineIndex(0)
+		}, mCurrLineBuffer(), mCurrLine(), mCurrLineIndex(0)
 {
     PushStream(std::move(pIinputStream));
 }
@@ -579,26 +730,33 @@ size_t Lexer::GetCurrPos() const TCPP_NOEXCEPT
     return mCurrPos;
 }
 
+std::string_view Lexer::Intern(std::string_view str) TCPP_NOEXCEPT
+{
+    return mStringPool.Intern(str);
+}
+
+std::string_view Lexer::Store(std::string_view str) TCPP_NOEXCEPT
+{
+    return mStringPool.Store(str);
+}
+
+/// \note Only moves the start of the view, the underlying line is untouched
 static std::tuple<size_t, char>
-EatNextChar(std::string &str, size_t pos, size_t count = 1)
+EatNextChar(std::string_view &str, size_t pos, size_t count = 1)
 {
-    str.erase(0, count);
+    str.remove_prefix(std::min(count, str.length()));
     return {pos + count, str.empty() ? static_cast<char>(EOF) : str.front()};
 }
 
-static char PeekNextChar(const std::string &str, size_t step = 1)
+static char PeekNextChar(std::string_view str, size_t step = 1)
 {
     return (step < str.length()) ? str[step] : static_cast<char>(EOF);
 }
 
 static std::string
-ExtractSingleLineComment(const std::string &currInput) TCPP_NOEXCEPT
+ExtractSingleLineComment(std::string_view currInput) TCPP_NOEXCEPT
 {
-    std::stringstream ss(currInput);
-    std::string commentStr;
-
-    std::getline(ss, commentStr, '\n');
-    return commentStr;
+    return std::string(currInput.substr(0, currInput.find('\n')));
 }
 
 static std::string ExtractMultiLineComments(
@@ -670,8 +828,11 @@ TToken Lexer::_getNextTokenInternal(bool ignoreQueue) TCPP_NOEXCEPT
 
     if (mCurrLine.empty())
     {
+        mCurrLineBuffer = _requestSourceLine();
+        mCurrLine = mCurrLineBuffer;
+
         // \note if it's still empty then we've reached the end of the source
-        if ((mCurrLine = _requestSourceLine()).empty())
+        if (mCurrLine.empty())
         {
             return mEOFToken;
         }
@@ -680,11 +841,11 @@ TToken Lexer::_getNextTokenInternal(bool ignoreQueue) TCPP_NOEXCEPT
     return _scanTokens(mCurrLine);
 }
 
-TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
+TToken Lexer::_scanTokens(std::string_view &inputLine) TCPP_NOEXCEPT
 {
     char ch = '\0';
 
-    static const std::unordered_set<std::string> keywordsMap{
+    static const std::unordered_set<std::string_view> keywordsMap{
         "auto",    "double",   "int",      "struct",   "break",    "else",
         "long",    "switch",   "case",     "enum",     "register", "typedef",
         "char",    "extern",   "return",   "union",    "const",    "float",
@@ -706,7 +867,11 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             // flush current blob
             if (!currStr.empty())
             {
-                return {E_TOKEN_TYPE::BLOB, currStr, mCurrLineIndex, mCurrPos};
+                return {
+                    E_TOKEN_TYPE::BLOB,
+                    Store(currStr),
+                    mCurrLineIndex,
+                    mCurrPos};
             }
 
             mCurrPos = std::get<size_t>(EatNextChar(inputLine, mCurrPos, 3));
@@ -718,7 +883,11 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             // flush current blob
             if (!currStr.empty())
             {
-                return {E_TOKEN_TYPE::BLOB, currStr, mCurrLineIndex, mCurrPos};
+                return {
+                    E_TOKEN_TYPE::BLOB,
+                    Store(currStr),
+                    mCurrLineIndex,
+                    mCurrPos};
             }
 
             std::string commentStr;
@@ -731,8 +900,13 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             else if (PeekNextChar(inputLine, 1) == '*') /// \note multi-line
                                                         /// commentary
             {
+                // \note the comment may pull in more lines, so the rest of
+                // the input is rebuilt and scanning continues from it
+                std::string restStr(inputLine);
                 commentStr = ExtractMultiLineComments(
-                    inputLine, std::bind(&Lexer::_requestSourceLine, this));
+                    restStr, std::bind(&Lexer::_requestSourceLine, this));
+                mCurrLineBuffer = std::move(restStr);
+                inputLine = mCurrLineBuffer;
             }
 
             if (!commentStr.empty())
@@ -741,7 +915,7 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
                     EatNextChar(inputLine, mCurrPos, commentStr.length()));
                 return {
                     E_TOKEN_TYPE::COMMENTARY,
-                    commentStr,
+                    Store(commentStr),
                     mCurrLineIndex,
                     mCurrPos};
             }
@@ -752,7 +926,7 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             // flush current blob
             if (!currStr.empty())
             {
-                return {E_TOKEN_TYPE::BLOB, currStr, mCurrLineIndex};
+                return {E_TOKEN_TYPE::BLOB, Store(currStr), mCurrLineIndex};
             }
 
             std::string separatorStr;
@@ -767,7 +941,10 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             mCurrPos = std::get<size_t>(
                 EatNextChar(inputLine, mCurrPos, separatorStr.length()));
             return {
-                E_TOKEN_TYPE::NEWLINE, separatorStr, mCurrLineIndex, mCurrPos};
+                E_TOKEN_TYPE::NEWLINE,
+                Store(separatorStr),
+                mCurrLineIndex,
+                mCurrPos};
         }
 
         if (std::isspace(ch))
@@ -775,7 +952,11 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             // flush current blob
             if (!currStr.empty())
             {
-                return {E_TOKEN_TYPE::BLOB, currStr, mCurrLineIndex, mCurrPos};
+                return {
+                    E_TOKEN_TYPE::BLOB,
+                    Store(currStr),
+                    mCurrLineIndex,
+                    mCurrPos};
             }
 
             std::string separatorStr;
@@ -784,7 +965,7 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             mCurrPos = std::get<size_t>(EatNextChar(inputLine, mCurrPos));
             return {
                 E_TOKEN_TYPE::SPACE,
-                std::move(separatorStr),
+                Store(separatorStr),
                 mCurrLineIndex,
                 mCurrPos};
         }
@@ -794,7 +975,11 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             // flush current blob
             if (!currStr.empty())
             {
-                return {E_TOKEN_TYPE::BLOB, currStr, mCurrLineIndex, mCurrPos};
+                return {
+                    E_TOKEN_TYPE::BLOB,
+                    Store(currStr),
+                    mCurrLineIndex,
+                    mCurrPos};
             }
 
             /// \note Skip whitespaces if there're exist
@@ -809,7 +994,7 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
 
                 if (inputLine.rfind(currDirectiveStr, 0) == 0)
                 {
-                    inputLine.erase(0, currDirectiveStr.length());
+                    inputLine.remove_prefix(currDirectiveStr.length());
                     mCurrPos += currDirectiveStr.length();
 
                     return {
@@ -825,7 +1010,7 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             {
                 if (inputLine.rfind(currDirectiveStr, 0) == 0)
                 {
-                    inputLine.erase(0, currDirectiveStr.length());
+                    inputLine.remove_prefix(currDirectiveStr.length());
                     mCurrPos += currDirectiveStr.length();
 
                     return {
@@ -843,7 +1028,7 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
                 switch (nextCh)
                 {
                 case '#': // \note concatenation operator
-                    inputLine.erase(0, 1);
+                    inputLine.remove_prefix(1);
                     ++mCurrPos;
                     return {
                         E_TOKEN_TYPE::CONCAT_OP, "", mCurrLineIndex, mCurrPos};
@@ -867,7 +1052,11 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             // flush current blob
             if (!currStr.empty())
             {
-                return {E_TOKEN_TYPE::BLOB, currStr, mCurrLineIndex, mCurrPos};
+                return {
+                    E_TOKEN_TYPE::BLOB,
+                    Store(currStr),
+                    mCurrLineIndex,
+                    mCurrPos};
             }
 
             std::string number;
@@ -879,10 +1068,10 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
 
                 number.push_back(ch);
 
-                char nextCh = inputLine.front();
+                char nextCh = PeekNextChar(inputLine, 0);
                 if (nextCh == 'x' || std::isdigit(nextCh))
                 {
-                    inputLine.erase(0, 1);
+                    inputLine.remove_prefix(1);
                     ++mCurrPos;
 
                     number.push_back(nextCh);
@@ -890,7 +1079,10 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
                 else
                 {
                     return {
-                        E_TOKEN_TYPE::NUMBER, number, mCurrLineIndex, mCurrPos};
+                        E_TOKEN_TYPE::NUMBER,
+                        Store(number),
+                        mCurrLineIndex,
+                        mCurrPos};
                 }
             }
 
@@ -903,10 +1095,11 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
                 ++charsToRemove;
             }
 
-            inputLine.erase(0, charsToRemove);
+            inputLine.remove_prefix(charsToRemove);
             mCurrPos += charsToRemove;
 
-            return {E_TOKEN_TYPE::NUMBER, number, mCurrLineIndex, mCurrPos};
+            return {
+                E_TOKEN_TYPE::NUMBER, Store(number), mCurrLineIndex, mCurrPos};
         }
 
         if (ch == '_' || std::isalpha(ch)) ///< \note parse identifier
@@ -914,17 +1107,20 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
             // flush current blob
             if (!currStr.empty())
             {
-                return {E_TOKEN_TYPE::BLOB, currStr, mCurrLineIndex};
+                return {E_TOKEN_TYPE::BLOB, Store(currStr), mCurrLineIndex};
             }
 
-            std::string identifier;
-
-            do
+            // \note measured in place, then interned without a temporary
+            size_t length = 1;
+            while (length < inputLine.length() &&
+                   (std::isalnum(ch = inputLine[length]) || (ch == '_')))
             {
-                identifier.push_back(ch);
-                mCurrPos = std::get<size_t>(EatNextChar(inputLine, mCurrPos));
-            } while (!inputLine.empty() &&
-                     (std::isalnum(ch = inputLine.front()) || (ch == '_')));
+                ++length;
+            }
+
+            std::string_view identifier = Intern(inputLine.substr(0, length));
+            mCurrPos =
+                std::get<size_t>(EatNextChar(inputLine, mCurrPos, length));
 
             return {
                 (keywordsMap.find(identifier) != keywordsMap.cend())
@@ -949,7 +1145,7 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
 
                 return {
                     E_TOKEN_TYPE::BLOB,
-                    currStr,
+                    Store(currStr),
                     mCurrLineIndex,
                     mCurrPos}; // flush current blob
             }
@@ -967,7 +1163,7 @@ TToken Lexer::_scanTokens(std::string &inputLine) TCPP_NOEXCEPT
     // flush current blob
     if (!currStr.empty())
     {
-        return {E_TOKEN_TYPE::BLOB, currStr, mCurrLineIndex, mCurrPos};
+        return {E_TOKEN_TYPE::BLOB, Store(currStr), mCurrLineIndex, mCurrPos};
     }
 
     PopStream();
@@ -1042,7 +1238,7 @@ std::string Lexer::_requestSourceLine() TCPP_NOEXCEPT
 }
 
 TToken
-Lexer::_scanSeparatorTokens(char ch, std::string &inputLine) TCPP_NOEXCEPT
+Lexer::_scanSeparatorTokens(char ch, std::string_view &inputLine) TCPP_NOEXCEPT
 {
     switch (ch)
     {
@@ -1065,11 +1261,11 @@ Lexer::_scanSeparatorTokens(char ch, std::string &inputLine) TCPP_NOEXCEPT
             switch (nextCh)
             {
             case '<':
-                inputLine.erase(0, 1);
+                inputLine.remove_prefix(1);
                 ++mCurrPos;
                 return {E_TOKEN_TYPE::LSHIFT, "<<", mCurrLineIndex, mCurrPos};
             case '=':
-                inputLine.erase(0, 1);
+                inputLine.remove_prefix(1);
                 ++mCurrPos;
                 return {E_TOKEN_TYPE::LE, "<=", mCurrLineIndex, mCurrPos};
             }
@@ -1083,11 +1279,11 @@ Lexer::_scanSeparatorTokens(char ch, std::string &inputLine) TCPP_NOEXCEPT
             switch (nextCh)
             {
             case '>':
-                inputLine.erase(0, 1);
+                inputLine.remove_prefix(1);
                 ++mCurrPos;
                 return {E_TOKEN_TYPE::RSHIFT, ">>", mCurrLineIndex, mCurrPos};
             case '=':
-                inputLine.erase(0, 1);
+                inputLine.remove_prefix(1);
                 ++mCurrPos;
                 return {E_TOKEN_TYPE::GE, ">=", mCurrLineIndex, mCurrPos};
             }
@@ -1107,7 +1303,7 @@ Lexer::_scanSeparatorTokens(char ch, std::string &inputLine) TCPP_NOEXCEPT
     case '&':
         if (!inputLine.empty() && inputLine.front() == '&')
         {
-            inputLine.erase(0, 1);
+            inputLine.remove_prefix(1);
             ++mCurrPos;
             return {E_TOKEN_TYPE::AND, "&&", mCurrLineIndex, mCurrPos};
         }
@@ -1116,7 +1312,7 @@ Lexer::_scanSeparatorTokens(char ch, std::string &inputLine) TCPP_NOEXCEPT
     case '|':
         if (!inputLine.empty() && inputLine.front() == '|')
         {
-            inputLine.erase(0, 1);
+            inputLine.remove_prefix(1);
             ++mCurrPos;
             return {E_TOKEN_TYPE::OR, "||", mCurrLineIndex, mCurrPos};
         }
@@ -1125,7 +1321,7 @@ Lexer::_scanSeparatorTokens(char ch, std::string &inputLine) TCPP_NOEXCEPT
     case '!':
         if (!inputLine.empty() && inputLine.front() == '=')
         {
-            inputLine.erase(0, 1);
+            inputLine.remove_prefix(1);
             ++mCurrPos;
             return {E_TOKEN_TYPE::NE, "!=", mCurrLineIndex, mCurrPos};
         }
@@ -1134,7 +1330,7 @@ Lexer::_scanSeparatorTokens(char ch, std::string &inputLine) TCPP_NOEXCEPT
     case '=':
         if (!inputLine.empty() && inputLine.front() == '=')
         {
-            inputLine.erase(0, 1);
+            inputLine.remove_prefix(1);
             ++mCurrPos;
             return {E_TOKEN_TYPE::EQ, "==", mCurrLineIndex, mCurrPos};
         }
@@ -1166,7 +1362,8 @@ Preprocessor::Preprocessor(Lexer &lexer, const TPreprocessorConfigInfo &config)
 {
     for (auto &&currSystemDefine : BuiltInDefines)
     {
-        mSymTable.push_back({currSystemDefine});
+        mSymTable.emplace(
+            mpLexer->Intern(currSystemDefine), TMacroDesc{currSystemDefine});
     }
 }
 
@@ -1201,7 +1398,7 @@ std::string Preprocessor::Process() TCPP_NOEXCEPT
 
     std::string processedStr;
 
-    auto appendString = [&processedStr, this](const std::string &str)
+    auto appendString = [&processedStr, this](std::string_view str)
     {
         if (_shouldTokenBeSkipped())
         {
@@ -1262,11 +1459,7 @@ std::string Preprocessor::Process() TCPP_NOEXCEPT
             break;
         case E_TOKEN_TYPE::IDENTIFIER: // \note try to expand some macro here
         {
-            auto iter = std::find_if(
-                mSymTable.cbegin(),
-                mSymTable.cend(),
-                [&currToken](auto &&item)
-                { return item.mName == currToken.mRawView; });
+            const TMacroDesc *pMacroDesc = _findMacro(currToken.mRawView);
 
             auto contextIter = std::find_if(
                 mContextStack.cbegin(),
@@ -1274,10 +1467,10 @@ std::string Preprocessor::Process() TCPP_NOEXCEPT
                 [&currToken](auto &&item)
                 { return item == currToken.mRawView; });
 
-            if (iter != mSymTable.cend() && contextIter == mContextStack.cend())
+            if (pMacroDesc && contextIter == mContextStack.cend())
             {
                 mpLexer->AppendFront(_expandMacroDefinition(
-                    *iter,
+                    *pMacroDesc,
                     currToken,
                     [this] { return mpLexer->GetNextToken(); }));
             }
@@ -1320,14 +1513,15 @@ std::string Preprocessor::Process() TCPP_NOEXCEPT
                 continue;
             }
 
-            appendString(
-                "\"" + (currToken = mpLexer->GetNextToken()).mRawView + "\"");
+            currToken = mpLexer->GetNextToken();
+            appendString("\"" + std::string(currToken.mRawView) + "\"");
         }
         break;
         case E_TOKEN_TYPE::CUSTOM_DIRECTIVE:
         {
             auto customDirectiveIter =
-                mCustomDirectivesHandlersMap.find(currToken.mRawView);
+                mCustomDirectivesHandlersMap.find(
+                    std::string(currToken.mRawView));
             if (customDirectiveIter != mCustomDirectivesHandlersMap.cend())
             {
                 appendString(
@@ -1366,6 +1560,32 @@ Preprocessor::TSymTable Preprocessor::GetSymbolsTable() const TCPP_NOEXCEPT
     return mSymTable;
 }
 
+bool Preprocessor::IsMacroDefined(const std::string &macroName) const
+    TCPP_NOEXCEPT
+{
+    return _findMacro(macroName) != nullptr;
+}
+
+Preprocessor::TPreprocessorStats Preprocessor::GetStats() const TCPP_NOEXCEPT
+{
+    return mStats;
+}
+
+const TMacroDesc *
+Preprocessor::_findMacro(std::string_view macroName) const TCPP_NOEXCEPT
+{
+    ++mStats.mMacroLookups;
+
+    auto iter = mSymTable.find(macroName);
+    if (iter == mSymTable.cend())
+    {
+        return nullptr;
+    }
+
+    ++mStats.mMacroHits;
+    return &iter->second;
+}
+
 void Preprocessor::_createMacroDefinition() TCPP_NOEXCEPT
 {
     TMacroDesc macroDesc;
@@ -1458,7 +1678,7 @@ void Preprocessor::_createMacroDefinition() TCPP_NOEXCEPT
             switch (currToken.mType)
             {
             case E_TOKEN_TYPE::IDENTIFIER:
-                macroDesc.mArgsNames.push_back(currToken.mRawView);
+                macroDesc.mArgsNames.emplace_back(currToken.mRawView);
                 break;
             case E_TOKEN_TYPE::ELLIPSIS:
                 macroDesc.mArgsNames.push_back("__VA_ARGS__");
@@ -1502,21 +1722,18 @@ void Preprocessor::_createMacroDefinition() TCPP_NOEXCEPT
         return;
     }
 
-    if (std::find_if(
-            mSymTable.cbegin(),
-            mSymTable.cend(),
-            [&macroDesc](auto &&item)
-            { return item.mName == macroDesc.mName; }) != mSymTable.cend())
+    if (_findMacro(macroDesc.mName))
     {
         mOnErrorCallback(
             {E_ERROR_TYPE::MACRO_ALREADY_DEFINED, mpLexer->GetCurrLineIndex()});
         return;
     }
 
-    mSymTable.push_back(macroDesc);
+    std::string_view macroName = mpLexer->Intern(macroDesc.mName);
+    mSymTable.emplace(macroName, std::move(macroDesc));
 }
 
-void Preprocessor::_removeMacroDefinition(const std::string &macroName)
+void Preprocessor::_removeMacroDefinition(std::string_view macroName)
     TCPP_NOEXCEPT
 {
     if (_shouldTokenBeSkipped())
@@ -1524,19 +1741,13 @@ void Preprocessor::_removeMacroDefinition(const std::string &macroName)
         return;
     }
 
-    auto iter = std::find_if(
-        mSymTable.cbegin(),
-        mSymTable.cend(),
-        [&macroName](auto &&item) { return item.mName == macroName; });
-    if (iter == mSymTable.cend())
+    if (mSymTable.erase(macroName) == 0)
     {
         mOnErrorCallback(
             {E_ERROR_TYPE::UNDEFINED_MACRO, mpLexer->GetCurrLineIndex()});
         return;
     }
 
-    mSymTable.erase(iter);
-
     auto currToken = mpLexer->GetNextToken();
     _expect(E_TOKEN_TYPE::NEWLINE, currToken.mType);
 }
@@ -1549,20 +1760,6 @@ std::vector<TToken> Preprocessor::_expandMacroDefinition(
     // \note expand object like macro with simple replacement
     if (macroDesc.mArgsNames.empty())
     {
-        static const std::unordered_map<std::string, std::function<TToken()>>
-            systemMacrosTable{
-                {BuiltInDefines[0],
-                 [&idToken]()
-                 {
-                     return TToken{
-                         E_TOKEN_TYPE::BLOB, std::to_string(idToken.mLineId)};
-                 }}, // __LINE__
-                {BuiltInDefines[1],
-                 [&idToken]() {
-                     return TToken{E_TOKEN_TYPE::BLOB, idToken.mRawView};
-                 }}, // __VA_ARGS__
-            };
-
         if (E_TOKEN_TYPE::CONCAT_OP ==
             mpLexer->PeekNextToken()
                 .mType) // If an argument is stringized or concatenated, the
@@ -1570,20 +1767,27 @@ std::vector<TToken> Preprocessor::_expandMacroDefinition(
         {
             return {TToken{
                 E_TOKEN_TYPE::BLOB,
-                macroDesc.mName}}; // BLOB type is used instead of IDENTIFIER to
-                                   // prevent infinite loop
+                mpLexer->Intern(
+                    macroDesc.mName)}}; // BLOB type is used instead of
+                                        // IDENTIFIER to prevent infinite loop
+        }
+
+        if (macroDesc.mName == BuiltInDefines[0]) // __LINE__
+        {
+            return {TToken{
+                E_TOKEN_TYPE::BLOB,
+                mpLexer->Store(std::to_string(idToken.mLineId))}};
         }
 
-        auto iter = systemMacrosTable.find(macroDesc.mName);
-        if (iter != systemMacrosTable.cend())
+        if (macroDesc.mName == BuiltInDefines[1]) // __VA_ARGS__
         {
-            return {iter->second()};
+            return {TToken{E_TOKEN_TYPE::BLOB, idToken.mRawView}};
         }
 
         return macroDesc.mValue;
     }
 
-    mContextStack.push_back(macroDesc.mName);
+    mContextStack.push_back(mpLexer->Intern(macroDesc.mName));
 
     // \note function like macro's case
     auto currToken = getNextTokenCallback();
@@ -1596,7 +1800,7 @@ std::vector<TToken> Preprocessor::_expandMacroDefinition(
     if (E_TOKEN_TYPE::OPEN_BRACKET != currToken.mType)
     {
         return {
-            TToken{E_TOKEN_TYPE::BLOB, macroDesc.mName},
+            TToken{E_TOKEN_TYPE::BLOB, mpLexer->Intern(macroDesc.mName)},
             currToken}; // \note Function like macro without brackets are is not
                         // expanded
     }
@@ -1677,7 +1881,7 @@ std::vector<TToken> Preprocessor::_expandMacroDefinition(
             }
         }
 
-        processingTokens.push_back(currArgTokens);
+        processingTokens.push_back(std::move(currArgTokens));
 
         if (currToken.mType == E_TOKEN_TYPE::CLOSE_BRACKET)
         {
@@ -1736,7 +1940,7 @@ std::vector<TToken> Preprocessor::_expandMacroDefinition(
                 continue;
             }
 
-            currToken.mRawView = replacementValue;
+            currToken.mRawView = mpLexer->Store(replacementValue);
         }
 
         if (variadics)
@@ -1745,7 +1949,8 @@ std::vector<TToken> Preprocessor::_expandMacroDefinition(
         }
     }
 
-    replacementList.push_back({E_TOKEN_TYPE::REJECT_MACRO, macroDesc.mName});
+    replacementList.push_back(
+        {E_TOKEN_TYPE::REJECT_MACRO, mpLexer->Intern(macroDesc.mName)});
     return replacementList;
 }
 
@@ -1869,17 +2074,12 @@ Preprocessor::_processIfdefConditional() TCPP_NOEXCEPT
     currToken = mpLexer->GetNextToken();
     _expect(E_TOKEN_TYPE::IDENTIFIER, currToken.mType);
 
-    std::string macroIdentifier = currToken.mRawView;
+    std::string_view macroIdentifier = currToken.mRawView;
 
     currToken = mpLexer->GetNextToken();
     _expect(E_TOKEN_TYPE::NEWLINE, currToken.mType);
 
-    bool skip = std::find_if(
-                    mSymTable.cbegin(),
-                    mSymTable.cend(),
-                    [&macroIdentifier](auto &&item) {
-                        return item.mName == macroIdentifier;
-                    }) == mSymTable.cend();
+    bool skip = _findMacro(macroIdentifier) == nullptr;
 
     // \note IsParentBlockActive is used to inherit disabled state for nested
     // blocks
@@ -1895,17 +2095,12 @@ Preprocessor::_processIfndefConditional() TCPP_NOEXCEPT
     currToken = mpLexer->GetNextToken();
     _expect(E_TOKEN_TYPE::IDENTIFIER, currToken.mType);
 
-    std::string macroIdentifier = currToken.mRawView;
+    std::string_view macroIdentifier = currToken.mRawView;
 
     currToken = mpLexer->GetNextToken();
     _expect(E_TOKEN_TYPE::NEWLINE, currToken.mType);
 
-    bool skip = std::find_if(
-                    mSymTable.cbegin(),
-                    mSymTable.cend(),
-                    [&macroIdentifier](auto &&item) {
-                        return item.mName == macroIdentifier;
-                    }) != mSymTable.cend();
+    bool skip = _findMacro(macroIdentifier) != nullptr;
 
     // \note IsParentBlockActive is used to inherit disabled state for nested
     // blocks
@@ -2010,12 +2205,7 @@ int Preprocessor::_evaluateExpression(
 
                 // \note simple identifier
                 return static_cast<int>(
-                    std::find_if(
-                        mSymTable.cbegin(),
-                        mSymTable.cend(),
-                        [&identifierToken](auto &&item) {
-                            return item.mName == identifierToken.mRawView;
-                        }) != mSymTable.cend());
+                    _findMacro(identifierToken.mRawView) != nullptr);
             }
             else
             {
@@ -2024,17 +2214,13 @@ int Preprocessor::_evaluateExpression(
             }
 
             /// \note Try to expand macro's value
-            auto it = std::find_if(
-                mSymTable.cbegin(),
-                mSymTable.cend(),
-                [&identifierToken](auto &&item)
-                { return item.mName == identifierToken.mRawView; });
+            const TMacroDesc *it = _findMacro(identifierToken.mRawView);
 
-            if (it == mSymTable.cend())
+            if (!it)
             {
                 /// \note Lexer for now doesn't support numbers recognition so
                 /// numbers are recognized as identifiers too
-                return atoi(identifierToken.mRawView.c_str());
+                return atoi(std::string(identifierToken.mRawView).c_str());
             }
             else
             {
@@ -2058,7 +2244,7 @@ int Preprocessor::_evaluateExpression(
 
         case E_TOKEN_TYPE::NUMBER:
             tokens.erase(tokens.cbegin());
-            return std::stoi(currToken.mRawView);
+            return std::stoi(std::string(currToken.mRawView));
 
         case E_TOKEN_TYPE::OPEN_BRACKET:
             tokens.erase(tokens.cbegin());
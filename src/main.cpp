@@ -1,207 +1,459 @@
 #include "AST/AST.hpp"
 #include "CLI/CLI.hpp"
 #include "CodeGen/CodeGenModule.hpp"
+#include "CodeGen/TargetMachineCache.hpp"
 #include "CodeGen/TypeChecker.hpp"
+#include "Driver/CompileStats.hpp"
+#include "Driver/Linker.hpp"
+#include "Driver/Preprocess.hpp"
+#include "llvm/Support/TimeProfiler.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/TargetParser/Host.h"
 
 #include <boost/filesystem.hpp>
+#include <atomic>
+#include <chrono>
 #include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <unordered_set>
 
-#define TCPP_IMPLEMENTATION
-#include "Preprocessor.hpp"
+/**
+ * Settings shared by every translation unit in a single invocation.
+ */
+struct CompileOptions
+{
+    std::string targetTriple;
+    CodeGen::OptLevel optLevel = CodeGen::OptLevel::O0;
+    bool emitLLVM = false;
+    bool print = false;
+    bool timePasses = false;
+    bool timeTrace = false;
+    // Spans shorter than this (in microseconds) are left out of the trace
+    unsigned timeTraceGranularity = 500;
+};
 
-void preprocess(const std::string &sourcePath, const std::string &outputPath)
+/**
+ * Compiles one translation unit to an object file (or LLVM IR with -S). If
+ * object is given, the object code is written there instead of to outputPath.
+ * Safe to call from several threads, each call owns its own LLVMContext.
+ */
+void compile(
+    const std::string &sourcePath,
+    const std::string &outputPath,
+    const CompileOptions &options,
+    Driver::IncludeCache &includeCache,
+    Driver::CompileStats &stats,
+    Driver::ObjectBuffer *object)
 {
-    // Open sourcePath, spill contents as std::string
-    std::ifstream ifs(sourcePath);
-    std::string sourceContents(
-        (std::istreambuf_iterator<char>(ifs)),
-        (std::istreambuf_iterator<char>()));
-
-    auto errorCallback = [](const tcpp::TErrorInfo &msg) {};
-    tcpp::Preprocessor::TOnIncludeCallback includeCallback =
-        [&includeCallback, &errorCallback, &sourcePath](
-            const std::string &path,
-            bool isSystem) -> tcpp::TInputStreamUniquePtr
-    {
-        // Search sourcePath's directory for the include file
-        boost::filesystem::path sourceDir =
-            boost::filesystem::path(sourcePath).parent_path();
-        boost::filesystem::path includePath = sourceDir / path;
-
-        auto tempFile = boost::filesystem::temp_directory_path() /
-                        boost::filesystem::unique_path();
-        std::string processedCPath = tempFile.string();
-        preprocess(includePath.string(), processedCPath);
-        std::ifstream ifs(processedCPath);
-        std::string processedC(
-            (std::istreambuf_iterator<char>(ifs)),
-            (std::istreambuf_iterator<char>()));
-
-        return std::make_unique<tcpp::StringInputStream>(processedC);
-    };
-    tcpp::Lexer lexer(
-        std::make_unique<tcpp::StringInputStream>(sourceContents));
-    tcpp::Preprocessor preprocessor(lexer, {errorCallback, includeCallback});
+    using Phase = Driver::CompileStats::Phase;
+    using Timer = Driver::CompileStats::Timer;
 
-    std::string processedC = preprocessor.Process();
+    // Every phase nests under this span in the -ftime-trace output
+    llvm::TimeTraceScope timeScope("Compile", sourcePath);
 
+    // Preprocess the input, the output never touches the disk
+    std::string preprocessed;
     {
-        std::ofstream ofs(outputPath);
-        ofs << processedC;
+        Timer timer(stats, Phase::Preprocess);
+        preprocessed =
+            Driver::preprocessFile(sourcePath, includeCache, stats);
     }
-}
 
-void link(const std::string &sourcePath, const std::string &outputPath)
-{
-    FILE *pipe = popen("which clang", "r");
-    if (!pipe)
+    // Parse the AST. Every node lives in astContext and is released at once
+    // when this translation unit is done
+    AST::ASTContext astContext;
+    const AST::TranslationUnit *tu;
     {
-        std::cerr << "Error: failed to run which clang\n";
-        return;
+        Timer timer(stats, Phase::Parse);
+        tu = AST::parseSource(preprocessed, astContext);
     }
+    stats.addCounter("ast.nodes", astContext.getNumNodes());
+    stats.addCounter("ast.bytes_allocated", astContext.getBytesAllocated());
+    stats.addCounter("ast.identifiers", astContext.getNumIdentifiers());
 
-    char buffer[256];
-    std::string clangPath;
-    if (fgets(buffer, sizeof(buffer), pipe))
+    if (options.print)
     {
-        clangPath = buffer;
-        clangPath.erase(
-            std::remove(clangPath.begin(), clangPath.end(), '\n'),
-            clangPath.end());
+        AST::Printer printer(std::cout);
+        tu->accept(printer);
     }
-    pclose(pipe);
 
-    if (clangPath.empty())
+    // Type check the AST
+    CodeGen::TypeChecker typeChecker(astContext, options.targetTriple);
     {
-        std::cerr << "Error: clang not found in PATH\n";
-        return;
+        Timer timer(stats, Phase::TypeCheck);
+        tu->accept(typeChecker);
     }
+    stats.addCounter(
+        "typecheck.node_map_entries", typeChecker.getNodeMap().size());
+    // Types are uniqued, so this is every type the translation unit needed
+    stats.addCounter("typecheck.types", astContext.getNumTypes());
 
-    std::cout << "Invoking: " << clangPath << std::endl;
-
-    // Calling std::system is not best practice, however, it works here
-    std::string cmd = clangPath + " " + sourcePath + " -o " + outputPath;
-    if (std::system(cmd.c_str()) != 0)
+    // Code generation
+    std::optional<CodeGen::CodeGenModule> CGM;
     {
-        std::cerr << "Error: clang invocation failed\n";
+        Timer timer(stats, Phase::Startup);
+        CGM.emplace(
+            sourcePath,
+            outputPath,
+            astContext,
+            typeChecker.getNodeMap(),
+            typeChecker.getStructMap(),
+            typeChecker.getConstantMap(),
+            options.targetTriple,
+            options.optLevel);
     }
-}
+    {
+        Timer timer(stats, Phase::IRGen);
+        tu->accept(*CGM);
+    }
+    stats.addCounter("irgen.instructions", CGM->getNumInstructions());
 
-void compile(
-    const std::string &sourcePath,
-    const std::string &outputPath,
-    const std::string &targetTriple,
-    bool emitLLVM,
-    bool useLinker,
-    bool print)
-{
-    bool needLinker = useLinker && !emitLLVM;
-    std::string outputPathCGM = outputPath;
+    {
+        Timer timer(stats, Phase::Optimize);
+        std::string passTimings;
+        llvm::raw_string_ostream os(passTimings);
+        CGM->optimize(options.timePasses ? &os : nullptr);
+        if (options.timePasses)
+        {
+            stats.addPassTimings(sourcePath, std::move(passTimings));
+        }
+    }
+    stats.addCounter("optimize.instructions", CGM->getNumInstructions());
 
-    // Temporary file needed. *.c -> *.o -> a.out
-    if (needLinker)
+    Timer timer(stats, Phase::Emit);
+    if (options.emitLLVM)
     {
-        auto tempFile = boost::filesystem::temp_directory_path() /
-                        boost::filesystem::unique_path();
-        outputPathCGM = tempFile.string();
+        CGM->emitLLVM();
     }
+    else if (object)
+    {
+        llvm::raw_svector_ostream os(*object);
+        CGM->emitObject(os);
+    }
+    else
+    {
+        CGM->emitObject();
+    }
+}
 
-    auto tempFile = boost::filesystem::temp_directory_path() /
-                    boost::filesystem::unique_path();
-    std::string preprocessedPath = tempFile.string();
+/**
+ * Compiles every translation unit, using up to `jobs` worker threads. If
+ * objects is given, object code is kept in memory, one buffer per source.
+ * Returns false if any translation unit failed.
+ */
+bool compileAll(
+    const std::vector<std::string> &sourcePaths,
+    const std::vector<std::string> &outputPaths,
+    const CompileOptions &options,
+    unsigned jobs,
+    Driver::CompileStats &stats,
+    std::vector<Driver::ObjectBuffer> *objects = nullptr)
+{
+    // Shared, so a header included by several translation units is read once
+    Driver::IncludeCache includeCache;
+    std::atomic<size_t> next = 0;
+    std::atomic<bool> success = true;
+    std::mutex outputMutex;
 
-    // Preprocess the input
-    preprocess(sourcePath, preprocessedPath);
+    auto worker = [&]()
+    {
+        for (size_t i = next++; i < sourcePaths.size(); i = next++)
+        {
+            {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cout << "Compiling: " << sourcePaths[i] << std::endl;
+            }
 
-    // Parse the AST
-    const AST::TranslationUnit *tu = AST::parseAST(preprocessedPath);
+            try
+            {
+                compile(
+                    sourcePaths[i],
+                    outputPaths[i],
+                    options,
+                    includeCache,
+                    stats,
+                    objects ? &(*objects)[i] : nullptr);
+            }
+            catch (const std::exception &e)
+            {
+                std::lock_guard<std::mutex> lock(outputMutex);
+                std::cerr << sourcePaths[i] << ": error: " << e.what()
+                          << std::endl;
+                success = false;
+            }
+        }
+    };
 
-    if (print)
+    jobs = std::max(1u, std::min<unsigned>(jobs, sourcePaths.size()));
+    if (jobs == 1)
     {
-        AST::Printer printer(std::cout);
-        tu->accept(printer);
+        worker();
+        return success;
     }
 
-    // Type check the AST
-    CodeGen::TypeChecker typeChecker;
-    tu->accept(typeChecker);
-
-    // Code generation
-    CodeGen::CodeGenModule CGM(
-        sourcePath,
-        outputPathCGM,
-        typeChecker.getNodeMap(),
-        typeChecker.getStructMap(),
-        targetTriple);
-    tu->accept(CGM);
-
-    if (emitLLVM)
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < jobs; i++)
     {
-        CGM.emitLLVM();
+        workers.emplace_back(
+            [&]()
+            {
+                // The profiler records per thread, main has its own
+                if (options.timeTrace)
+                {
+                    llvm::timeTraceProfilerInitialize(
+                        options.timeTraceGranularity, "rcc");
+                }
+                worker();
+                if (options.timeTrace)
+                {
+                    llvm::timeTraceProfilerFinishThread();
+                }
+            });
     }
-    else
+    for (auto &thread : workers)
     {
-        CGM.emitObject();
+        thread.join();
     }
 
-    // Link (if possible)
-    if (needLinker)
-    {
-        link(outputPathCGM, outputPath);
-    }
+    return success;
 }
 
 int main(int argc, char **argv)
 {
     CLI::App app;
-    std::string sourcePath;
+    std::vector<std::string> sourcePaths;
     std::string outputPath;
-    std::string targetTriple;
-    bool emitLLVM = false;
+    std::string optLevelStr = "0";
+    unsigned jobs = 1;
     bool noLink = false;
-    bool print = false;
+    bool timeReport = false;
+    bool printStats = false;
+    std::string statsFile;
+    std::string timeTraceFile;
+    bool useLinkDriver = false;
+    CompileOptions options;
+    Driver::LinkOptions linkOptions;
 
     // Options for the CLI
 
     // Add positional argument
-    app.add_option("source", sourcePath, "Source file path")
+    app.add_option("sources", sourcePaths, "Source file paths")
         ->required()
         ->check(CLI::ExistingFile);
     app.add_option("-o", outputPath, "Output file path");
     app.add_flag(
         "-c", noLink, "Only run preprocess, compile and assemble steps");
-    app.add_flag("-S", emitLLVM, "Emit LLVM IR instead of object code");
-    app.add_flag("-v", print, "Show parser output");
     app.add_flag(
-        "--target", targetTriple, "Generate code for the given target");
+        "-S", options.emitLLVM, "Emit LLVM IR instead of object code");
+    app.add_flag("-v", options.print, "Show parser output");
+    app.add_flag(
+        "--target",
+        options.targetTriple,
+        "Generate code for the given target");
+    app.add_option("-O", optLevelStr, "Optimisation level (0, 1, 2, 3, s)")
+        ->check(CLI::IsMember({"0", "1", "2", "3", "s"}));
+    app.add_option(
+           "-j", jobs, "Number of translation units to compile in parallel")
+        ->check(CLI::PositiveNumber);
+    app.add_flag(
+        "--time-report",
+        timeReport,
+        "Report the time spent in each phase and optimization pass");
+    app.add_flag("--stats", printStats, "Report counters for each phase");
+    app.add_option(
+        "--stats-file",
+        statsFile,
+        "Write the time report and counters as JSON");
+    app.add_option(
+        "--time-trace",
+        timeTraceFile,
+        "Write a Chrome trace (-ftime-trace) of every phase and pass");
+    app.add_option(
+        "--time-trace-granularity",
+        options.timeTraceGranularity,
+        "Minimum time in microseconds for a span to be traced");
+    app.add_flag(
+        "--link-driver",
+        useLinkDriver,
+        "Link by invoking clang instead of the built in linker");
+    app.add_option(
+        "--libc-path",
+        linkOptions.libraryPaths,
+        "Directories searched for the C runtime and libraries when linking");
 
     CLI11_PARSE(app, argc, argv);
 
+    const std::unordered_map<std::string, CodeGen::OptLevel> optLevels = {
+        {"0", CodeGen::OptLevel::O0},
+        {"1", CodeGen::OptLevel::O1},
+        {"2", CodeGen::OptLevel::O2},
+        {"3", CodeGen::OptLevel::O3},
+        {"s", CodeGen::OptLevel::Os},
+    };
+    options.optLevel = optLevels.at(optLevelStr);
+    options.timePasses = timeReport;
+    options.timeTrace = !timeTraceFile.empty();
+    if (options.timeTrace)
+    {
+        llvm::timeTraceProfilerInitialize(options.timeTraceGranularity, "rcc");
+    }
+
+    Driver::CompileStats stats;
+    auto start = Driver::CompileStats::Clock::now();
+
+    bool needLinker = !noLink && !options.emitLLVM;
+    if (!needLinker && !outputPath.empty() && sourcePaths.size() > 1)
+    {
+        std::cerr << "Error: cannot specify -o when generating multiple "
+                     "output files\n";
+        return 1;
+    }
+
+    // Link in process where we can, keeping the objects in memory
+    llvm::Triple triple(
+        options.targetTriple.empty() ? llvm::sys::getDefaultTargetTriple()
+                                     : options.targetTriple);
+    bool linkInProcess =
+        needLinker && !useLinkDriver && Driver::canLinkInProcess(triple);
+
     // Follows conventions set by clang
-    if (outputPath.empty())
+    std::vector<std::string> outputPaths;
+    for (const auto &sourcePath : sourcePaths)
     {
         std::filesystem::path p{sourcePath};
         std::string stem = p.stem().string();
 
         // Descending order: assembly -> executable
-        if (emitLLVM)
+        if (linkInProcess)
+        {
+            // Never written, the object stays in memory
+            outputPaths.push_back(stem + ".o");
+        }
+        else if (needLinker)
         {
-            outputPath = stem + ".ll";
+            // Temporary file needed. *.c -> *.o -> a.out
+            auto tempFile = boost::filesystem::temp_directory_path() /
+                            boost::filesystem::unique_path();
+            outputPaths.push_back(tempFile.string());
         }
-        else if (noLink)
+        else if (!outputPath.empty())
         {
-            outputPath = stem + ".o";
+            outputPaths.push_back(outputPath);
+        }
+        else if (options.emitLLVM)
+        {
+            outputPaths.push_back(stem + ".ll");
         }
         else
         {
-            outputPath = "a.out";
+            outputPaths.push_back(stem + ".o");
+        }
+    }
+
+    if (needLinker && outputPath.empty())
+    {
+        outputPath = "a.out";
+    }
+
+    // Once, up front, instead of on the first compile job
+    CodeGen::TargetMachineCache::initializeTargets();
+    auto targetStats = CodeGen::TargetMachineCache::getInstance().getStats();
+    stats.addTime(Driver::CompileStats::Phase::Startup, targetStats.initTime);
+
+    std::vector<Driver::ObjectBuffer> objects(sourcePaths.size());
+    bool success = compileAll(
+        sourcePaths,
+        outputPaths,
+        options,
+        jobs,
+        stats,
+        linkInProcess ? &objects : nullptr);
+
+    targetStats = CodeGen::TargetMachineCache::getInstance().getStats();
+    stats.addCounter("target_machines.created", targetStats.numCreated);
+    stats.addCounter("target_machines.reused", targetStats.numReused);
+
+    // Link (if possible), once for all translation units
+    if (success && needLinker)
+    {
+        Driver::CompileStats::Timer timer(
+            stats, Driver::CompileStats::Phase::Link);
+        try
+        {
+            if (linkInProcess)
+            {
+                Driver::linkInProcess(objects, outputPath, triple, linkOptions);
+            }
+            else
+            {
+                Driver::linkWithDriver(outputPaths, outputPath);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error: " << e.what() << "\n";
+            success = false;
+        }
+    }
+
+    // The temporary objects, also those left by a failed compile or link
+    if (needLinker && !linkInProcess)
+    {
+        for (const auto &objectPath : outputPaths)
+        {
+            std::error_code error;
+            std::filesystem::remove(objectPath, error);
         }
     }
 
-    std::cout << "Compiling: " << sourcePath << std::endl;
-    compile(sourcePath, outputPath, targetTriple, emitLLVM, !noLink, print);
-    std::cout << "Compiled to: " << outputPath << std::endl;
+    stats.setTotalTime(Driver::CompileStats::Clock::now() - start);
+    if (timeReport)
+    {
+        stats.printTimeReport(std::cerr);
+    }
+    if (printStats)
+    {
+        stats.printStats(std::cerr);
+    }
+    if (!statsFile.empty())
+    {
+        std::ofstream ofs(statsFile);
+        stats.printJSON(ofs);
+    }
+    if (options.timeTrace)
+    {
+        // Worker threads have finished, so their events are included
+        if (auto err = llvm::timeTraceProfilerWrite(timeTraceFile, outputPath))
+        {
+            std::cerr << "Error: could not write time trace: "
+                      << llvm::toString(std::move(err)) << "\n";
+            success = false;
+        }
+        llvm::timeTraceProfilerCleanup();
+    }
+
+    if (!success)
+    {
+        return 1;
+    }
+
+    if (needLinker)
+    {
+        std::cout << "Compiled to: " << outputPath << std::endl;
+    }
+    else
+    {
+        for (const auto &path : outputPaths)
+        {
+            std::cout << "Compiled to: " << path << std::endl;
+        }
+    }
 
     return 0;
-}
\ No newline at end of file
+}
@@ -3,21 +3,32 @@
 %code requires{
     #include "AST/AST.hpp"
 
+    #include <fstream>
+    #include <stdexcept>
     #include <string>
 
     using namespace AST;
 
-    extern FILE *yyin;
-    extern const TranslationUnit *g_root;
+    // Opaque handle to the reentrant Flex scanner
+    typedef void *yyscan_t;
+}
 
+%code provides{
     // Declare functions provided by Flex,
     // so that Bison generated code can call them.
-    int yylex(void);
-    void yyerror(const char *);
-    int yylex_destroy(void);
-	void updateTypeDefs(std::string id);
+    int yylex(YYSTYPE *yylval, yyscan_t scanner);
+    void yyerror(yyscan_t scanner, ParseContext &context, const char *s);
+    int yylex_init_extra(ParseContext *context, yyscan_t *scanner);
+    struct yy_buffer_state *
+    yy_scan_bytes(const char *bytes, int len, yyscan_t scanner);
+    void yy_delete_buffer(struct yy_buffer_state *buffer, yyscan_t scanner);
+    int yylex_destroy(yyscan_t scanner);
 }
 
+%define api.pure full
+%lex-param {yyscan_t scanner}
+%parse-param {yyscan_t scanner} {ParseContext &context}
+
 %union {
     TranslationUnit                     *tu;
     FnDef                  				*func_def;
@@ -55,6 +66,7 @@
 	std::variant<DeclNode*, FnDef*>     *ext_decl;
 
     std::string                         *string;
+    Symbol                              symbol;
     int                                 integer;
     yytokentype                         token;
 }
@@ -72,7 +84,8 @@
 
 %token CASE DEFAULT IF ELSE SWITCH WHILE DO FOR GOTO CONTINUE BREAK RETURN
 
-%token <string> IDENTIFIER CONSTANT STRING_LITERAL TYPE_NAME
+%token <symbol> IDENTIFIER TYPE_NAME
+%token <string> CONSTANT STRING_LITERAL
 %type <string> string_literal
 
 %type <assignment_op> assignment_operator
@@ -123,7 +136,7 @@
 
 root
 	: translation_unit
-		{ g_root = $1; }
+		{ context.setRoot($1); }
 	;
 
 /* 
@@ -144,56 +157,56 @@ string_literal
 
 primary_expression
 	: IDENTIFIER
-		{ $$ = new Identifier(std::string(*$1)); }
+		{ $$ = context.create<Identifier>($1); }
 	| CONSTANT
-		{ $$ = new Constant(std::string(*$1)); }
+		{ $$ = context.create<Constant>(std::string(*$1)); }
 	| string_literal
-		{ $$ = new StringLiteral(std::string(*$1)); }
+		{ $$ = context.create<StringLiteral>(std::string(*$1)); }
 	| '(' expression ')'
-		{ $$ = new Paren($2); }
+		{ $$ = context.create<Paren>($2); }
 	;
 
 postfix_expression
 	: primary_expression
 		{ $$ = $1; }
 	| postfix_expression '[' expression ']'
-		{ $$ = new ArrayAccess($1, $3); }
+		{ $$ = context.create<ArrayAccess>($1, $3); }
 	| postfix_expression '(' ')'
-		{ $$ = new FnCall($1); }
+		{ $$ = context.create<FnCall>($1); }
 	| postfix_expression '(' argument_expression_list ')'
-		{ $$ = new FnCall($1, $3); }
+		{ $$ = context.create<FnCall>($1, $3); }
 	| postfix_expression '.' IDENTIFIER
-		{ $$ = new StructAccess($1, std::string(*$3)); }
+		{ $$ = context.create<StructAccess>($1, $3); }
 	| postfix_expression PTR_OP IDENTIFIER
-		{ $$ = new StructPtrAccess($1, std::string(*$3)); }
+		{ $$ = context.create<StructPtrAccess>($1, $3); }
 	| postfix_expression INC_OP
-		{ $$ = new UnaryOp($1, UnaryOp::Op::POST_INC); }
+		{ $$ = context.create<UnaryOp>($1, UnaryOp::Op::POST_INC); }
 	| postfix_expression DEC_OP
-		{ $$ = new UnaryOp($1, UnaryOp::Op::POST_DEC); }
+		{ $$ = context.create<UnaryOp>($1, UnaryOp::Op::POST_DEC); }
 	| '(' type_name ')' '{' initializer_list '}'
 	| '(' type_name ')' '{' initializer_list ',' '}'
 	;
 
 argument_expression_list
 	: assignment_expression
-		{ $$ = new ArgExprList($1); }
+		{ $$ = context.create<ArgExprList>(context.getASTContext(), $1); }
 	| argument_expression_list ',' assignment_expression
-		{ $1->pushBack($3); $$ = $1; }
+		{ $1->pushBack(context.getASTContext(), $3); $$ = $1; }
 	;
 
 unary_expression
 	: postfix_expression
 		{ $$ = $1; }
 	| INC_OP unary_expression
-		{ $$ = new UnaryOp($2, UnaryOp::Op::PRE_INC); }
+		{ $$ = context.create<UnaryOp>($2, UnaryOp::Op::PRE_INC); }
 	| DEC_OP unary_expression
-		{ $$ = new UnaryOp($2, UnaryOp::Op::PRE_DEC); }
+		{ $$ = context.create<UnaryOp>($2, UnaryOp::Op::PRE_DEC); }
 	| unary_operator cast_expression
-		{ $$ = new UnaryOp($2, $1); }
+		{ $$ = context.create<UnaryOp>($2, $1); }
 	| SIZEOF unary_expression
-		{ $$ = new SizeOf($2); }
+		{ $$ = context.create<SizeOf>($2); }
 	| SIZEOF '(' type_name ')'
-		{ $$ = new SizeOf($3); }
+		{ $$ = context.create<SizeOf>($3); }
 	;
 
 unary_operator
@@ -215,107 +228,107 @@ cast_expression
 	: unary_expression
 		{ $$ = $1; }
 	| '(' type_name ')' cast_expression
-		{ $$ = new Cast($2, $4); }
+		{ $$ = context.create<Cast>($2, $4); }
 	;
 
 multiplicative_expression
 	: cast_expression
 	 	{ $$ = $1; }
 	| multiplicative_expression '*' cast_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::MUL); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::MUL); }
 	| multiplicative_expression '/' cast_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::DIV); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::DIV); }
 	| multiplicative_expression '%' cast_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::MOD); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::MOD); }
 	;
 
 additive_expression
 	: multiplicative_expression
 		{ $$ = $1; }
 	| additive_expression '+' multiplicative_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::ADD); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::ADD); }
 	| additive_expression '-' multiplicative_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::SUB); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::SUB); }
 	;
 
 shift_expression
 	: additive_expression
 		{ $$ = $1; }
 	| shift_expression LEFT_OP additive_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::SHL); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::SHL); }
 	| shift_expression RIGHT_OP additive_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::SHR); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::SHR); }
 	;
 
 relational_expression
 	: shift_expression
 		{ $$ = $1; }
 	| relational_expression '<' shift_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::LT); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::LT); }
 	| relational_expression '>' shift_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::GT); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::GT); }
 	| relational_expression LE_OP shift_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::LE); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::LE); }
 	| relational_expression GE_OP shift_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::GE); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::GE); }
 	;
 
 equality_expression
 	: relational_expression
 		{ $$ = $1; }
 	| equality_expression EQ_OP relational_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::EQ); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::EQ); }
 	| equality_expression NE_OP relational_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::NE); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::NE); }
 	;
 
 and_expression
 	: equality_expression
 		{ $$ = $1; }
 	| and_expression '&' equality_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::AND); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::AND); }
 	;
 
 exclusive_or_expression
 	: and_expression
 		{ $$ = $1; }
 	| exclusive_or_expression '^' and_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::XOR); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::XOR); }
 	;
 
 inclusive_or_expression
 	: exclusive_or_expression
 		{ $$ = $1; }
 	| inclusive_or_expression '|' exclusive_or_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::OR); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::OR); }
 	;
 
 logical_and_expression
 	: inclusive_or_expression
 		{ $$ = $1; }
 	| logical_and_expression AND_OP inclusive_or_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::LAND); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::LAND); }
 	;
 
 logical_or_expression
 	: logical_and_expression
 		{ $$ = $1; }
 	| logical_or_expression OR_OP logical_and_expression
-		{ $$ = new BinaryOp($1, $3, BinaryOp::Op::LOR); }
+		{ $$ = context.create<BinaryOp>($1, $3, BinaryOp::Op::LOR); }
 	;
 
 conditional_expression
 	: logical_or_expression
 		{ $$ = $1; }
 	| logical_or_expression '?' expression ':' conditional_expression
-		{ $$ = new TernaryOp($1, $3, $5); }
+		{ $$ = context.create<TernaryOp>($1, $3, $5); }
 	;
 
 assignment_expression
 	: conditional_expression
 		{ $$ = $1; }
 	| unary_expression assignment_operator assignment_expression
-		{ $$ = new Assignment($1, $3, $2); }
+		{ $$ = context.create<Assignment>($1, $3, $2); }
 	;
 
 assignment_operator
@@ -356,105 +369,105 @@ constant_expression
 
 declaration
 	: declaration_specifiers ';'
-		{ $$ = new DeclNode($1); }
+		{ $$ = context.create<DeclNode>($1); }
 	| TYPEDEF declaration_specifiers init_declarator_list ';'
 		{
 			for (const auto &node : $3->nodes_)
 			{
-				auto *decl = std::get<0>(node).get();
-				updateTypeDefs(decl->getID());
+				auto *decl = std::get<0>(node);
+				context.addTypedef(decl->getID());
 			}
 
-			$$ = new DeclNode(new Typedef($2), $3);
+			$$ = context.create<DeclNode>(context.create<Typedef>($2), $3);
 		}
 	| declaration_specifiers init_declarator_list ';'
-		{ $$ = new DeclNode($1, $2); }
+		{ $$ = context.create<DeclNode>($1, $2); }
 	;
 
 declaration_specifiers
 	: storage_class_specifier
-		{ $$ = new CompoundTypeDecl($1); }
+		{ $$ = context.create<CompoundTypeDecl>(context.getASTContext(), $1); }
 	| storage_class_specifier declaration_specifiers
-		{ $2->pushBack($1); $$ = $2; }
+		{ $2->pushBack(context.getASTContext(), $1); $$ = $2; }
 	| type_specifier
-		{ $$ = new CompoundTypeDecl($1); }
+		{ $$ = context.create<CompoundTypeDecl>(context.getASTContext(), $1); }
 	| type_specifier declaration_specifiers
-		{ $2->pushBack($1); $$ = $2; }
+		{ $2->pushBack(context.getASTContext(), $1); $$ = $2; }
 	| type_qualifier
-		{ $$ = new CompoundTypeDecl($1); }
+		{ $$ = context.create<CompoundTypeDecl>(context.getASTContext(), $1); }
 	| type_qualifier declaration_specifiers
-		{ $2->pushBack($1); $$ = $2; }
+		{ $2->pushBack(context.getASTContext(), $1); $$ = $2; }
 	| function_specifier
-		{ $$ = new CompoundTypeDecl($1); }
+		{ $$ = context.create<CompoundTypeDecl>(context.getASTContext(), $1); }
 	| function_specifier declaration_specifiers
-		{ $2->pushBack($1); $$ = $2; }
+		{ $2->pushBack(context.getASTContext(), $1); $$ = $2; }
 	;
 
 init_declarator_list
 	: init_declarator
-		{ $$ = new InitDeclList($1); }
+		{ $$ = context.create<InitDeclList>(context.getASTContext(), $1); }
 	| init_declarator_list ',' init_declarator
-		{ $1->pushBack($3); $$ = $1; }
+		{ $1->pushBack(context.getASTContext(), $3); $$ = $1; }
 	;
 
 init_declarator
 	: declarator
-		{ $$ = new InitDecl($1); }
+		{ $$ = context.create<InitDecl>($1); }
 	| declarator '=' initializer
-		{ $$ = new InitDecl($1, $3); }
+		{ $$ = context.create<InitDecl>($1, $3); }
 	;
 
 storage_class_specifier
 	: EXTERN
-		{ $$ = new TypeModifier(TypeModifier::StorageClass::EXTERN); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::StorageClass::EXTERN); }
 	| STATIC
-		{ $$ = new TypeModifier(TypeModifier::StorageClass::STATIC); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::StorageClass::STATIC); }
 	| AUTO
-		{ $$ = new TypeModifier(TypeModifier::StorageClass::AUTO); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::StorageClass::AUTO); }
 	| REGISTER
-		{ $$ = new TypeModifier(TypeModifier::StorageClass::REGISTER); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::StorageClass::REGISTER); }
 	;
 
 type_specifier
 	: VOID
-		{ $$ = new BasicTypeDecl(Types::VOID); }
+		{ $$ = context.create<BasicTypeDecl>(Types::VOID); }
 	| CHAR
-		{ $$ = new BasicTypeDecl(Types::CHAR); }
+		{ $$ = context.create<BasicTypeDecl>(Types::CHAR); }
 	| SHORT
-		{ $$ = new BasicTypeDecl(Types::SHORT); }
+		{ $$ = context.create<BasicTypeDecl>(Types::SHORT); }
 	| INT
-		{ $$ = new BasicTypeDecl(Types::INT); }
+		{ $$ = context.create<BasicTypeDecl>(Types::INT); }
 	| LONG
-		{ $$ = new TypeModifier(TypeModifier::Length::LONG); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::Length::LONG); }
 	| FLOAT
-		{ $$ = new BasicTypeDecl(Types::FLOAT); }
+		{ $$ = context.create<BasicTypeDecl>(Types::FLOAT); }
 	| DOUBLE
-		{ $$ = new BasicTypeDecl(Types::DOUBLE); }
+		{ $$ = context.create<BasicTypeDecl>(Types::DOUBLE); }
 	| SIGNED
-		{ $$ = new TypeModifier(TypeModifier::Signedness::SIGNED); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::Signedness::SIGNED); }
 	| UNSIGNED
-		{ $$ = new TypeModifier(TypeModifier::Signedness::UNSIGNED); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::Signedness::UNSIGNED); }
 	| BOOL
-		{ $$ = new BasicTypeDecl(Types::BOOL); }
+		{ $$ = context.create<BasicTypeDecl>(Types::BOOL); }
 	| COMPLEX
-		{ $$ = new TypeModifier(TypeModifier::Complex::COMPLEX); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::Complex::COMPLEX); }
 	| IMAGINARY
-		{ $$ = new TypeModifier(TypeModifier::Complex::IMAGINARY); }
+		{ $$ = context.create<TypeModifier>(TypeModifier::Complex::IMAGINARY); }
 	| struct_or_union_specifier
 		{ $$ = $1; }
 	| enum_specifier
 		{ $$ = $1; }
 	| TYPE_NAME
-		{ $$ = new DefinedTypeDecl(std::string(*$1)); }
+		{ $$ = context.create<DefinedTypeDecl>($1); }
 	;
 
 struct_or_union_specifier
 	: struct_or_union IDENTIFIER '{' struct_declaration_list '}'
-		{ $$ = new Struct($1, std::string(*$2), $4); }
+		{ $$ = context.create<Struct>(context.getASTContext(), $1, $2, $4); }
 	| struct_or_union '{' struct_declaration_list '}'
-		{ $$ = new Struct($1, $3); }
+		{ $$ = context.create<Struct>(context.getASTContext(), $1, $3); }
 	| struct_or_union IDENTIFIER
-		{ $$ = new Struct($1, std::string(*$2)); }
+		{ $$ = context.create<Struct>(context.getASTContext(), $1, $2); }
 	;
 
 struct_or_union
@@ -466,37 +479,37 @@ struct_or_union
 
 struct_declaration_list
 	: struct_declaration
-		{ $$ = new StructMemberList($1); }
+		{ $$ = context.create<StructMemberList>(context.getASTContext(), $1); }
 	| struct_declaration_list struct_declaration
-		{ $1->pushBack($2); $$ = $1; }
+		{ $1->pushBack(context.getASTContext(), $2); $$ = $1; }
 	;
 
 struct_declaration
 	: specifier_qualifier_list struct_declarator_list ';'
-		{ $$ = new StructMember($1, $2); }
+		{ $$ = context.create<StructMember>($1, $2); }
 	;
 
 specifier_qualifier_list
 	: type_specifier specifier_qualifier_list
-		{ $2->pushBack($1); $$ = $2; }
+		{ $2->pushBack(context.getASTContext(), $1); $$ = $2; }
 	| type_specifier
-		{ $$ = new CompoundTypeDecl($1); }
+		{ $$ = context.create<CompoundTypeDecl>(context.getASTContext(), $1); }
 	| type_qualifier specifier_qualifier_list
-		{ $2->pushBack($1); $$ = $2; }
+		{ $2->pushBack(context.getASTContext(), $1); $$ = $2; }
 	| type_qualifier
-		{ $$ = new CompoundTypeDecl($1); }
+		{ $$ = context.create<CompoundTypeDecl>(context.getASTContext(), $1); }
 	;
 
 struct_declarator_list
 	: struct_declarator
-		{ $$ = new StructDeclList($1); }
+		{ $$ = context.create<StructDeclList>(context.getASTContext(), $1); }
 	| struct_declarator_list ',' struct_declarator
-		{ $1->pushBack($3); $$ = $1; }
+		{ $1->pushBack(context.getASTContext(), $3); $$ = $1; }
 	;
 
 struct_declarator
 	: declarator
-		{ $$ = new StructDecl($1); }
+		{ $$ = context.create<StructDecl>($1); }
 	| ':' constant_expression
 		/* Ignore bit fields for now */
 	| declarator ':' constant_expression
@@ -504,48 +517,48 @@ struct_declarator
 
 enum_specifier
 	: ENUM '{' enumerator_list '}'
-		{ $$ = new Enum($3); }
+		{ $$ = context.create<Enum>(context.getASTContext(), $3); }
 	| ENUM IDENTIFIER '{' enumerator_list '}'
-		{ $$ = new Enum(std::string(*$2), $4); }
+		{ $$ = context.create<Enum>(context.getASTContext(), $2, $4); }
 	| ENUM '{' enumerator_list ',' '}'
-		{ $$ = new Enum($3); }
+		{ $$ = context.create<Enum>(context.getASTContext(), $3); }
 	| ENUM IDENTIFIER '{' enumerator_list ',' '}'
-		{ $$ = new Enum(std::string(*$2), $4); }
+		{ $$ = context.create<Enum>(context.getASTContext(), $2, $4); }
 	| ENUM IDENTIFIER
-	 	{ $$ = new Enum(std::string(*$2)); }
+	 	{ $$ = context.create<Enum>(context.getASTContext(), $2); }
 	;
 
 enumerator_list
 	: enumerator
-		{ $$ = new EnumMemberList($1); }
+		{ $$ = context.create<EnumMemberList>(context.getASTContext(), $1); }
 	| enumerator_list ',' enumerator
-		{ $$ = $1; $1->pushBack($3); }
+		{ $$ = $1; $1->pushBack(context.getASTContext(), $3); }
 	;
 
 enumerator
 	: IDENTIFIER
-		{ $$ = new EnumMember(std::string(*$1)); }
+		{ $$ = context.create<EnumMember>($1); }
 	| IDENTIFIER '=' constant_expression
-		{ $$ = new EnumMember(std::string(*$1), $3); }
+		{ $$ = context.create<EnumMember>($1, $3); }
 	;
 
 type_qualifier
 	: CONST
-		{ $$ = new TypeModifier(CVRQualifier::CONST); }
+		{ $$ = context.create<TypeModifier>(CVRQualifier::CONST); }
 	| RESTRICT
-		{ $$ = new TypeModifier(CVRQualifier::RESTRICT); }
+		{ $$ = context.create<TypeModifier>(CVRQualifier::RESTRICT); }
 	| VOLATILE
-		{ $$ = new TypeModifier(CVRQualifier::VOLATILE); }
+		{ $$ = context.create<TypeModifier>(CVRQualifier::VOLATILE); }
 	;
 
 function_specifier
 	: INLINE
-		{ $$ = new TypeModifier(FunctionSpecifier::INLINE); }
+		{ $$ = context.create<TypeModifier>(FunctionSpecifier::INLINE); }
 	;
 
 declarator
 	: pointer direct_declarator
-		{ $$ = new PtrDecl($1, $2); }
+		{ $$ = context.create<PtrDecl>($1, $2); }
 	| direct_declarator
 		{ $$ = $1; }
 	;
@@ -553,32 +566,32 @@ declarator
 
 direct_declarator
 	: IDENTIFIER
-		{ $$ = new Identifier(std::string(*$1)); }
+		{ $$ = context.create<Identifier>($1); }
 	| '(' declarator ')'
-		{ $$ = new Paren($2); }
+		{ $$ = context.create<Paren>($2); }
 	| direct_declarator '[' type_qualifier_list assignment_expression ']'
 	| direct_declarator '[' type_qualifier_list ']'
 	| direct_declarator '[' assignment_expression ']'
-		{ $$ = new ArrayDecl($1, $3); }
+		{ $$ = context.create<ArrayDecl>($1, $3); }
 	| direct_declarator '[' STATIC type_qualifier_list assignment_expression ']'
 	| direct_declarator '[' type_qualifier_list STATIC assignment_expression ']'
 	| direct_declarator '[' type_qualifier_list '*' ']'
 	| direct_declarator '[' '*' ']'
 	| direct_declarator '[' ']'
 	| direct_declarator '(' parameter_type_list ')'
-		{ $$ = new FnDecl($1, $3); }
+		{ $$ = context.create<FnDecl>($1, $3); }
 	| direct_declarator '(' identifier_list ')'
 		/* K&R style */
 	| direct_declarator '(' ')'
-		{ $$ = new FnDecl($1); }
+		{ $$ = context.create<FnDecl>($1, context.create<ParamList>()); }
 	;
 
 pointer
 	: '*'
-		{ $$ = new PtrNode(); }
+		{ $$ = context.create<PtrNode>(); }
 	| '*' type_qualifier_list
 	| '*' pointer
-		{ $$ = new PtrNode($2); }
+		{ $$ = context.create<PtrNode>($2); }
 	| '*' type_qualifier_list pointer
 	;
 
@@ -597,18 +610,18 @@ parameter_type_list
 
 parameter_list
 	: parameter_declaration
-		{ $$ = new ParamList($1); }
+		{ $$ = context.create<ParamList>(context.getASTContext(), $1); }
 	| parameter_list ',' parameter_declaration
-		{ $1->pushBack($3); $$ = $1; }
+		{ $1->pushBack(context.getASTContext(), $3); $$ = $1; }
 	;
 
 parameter_declaration
 	: declaration_specifiers declarator
-		{ $$ = new ParamDecl($1, $2); }
+		{ $$ = context.create<ParamDecl>($1, $2); }
 	| declaration_specifiers abstract_declarator
-		{ $$ = new ParamDecl(new AbstractTypeDecl($1, $2)); }
+		{ $$ = context.create<ParamDecl>(context.create<AbstractTypeDecl>($1, $2)); }
 	| declaration_specifiers
-		{ $$ = new ParamDecl($1); }
+		{ $$ = context.create<ParamDecl>($1); }
 	;
 
 identifier_list
@@ -620,7 +633,7 @@ type_name
 	: specifier_qualifier_list
 		{ $$ = $1; }
 	| specifier_qualifier_list abstract_declarator
-		{ $$ = new AbstractTypeDecl($1, $2); }
+		{ $$ = context.create<AbstractTypeDecl>($1, $2); }
 	;
 
 abstract_declarator
@@ -629,18 +642,18 @@ abstract_declarator
 	| direct_abstract_declarator
 		{ $$ = $1; }
 	| pointer direct_abstract_declarator
-		{ $$ = new PtrDecl($1, $2); }
+		{ $$ = context.create<PtrDecl>($1, $2); }
 	;
 
 direct_abstract_declarator
 	: '(' abstract_declarator ')'
-		{ $$ = new Paren($2); }
+		{ $$ = context.create<Paren>($2); }
 	| '[' ']'
 	| '[' assignment_expression ']'
-		{ $$ = new AbstractArrayDecl($2); }
+		{ $$ = context.create<AbstractArrayDecl>($2); }
 	| direct_abstract_declarator '[' ']'
 	| direct_abstract_declarator '[' assignment_expression ']'
-		{ $$ = new AbstractArrayDecl($1, $3); }
+		{ $$ = context.create<AbstractArrayDecl>($1, $3); }
 	| '[' '*' ']'
 	| direct_abstract_declarator '[' '*' ']'
 	| '(' ')'
@@ -651,19 +664,19 @@ direct_abstract_declarator
 
 initializer
 	: assignment_expression
-		{ $$ = new Init($1); }
+		{ $$ = context.create<Init>($1); }
 	| '{' initializer_list '}'
-		{ $$ = new Init($2); }
+		{ $$ = context.create<Init>($2); }
 	| '{' initializer_list ',' '}'
-		{ $$ = new Init($2); }
+		{ $$ = context.create<Init>($2); }
 	;
 
 initializer_list
 	: initializer
-		{ $$ = new InitList($1); }
+		{ $$ = context.create<InitList>(context.getASTContext(), $1); }
 	| designation initializer
 	| initializer_list ',' initializer
-		{ $1->pushBack($3); $$ = $1; }
+		{ $1->pushBack(context.getASTContext(), $3); $$ = $1; }
 	| initializer_list ',' designation initializer
 	;
 
@@ -699,94 +712,102 @@ statement
 labeled_statement
 	: IDENTIFIER ':' statement
 	| CASE constant_expression ':' statement
-		{ $$ = new Case($2, $4); }
+		{ $$ = context.create<Case>($2, $4); }
+	| CASE constant_expression ELLIPSIS constant_expression ':' statement
+		{ $$ = context.create<Case>($2, $4, $6); }
 	| DEFAULT ':' statement
-		{ $$ = new Case($3); }
+		{ $$ = context.create<Case>($3); }
 	;
 
 compound_statement
-	: '{' '}'
-		{ $$ = new CompoundStmt(); }
-	| '{' block_item_list '}'
-		{ $$ = new CompoundStmt($2); }
+	: '{' push_scope '}'
+		{ context.popScope(); $$ = context.create<CompoundStmt>(); }
+	| '{' push_scope block_item_list '}'
+		{ context.popScope(); $$ = context.create<CompoundStmt>($3); }
+	;
+
+/* Typedefs declared in a block are not visible outside of it */
+push_scope
+	: %empty
+		{ context.pushScope(); }
 	;
 
 block_item_list
 	: block_item
-		{ $$ = new BlockItemList($1); }
+		{ $$ = context.create<BlockItemList>(context.getASTContext(), $1); }
 	| block_item_list block_item
-	 	{ $1->pushBack($2); $$ = $1; }
+	 	{ $1->pushBack(context.getASTContext(), $2); $$ = $1; }
 	;
 
 block_item
 	: declaration
-		{ $$ = new std::variant<DeclNode*, Stmt*>($1); }
+		{ $$ = context.create<std::variant<DeclNode*, Stmt*>>($1); }
 	| statement
-		{ $$ = new std::variant<DeclNode*, Stmt*>($1); }
+		{ $$ = context.create<std::variant<DeclNode*, Stmt*>>($1); }
 	;
 
 expression_statement
 	: ';'
-		{ $$ = new ExprStmt(); }
+		{ $$ = context.create<ExprStmt>(); }
 	| expression ';'
-		{ $$ = new ExprStmt($1); }
+		{ $$ = context.create<ExprStmt>($1); }
 	;
 
 selection_statement
 	: IF '(' expression ')' statement
 		/* Must be placed in this order, solves dangling else */
-		{ $$ = new IfElse($3, $5); }
+		{ $$ = context.create<IfElse>($3, $5); }
 	| IF '(' expression ')' statement ELSE statement
-		{ $$ = new IfElse($3, $5, $7); }
+		{ $$ = context.create<IfElse>($3, $5, $7); }
 	| SWITCH '(' expression ')' statement
-		{ $$ = new Switch($3, $5); }
+		{ $$ = context.create<Switch>($3, $5); }
 	;
 
 iteration_statement
 	: WHILE '(' expression ')' statement
-		{ $$ = new While($3, $5); }
+		{ $$ = context.create<While>($3, $5); }
 	| DO statement WHILE '(' expression ')' ';'
-		{ $$ = new DoWhile($2, $5); }
+		{ $$ = context.create<DoWhile>($2, $5); }
 	| FOR '(' expression_statement expression_statement ')' statement
-		{ $$ = new For($3, $4, $6); }
+		{ $$ = context.create<For>($3, $4, $6); }
 	| FOR '(' expression_statement expression_statement expression ')' statement
-		{ $$ = new For($3, $4, $5, $7); }
+		{ $$ = context.create<For>($3, $4, $5, $7); }
 	| FOR '(' declaration expression_statement ')' statement
-		{ $$ = new For($3, $4, $6); }
+		{ $$ = context.create<For>($3, $4, $6); }
 	| FOR '(' declaration expression_statement expression ')' statement
-		{ $$ = new For($3, $4, $5, $7); }
+		{ $$ = context.create<For>($3, $4, $5, $7); }
 	;
 
 jump_statement
 	: GOTO IDENTIFIER ';'
 	| CONTINUE ';'
-		{ $$ = new Continue(); }
+		{ $$ = context.create<Continue>(); }
 	| BREAK ';'
-		{ $$ = new Break(); }
+		{ $$ = context.create<Break>(); }
 	| RETURN ';'
-		{ $$ = new Return(); }
+		{ $$ = context.create<Return>(); }
 	| RETURN expression ';'
-		{ $$ = new Return($2); }
+		{ $$ = context.create<Return>($2); }
 	;
 
 translation_unit
 	: external_declaration
-        { $$ = new TranslationUnit($1); }
+        { $$ = context.create<TranslationUnit>(context.getASTContext(), $1); }
 	| translation_unit external_declaration
-        { $1->pushBack($2); $$ = $1; }
+        { $1->pushBack(context.getASTContext(), $2); $$ = $1; }
 	;
 
 external_declaration
 	: function_definition
-        { $$ = new std::variant<DeclNode*, FnDef*>($1); }
+        { $$ = context.create<std::variant<DeclNode*, FnDef*>>($1); }
 	| declaration
-        { $$ = new std::variant<DeclNode*, FnDef*>($1); }
+        { $$ = context.create<std::variant<DeclNode*, FnDef*>>($1); }
 	;
 
 function_definition
 	: declaration_specifiers declarator declaration_list compound_statement
 	| declaration_specifiers declarator compound_statement
-		{ $$ = new FnDef($1, $2, $3); }
+		{ $$ = context.create<FnDef>($1, $2, $3); }
 	;
 
 declaration_list
@@ -797,25 +818,47 @@ declaration_list
 
 %%
 
-const TranslationUnit *g_root;
-
 namespace AST
 {
-    const TranslationUnit *parseAST(const std::string &filename)
+    const TranslationUnit *
+    parseAST(const std::string &filename, ASTContext &astContext)
     {
-        yyin = fopen(filename.c_str(), "r");
+        std::ifstream ifs(filename, std::ios::binary);
 
-        if (yyin == NULL)
+        if (!ifs)
         {
-            std::cerr << "Couldn't open input file " << filename << std::endl;
-            exit(1);
+            throw std::runtime_error("Couldn't open input file " + filename);
         }
 
-        g_root = NULL;
-        yyparse();
-        fclose(yyin);
-        yylex_destroy();
+        std::string source(
+            (std::istreambuf_iterator<char>(ifs)),
+            (std::istreambuf_iterator<char>()));
+
+        return parseSource(source, astContext);
+    }
+
+    const TranslationUnit *
+    parseSource(const std::string &source, ASTContext &astContext)
+    {
+        // All parser state lives in the scanner and context, so several
+        // translation units can be parsed at the same time
+        ParseContext context(astContext);
+        yyscan_t scanner;
+        yylex_init_extra(&context, &scanner);
+
+        // Flex copies the bytes into its own buffer, no temporary files
+        struct yy_buffer_state *buffer =
+            yy_scan_bytes(source.data(), source.size(), scanner);
+        int result = yyparse(scanner, context);
+        yy_delete_buffer(buffer, scanner);
+        yylex_destroy(scanner);
+
+        // yyerror has recorded the message, including memory exhaustion
+        if (result != 0 || context.hasError())
+        {
+            throw std::runtime_error("Parse error: " + context.getError());
+        }
 
-        return g_root;
+        return context.getRoot();
     }
-}
\ No newline at end of file
+}
@@ -7,23 +7,32 @@ Makefile, run the tests and store the outputs in bin/output.
 This script will also generate a JUnit XML file, which can be used to integrate
 with CI/CD pipelines.
 
-Usage: test.py [-h] [-m] [-s] [--version] [--no_clean] [--coverage] [dir]
+Usage: test.py [-h] [-m] [-s] [--version] [--coverage] [--no-cache]
+               [--no-batch] [dir]
 
 Example usage: scripts/test.py compiler_tests/_example
 
 This will print out a progress bar and only run the example tests.
 The output would be placed into bin/output/_example/example/.
 
+A test is skipped if its source, its driver, the headers they include and the
+rcc binary are unchanged since it last passed (see --no-cache). Tests are compiled many at a time in
+one rcc invocation, and each test's time is recorded in the JUnit XML file.
+
 For more information, run scripts/test.py --help
 """
 
 
-__version__ = "0.2.0"
+__version__ = "0.3.0"
 __author__ = "William Huynh (@saturn691), Filip Wojcicki, James Nock"
 
 
 import os
+import re
 import sys
+import json
+import time
+import hashlib
 import argparse
 import shutil
 import subprocess
@@ -31,7 +40,7 @@ from dataclasses import dataclass
 from xml.sax.saxutils import escape as xmlescape, quoteattr as xmlquoteattr
 from pathlib import Path
 from concurrent.futures import ThreadPoolExecutor, as_completed
-from typing import List, Optional
+from typing import Dict, List, Optional
 from http.server import HTTPServer, SimpleHTTPRequestHandler
 
 
@@ -53,10 +62,14 @@ COMPILER_TEST_FOLDER = PROJECT_LOCATION.joinpath("tests").resolve()
 BUILD_FOLDER = PROJECT_LOCATION.joinpath("build").resolve()
 COMPILER_FILE = PROJECT_LOCATION.joinpath("build/rcc").resolve()
 COVERAGE_FOLDER = PROJECT_LOCATION.joinpath("coverage").resolve()
+# Kept out of OUTPUT_FOLDER, which is cleared on every run
+CACHE_FILE = PROJECT_LOCATION.joinpath("build/test_cache.json").resolve()
 
 BUILD_TIMEOUT_SECONDS = 60
 RUN_TIMEOUT_SECONDS = 5
 TIMEOUT_RETURNCODE = 124
+# Number of tests compiled by one rcc invocation
+BATCH_SIZE = 64
 
 
 @dataclass
@@ -67,11 +80,32 @@ class Result:
     return_code: int
     timeout: bool
     error_log: Optional[str]
+    # Wall time in seconds of the test's own steps. A batched compile is not
+    # included, see compile_time.
+    time: float = 0.0
+    # Time spent in rcc, only known when the test was compiled on its own
+    compile_time: Optional[float] = None
+    # Skipped, unchanged since it last passed
+    cached: bool = False
 
     def to_xml(self) -> str:
+        properties = ""
+        if self.cached:
+            properties += '<property name="cached" value="true"/>\n'
+        if self.compile_time is not None:
+            properties += (
+                f'<property name="compile_time" '
+                f'value="{self.compile_time:.3f}"/>\n')
+        if properties:
+            properties = f'<properties>\n{properties}</properties>\n'
+
+        opening_tag = (
+            f'<testcase name="{self.test_case_name}" time="{self.time:.3f}">\n'
+        )
         if self.passed:
             return (
-                f'<testcase name="{self.test_case_name}">\n'
+                opening_tag +
+                properties +
                 f'</testcase>\n'
             )
 
@@ -79,7 +113,8 @@ class Result:
         attribute = xmlquoteattr(timeout + self.error_log)
         xml_tag_body = xmlescape(timeout + self.error_log)
         return (
-            f'<testcase name="{self.test_case_name}">\n'
+            opening_tag +
+            properties +
             f'<error type="error" message={
                 attribute}>\n{xml_tag_body}</error>\n'
             f'</testcase>\n'
@@ -87,8 +122,13 @@ class Result:
 
     def to_log(self) -> str:
         timeout = "[TIMED OUT] " if self.timeout else ""
+        if self.cached:
+            return f'{self.test_case_name}\n\t> {GREEN}Pass (cached){RESET}\n'
         if self.passed:
-            return f'{self.test_case_name}\n\t> {GREEN}Pass{RESET}\n'
+            return (
+                f'{self.test_case_name}\n'
+                f'\t> {GREEN}Pass{RESET} ({self.time:.2f}s)\n'
+            )
         return f'{self.test_case_name}\n{RED}{timeout + self.error_log}{RESET}\n'
 
 
@@ -186,29 +226,210 @@ class ProgressBar:
         self.update()
 
 
-def run_test(driver: Path) -> Result:
+class TestCache:
     """
-    Run an instance of a test case.
+    Remembers the tests that passed, keyed by a hash of everything that can
+    change their result: the test source, the driver, the headers they
+    include with quotes and the rcc binary.
 
     Parameters:
-    - driver: driver path.
+    - path: JSON file the cache is loaded from and saved to.
+    - enabled: if False, nothing is skipped, but passes are still recorded.
+    """
 
-    Returns Result object
+    def __init__(self, path: Path, enabled: bool = True):
+        self.path = path
+        self.enabled = enabled
+        self.entries: Dict[str, dict] = {}
+        self.compiler_hash = hash_file(COMPILER_FILE)
+
+        try:
+            with open(self.path) as f:
+                self.entries = json.load(f)
+        except (OSError, ValueError):
+            pass
+
+    def key(self, driver: Path) -> str:
+        sha = hashlib.sha256(self.compiler_hash.encode())
+        sha.update(hash_file(get_source(driver)).encode())
+        sha.update(hash_file(driver).encode())
+        for header in get_local_includes([get_source(driver), driver]):
+            sha.update(str(header).encode())
+            sha.update(hash_file(header).encode())
+        return sha.hexdigest()
+
+    def lookup(self, driver: Path) -> Optional[Result]:
+        """
+        Returns a passing Result if the test is unchanged since it last
+        passed, None otherwise.
+        """
+        entry = self.entries.get(str(driver.resolve()))
+        if not self.enabled or not entry or entry["key"] != self.key(driver):
+            return None
+
+        return Result(
+            test_case_name=get_source(driver).relative_to(PROJECT_LOCATION),
+            passed=True, return_code=0, timeout=False, error_log="",
+            time=entry["time"], cached=True)
+
+    def record(self, driver: Path, result: Result):
+        if result.cached:
+            return
+        if result.passed:
+            self.entries[str(driver.resolve())] = {
+                "key": self.key(driver), "time": result.time}
+        else:
+            self.entries.pop(str(driver.resolve()), None)
+
+    def save(self):
+        self.path.parent.mkdir(parents=True, exist_ok=True)
+        with open(self.path, "w") as f:
+            json.dump(self.entries, f, indent=2, sort_keys=True)
+
+
+def hash_file(path: Path) -> str:
     """
+    Returns the SHA-256 of the file's contents, or "" if it does not exist.
+    """
+    sha = hashlib.sha256()
+    try:
+        with open(path, "rb") as f:
+            for chunk in iter(lambda: f.read(1 << 20), b""):
+                sha.update(chunk)
+    except OSError:
+        return ""
+    return sha.hexdigest()
+
+
+LOCAL_INCLUDE = re.compile(rb'^\s*#\s*include\s*"([^"]+)"', re.MULTILINE)
+
 
+def get_local_includes(sources: List[Path]) -> List[Path]:
+    """
+    Returns the headers included with quotes by the sources, directly or
+    through other headers, resolved relative to the including file. Headers
+    that do not exist are included, so creating one changes the result.
+    """
+    headers = set()
+    pending = list(sources)
+    while pending:
+        path = pending.pop()
+        try:
+            with open(path, "rb") as f:
+                contents = f.read()
+        except OSError:
+            continue
+
+        for match in LOCAL_INCLUDE.finditer(contents):
+            header = (path.parent /
+                      match.group(1).decode(errors="replace")).resolve()
+            if header not in headers:
+                headers.add(header)
+                pending.append(header)
+
+    return sorted(headers)
+
+
+def get_source(driver: Path) -> Path:
+    """
+    Returns the test source compiled by rcc for a driver.
+    """
     # Replaces example_driver.c -> example.c
     new_name = driver.stem.replace('_driver', '') + '.c'
-    to_assemble = driver.parent.joinpath(new_name).resolve()
-    test_name = to_assemble.relative_to(PROJECT_LOCATION)
+    return driver.parent.joinpath(new_name).resolve()
+
+
+def get_log_path(driver: Path) -> Path:
+    """
+    Returns the path where logs are stored, without the suffix
+    e.g. .../bin/output/_example/example/example
+    """
+    to_assemble = get_source(driver)
 
     # Determine the relative path to the file wrt. COMPILER_TEST_FOLDER.
     relative_path = to_assemble.relative_to(COMPILER_TEST_FOLDER)
 
-    # Construct the path where logs would be stored, without the suffix
-    # e.g. .../bin/output/_example/example/example
-    log_path = Path(OUTPUT_FOLDER).joinpath(
+    return Path(OUTPUT_FOLDER).joinpath(
         relative_path.parent, to_assemble.stem, to_assemble.stem)
 
+
+def compile_batches(drivers: List[Path], jobs: int) -> Dict[Path, Path]:
+    """
+    Compiles the tests BATCH_SIZE at a time, each batch with one rcc
+    invocation, saving the per process startup cost of rcc.
+
+    rcc names each output after its source, so sources sharing a name go
+    into different batches. Tests missing from the returned mapping (because
+    they failed to compile, or their batch timed out) are compiled on their
+    own by run_test, which produces their individual logs.
+
+    Returns a mapping from each driver to its compiled LLVM IR.
+    """
+    batches: List[Dict[str, Path]] = []
+    for driver in drivers:
+        stem = get_source(driver).stem
+        batch = next((b for b in batches
+                      if stem not in b and len(b) < BATCH_SIZE), None)
+        if batch is None:
+            batch = {}
+            batches.append(batch)
+        batch[stem] = driver
+
+    compiled = {}
+    for i, batch in enumerate(batches):
+        batch_folder = OUTPUT_FOLDER.joinpath(".batches", str(i))
+        batch_folder.mkdir(parents=True, exist_ok=True)
+
+        # A failing test does not stop the others being compiled
+        sources = [str(get_source(driver)) for driver in batch.values()]
+        try:
+            subprocess.run(
+                [COMPILER_FILE, "-S", "-j", str(jobs), *sources],
+                cwd=batch_folder,
+                stdout=subprocess.DEVNULL,
+                stderr=subprocess.DEVNULL,
+                timeout=RUN_TIMEOUT_SECONDS * len(batch),
+            )
+        except subprocess.TimeoutExpired:
+            # Its outputs may be incomplete, run_test compiles each test and
+            # reports the one that hangs
+            continue
+
+        for stem, driver in batch.items():
+            output = batch_folder.joinpath(f"{stem}.ll")
+            if output.exists():
+                compiled[driver] = output
+
+    return compiled
+
+
+def run_test(driver: Path, compiled: Optional[Path] = None) -> Result:
+    """
+    Run an instance of a test case.
+
+    Parameters:
+    - driver: driver path.
+    - compiled: the test's LLVM IR, if it was already compiled in a batch.
+
+    Returns Result object
+    """
+    timings = {}
+    start = time.perf_counter()
+    result = run_test_steps(driver, compiled, timings)
+    result.time = time.perf_counter() - start
+    result.compile_time = timings.get("compile")
+    return result
+
+
+def run_test_steps(
+    driver: Path,
+    compiled: Optional[Path],
+    timings: Dict[str, float],
+) -> Result:
+    to_assemble = get_source(driver)
+    test_name = to_assemble.relative_to(PROJECT_LOCATION)
+    log_path = get_log_path(driver)
+
     # Recreate the directory
     shutil.rmtree(log_path.parent, ignore_errors=True)
     log_path.parent.mkdir(parents=True, exist_ok=True)
@@ -235,15 +456,20 @@ def run_test(driver: Path) -> Result:
             timeout=timed_out, error_log=msg)
 
     # Compile
-    return_code, _, timed_out = run_subprocess(
-        cmd=[COMPILER_FILE, "-S", to_assemble, "-o", f"{log_path}.ll"],
-        timeout=RUN_TIMEOUT_SECONDS,
-        env=custom_env,
-        log_path=f"{log_path}.compiler",
-    )
-    if return_code != 0:
-        msg = f"\t> Failed to compile testcase: \n\t {compiler_log_file_str}"
-        return Result(test_case_name=test_name, return_code=return_code, passed=False, timeout=timed_out, error_log=msg)
+    if compiled:
+        shutil.move(compiled, f"{log_path}.ll")
+    else:
+        compile_start = time.perf_counter()
+        return_code, _, timed_out = run_subprocess(
+            cmd=[COMPILER_FILE, "-S", to_assemble, "-o", f"{log_path}.ll"],
+            timeout=RUN_TIMEOUT_SECONDS,
+            env=custom_env,
+            log_path=f"{log_path}.compiler",
+        )
+        timings["compile"] = time.perf_counter() - compile_start
+        if return_code != 0:
+            msg = f"\t> Failed to compile testcase: \n\t {compiler_log_file_str}"
+            return Result(test_case_name=test_name, return_code=return_code, passed=False, timeout=timed_out, error_log=msg)
 
     # Link
     return_code, _, timed_out = run_subprocess(
@@ -386,13 +612,13 @@ def process_result(
     return
 
 
-def run_tests(args, xml_file: JUnitXMLFile):
+def run_tests(args, xml_file: JUnitXMLFile, cache: TestCache):
     """
     Runs tests against compiler.
     """
     drivers = list(Path(args.dir).rglob("*_driver.c"))
     drivers = sorted(drivers, key=lambda p: (p.parent.name, p.name))
-    results = []
+    results: List[Result] = []
 
     progress_bar = None
     if args.short and sys.stdout.isatty():
@@ -401,28 +627,55 @@ def run_tests(args, xml_file: JUnitXMLFile):
         # Force verbose mode when not a terminal
         args.short = False
 
+    def finish(driver: Path, result: Result):
+        results.append(result)
+        cache.record(driver, result)
+        process_result(result, xml_file, not args.short, progress_bar)
+
+    pending = []
+    for driver in drivers:
+        result = cache.lookup(driver)
+        if result:
+            finish(driver, result)
+        else:
+            pending.append(driver)
+
+    compiled = {}
+    if args.batch and pending:
+        jobs = os.cpu_count() if args.multithreading else 1
+        compiled = compile_batches(pending, jobs)
+
     if args.multithreading:
         with ThreadPoolExecutor() as executor:
-            futures = [executor.submit(run_test, driver) for driver in drivers]
+            futures = {
+                executor.submit(run_test, driver, compiled.get(driver)): driver
+                for driver in pending
+            }
             for future in as_completed(futures):
-                result = future.result()
-                results.append(result.passed)
-                process_result(result, xml_file, not args.short, progress_bar)
+                finish(futures[future], future.result())
 
     else:
-        for driver in drivers:
-            result = run_test(driver)
-            results.append(result.passed)
-            process_result(result, xml_file, not args.short, progress_bar)
+        for driver in pending:
+            finish(driver, run_test(driver, compiled.get(driver)))
 
-    passing = sum(results)
+    passing = sum(result.passed for result in results)
+    cached = sum(result.cached for result in results)
     total = len(drivers)
 
     if args.short:
         return
 
+    slowest = sorted(
+        (result for result in results if not result.cached),
+        key=lambda result: result.time, reverse=True)[:5]
+    if slowest:
+        print("\n>> Slowest tests:")
+        for result in slowest:
+            print(f"\t{result.time:6.2f}s {result.test_case_name}")
+
     print("\n>> Test Summary: " + GREEN +
-          f"{passing} Passed, " + RED + f"{total-passing} Failed" + RESET)
+          f"{passing} Passed ({cached} cached), " + RED +
+          f"{total-passing} Failed" + RESET)
 
 
 def parse_args():
@@ -457,12 +710,28 @@ def parse_args():
         action="version",
         version=f"BetterTesting {__version__}"
     )
+    parser.add_argument(
+        "--no-cache",
+        dest="cache",
+        action="store_false",
+        default=True,
+        help="Run every test, even those unchanged since they last passed."
+    )
+    parser.add_argument(
+        "--no-batch",
+        dest="batch",
+        action="store_false",
+        default=True,
+        help="Compile each test with its own rcc invocation, instead of many "
+        "tests per invocation. Records each test's compile time."
+    )
     parser.add_argument(
         "--coverage",
         action="store_true",
         default=False,
         help="Run with coverage if you want to know which part of your code is "
-        "executed when running your compiler. See docs/coverage.md"
+        "executed when running your compiler. Implies --no-cache. See "
+        "docs/coverage.md"
     )
     return parser.parse_args()
 
@@ -476,8 +745,13 @@ def main():
 
     # TODO: write function called setup()- make is a bit more complicated now
     
-    with JUnitXMLFile(J_UNIT_OUTPUT_FILE) as xml_file:
-        run_tests(args, xml_file)
+    # Coverage is only complete if every test runs
+    cache = TestCache(CACHE_FILE, enabled=args.cache and not args.coverage)
+    try:
+        with JUnitXMLFile(J_UNIT_OUTPUT_FILE) as xml_file:
+            run_tests(args, xml_file, cache)
+    finally:
+        cache.save()
 
     if args.coverage:
         if not coverage():
@@ -0,0 +1,21 @@
+int f(int x)
+{
+    int table[64] = {
+        0, 7, 14, 21, 28, 35, 42, 49, 56, 63, 70, 77, 84, 91, 98, 5, 12, 19, 26,
+        33, 40, 47, 54, 61, 68, 75, 82, 89, 96, 3, 10, 17, 24, 31, 38, 45, 52,
+        59, 66, 73, 80, 87, 94, 1, 8, 15, 22, 29, 36, 43, 50, 57, 64, 71, 78,
+        85, 92, 99, 6, 13, 20, 27, 34, x};
+    int sparse[100] = {5, 0, 0, 7};
+    char zeros[64] = {0};
+    int sum = 0;
+    int i;
+    for (i = 0; i < 64; i++)
+    {
+        sum += table[i] + zeros[i];
+    }
+    for (i = 0; i < 100; i++)
+    {
+        sum += sparse[i];
+    }
+    return sum;
+}
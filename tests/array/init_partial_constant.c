@@ -0,0 +1,7 @@
+int f(int x, int y)
+{
+    int a[6] = {1, x, 3, y, 5};
+    int b[2][3] = {{0, 0, x}, {y}};
+    return a[0] + a[1] + a[2] + a[3] + a[4] + a[5] + b[0][2] + b[1][0] +
+           b[1][1];
+}
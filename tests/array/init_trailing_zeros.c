@@ -0,0 +1,24 @@
+int table[4096] = {1, 2, 3, 4, 5, 6, 7};
+int tentative[100];
+int tentative[100] = {1};
+
+int f()
+{
+    int local[64] = {1,  2,  3,  4,  5,  6,  7,  8,  9,  10,
+                     11, 12, 13, 14, 15, 16, 17, 18, 19, 20};
+    int sum = 0;
+    int i;
+    for (i = 0; i < 4096; i++)
+    {
+        sum += table[i];
+    }
+    for (i = 0; i < 64; i++)
+    {
+        sum += local[i];
+    }
+    for (i = 0; i < 100; i++)
+    {
+        sum += tentative[i];
+    }
+    return sum;
+}
@@ -0,0 +1,12 @@
+int f(int n)
+{
+    int sum = 0;
+    int i;
+    for (i = 0; i < n; i++)
+    {
+        int buffer[1024];
+        buffer[i % 1024] = i;
+        sum += buffer[i % 1024] % 7;
+    }
+    return sum;
+}
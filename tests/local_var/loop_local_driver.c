@@ -0,0 +1,13 @@
+int f(int n);
+
+int main()
+{
+    // Would overflow the stack if buffer were allocated on every iteration
+    int n = 100000;
+    int expected = 0;
+    for (int i = 0; i < n; i++)
+    {
+        expected += i % 7;
+    }
+    return !(f(n) == expected);
+}
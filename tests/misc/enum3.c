@@ -0,0 +1,22 @@
+enum Op
+{
+    PUSH = 1,
+    POP = PUSH << 1,
+    ADD,
+    LAST = (ADD + 1) * 2,
+    MASK = ~0u >> 28
+};
+
+int g(int op)
+{
+    switch (op)
+    {
+    case POP:
+        return 1;
+    case LAST - 1:
+        return 2;
+    case MASK:
+        return 3;
+    }
+    return 0;
+}
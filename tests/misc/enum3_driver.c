@@ -0,0 +1,6 @@
+int g(int op);
+
+int main()
+{
+    return !(g(2) == 1 && g(7) == 2 && g(15) == 3 && g(3) == 0);
+}
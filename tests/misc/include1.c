@@ -0,0 +1,7 @@
+#include "include1.h"
+#include "include1.h"
+
+int square(int x)
+{
+    return SQUARE(x);
+}
@@ -0,0 +1,8 @@
+#ifndef INCLUDE1_H
+#define INCLUDE1_H
+
+#define SQUARE(x) ((x)*(x))
+
+int square(int x);
+
+#endif
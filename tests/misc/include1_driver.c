@@ -0,0 +1,6 @@
+int square(int x);
+
+int main()
+{
+    return !(square(7)==49);
+}
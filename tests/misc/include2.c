@@ -0,0 +1,7 @@
+#include "include2.h"
+#include "include2.h"
+
+int both()
+{
+    return FIRST + SECOND;
+}
@@ -0,0 +1,10 @@
+#ifndef INCLUDE2_H
+#define INCLUDE2_H
+
+#define FIRST 1
+
+#else
+
+#define SECOND 2
+
+#endif
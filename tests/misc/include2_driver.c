@@ -0,0 +1,6 @@
+int both();
+
+int main()
+{
+    return !(both()==3);
+}
@@ -0,0 +1,33 @@
+int classify(char c)
+{
+    switch (c)
+    {
+    case '0' ... '9':
+        return 1;
+    case 'a' ... 'z':
+    case 'A' ... 'Z':
+        return 2;
+    case -128 ... -1:
+        return 3;
+    }
+    return 0;
+}
+
+int bucket(long x)
+{
+    switch (__builtin_expect(x, 5))
+    {
+    case 5:
+        return 1;
+    case 100 ... 999:
+        return 2;
+    case 1000 ... 100000:
+        return 3;
+    default:
+        if (__builtin_expect(x < 0, 0))
+        {
+            return -1;
+        }
+        return 0;
+    }
+}
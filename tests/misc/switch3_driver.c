@@ -0,0 +1,10 @@
+int classify(char c);
+int bucket(long x);
+
+int main()
+{
+    return !(classify('7') == 1 && classify('q') == 2 && classify('Q') == 2 &&
+             classify(-5) == 3 && classify(' ') == 0 && bucket(5) == 1 &&
+             bucket(100) == 2 && bucket(999) == 2 && bucket(1000) == 3 &&
+             bucket(100000) == 3 && bucket(100001) == 0 && bucket(-7) == -1);
+}
@@ -0,0 +1,14 @@
+int f(int y)
+{
+    typedef int T;
+    T x;
+    x=y+1;
+    return x;
+}
+
+int g(int y)
+{
+    int T;
+    T=y*2;
+    return T;
+}
@@ -0,0 +1,7 @@
+int f(int y);
+int g(int y);
+
+int main()
+{
+    return !(f(1)==2 && g(3)==6);
+}
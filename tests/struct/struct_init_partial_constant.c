@@ -0,0 +1,12 @@
+struct point
+{
+    int x;
+    int y;
+    int z;
+};
+
+int f(int y)
+{
+    struct point p = {7, y};
+    return p.x + p.y + p.z;
+}
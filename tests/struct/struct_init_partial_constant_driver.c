@@ -0,0 +1,6 @@
+int f(int y);
+
+int main()
+{
+    return !(f(5) == 12);
+}
@@ -0,0 +1,8 @@
+int table[sizeof(long) * 2 + (int)1.5];
+long neg = (char)255;
+int hex = 0x1e;
+
+int f()
+{
+    return sizeof(table) / sizeof(table[0]) + hex + neg;
+}
@@ -0,0 +1,74 @@
+#include "CodeGen/ScopedSymbolTable.hpp"
+#include "gtest/gtest.h"
+
+#include <string>
+
+class ScopedSymbolTableTest : public ::testing::Test
+{
+protected:
+    void SetUp() override
+    {
+        table_.pushScope();
+    }
+
+    ScopedSymbolTable<std::string, int> table_;
+};
+
+TEST_F(ScopedSymbolTableTest, lookup_Unbound)
+{
+    EXPECT_EQ(table_.lookup("a"), nullptr);
+    EXPECT_EQ(table_.lookupInCurrentScope("a"), nullptr);
+}
+
+TEST_F(ScopedSymbolTableTest, lookup_Shadowing)
+{
+    table_.insert("a", 1);
+    table_.pushScope();
+    table_.insert("a", 2);
+
+    ASSERT_NE(table_.lookup("a"), nullptr);
+    EXPECT_EQ(*table_.lookup("a"), 2);
+
+    table_.popScope();
+    ASSERT_NE(table_.lookup("a"), nullptr);
+    EXPECT_EQ(*table_.lookup("a"), 1);
+}
+
+TEST_F(ScopedSymbolTableTest, lookup_OuterScope)
+{
+    table_.insert("a", 1);
+    table_.pushScope();
+    table_.pushScope();
+
+    ASSERT_NE(table_.lookup("a"), nullptr);
+    EXPECT_EQ(*table_.lookup("a"), 1);
+    EXPECT_EQ(table_.lookupInCurrentScope("a"), nullptr);
+}
+
+TEST_F(ScopedSymbolTableTest, insert_Redeclaration)
+{
+    table_.pushScope();
+    table_.insert("a", 1);
+    table_.insert("a", 2);
+
+    ASSERT_NE(table_.lookupInCurrentScope("a"), nullptr);
+    EXPECT_EQ(*table_.lookupInCurrentScope("a"), 2);
+
+    // Both declarations leave with the scope
+    table_.popScope();
+    EXPECT_EQ(table_.lookup("a"), nullptr);
+}
+
+TEST_F(ScopedSymbolTableTest, popScope_Rebind)
+{
+    table_.pushScope();
+    table_.insert("a", 1);
+    table_.popScope();
+
+    table_.pushScope();
+    EXPECT_EQ(table_.lookup("a"), nullptr);
+    table_.insert("a", 2);
+    ASSERT_NE(table_.lookup("a"), nullptr);
+    EXPECT_EQ(*table_.lookup("a"), 2);
+    EXPECT_EQ(table_.depth(), 2);
+}
@@ -0,0 +1,47 @@
+#define TCPP_IMPLEMENTATION
+#include "Preprocessor.hpp"
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+std::vector<tcpp::TToken> tokenize(tcpp::Lexer &lexer)
+{
+    std::vector<tcpp::TToken> tokens;
+    while (lexer.HasNextToken())
+    {
+        tokens.push_back(lexer.GetNextToken());
+    }
+    return tokens;
+}
+
+// The text of the tokens, read only once the lexer has finished
+std::string join(const std::vector<tcpp::TToken> &tokens)
+{
+    std::string text;
+    for (const auto &token : tokens)
+    {
+        text += token.mRawView;
+    }
+    return text;
+}
+} // namespace
+
+TEST(LexerTest, GetNextToken_BlobBeforeSeparator)
+{
+    // Blobs end at the separators (`}` before `;`, `)` before `,`)
+    std::string source = "struct s {int a;};\nint f(int x, int y) { return "
+                         "g(x)+y; }\n";
+    tcpp::Lexer lexer(std::make_unique<tcpp::StringInputStream>(source));
+    std::vector<tcpp::TToken> tokens = tokenize(lexer);
+
+    // Tokens of a long second input reuse the lexer's line buffers
+    std::string filler(4096, 'x');
+    lexer.PushStream(std::make_unique<tcpp::StringInputStream>(filler));
+    tokenize(lexer);
+
+    EXPECT_EQ(join(tokens), source);
+}